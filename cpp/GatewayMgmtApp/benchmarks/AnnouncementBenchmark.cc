@@ -0,0 +1,162 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <alljoyn/AboutData.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/gateway/GatewayAppIdentifier.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+
+/**
+ * Measures the cost of an announcement. Compares extracting the AppId and DeviceId through
+ * AboutData::CreatefromMsgArg with GatewayAppIdentifier::extractFromAboutData, then times
+ * GatewayRouterPolicyManager::Announced for new and for repeated announcements
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int NUM_DEVICES = 1000;
+static const int NUM_ROUNDS = 200;
+static const char* LANGUAGES[] = { "en", "de", "fr" };
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * The AboutData of one device, with the fields a typical announcement carries
+ */
+class Announcement {
+  public:
+    Announcement(int device)
+    {
+        memset(m_AppId, 0, sizeof(m_AppId));
+        memcpy(m_AppId, &device, sizeof(device));
+        snprintf(m_DeviceId, sizeof(m_DeviceId), "device%d", device);
+        snprintf(m_BusName, sizeof(m_BusName), ":remote%d.1", device);
+
+        m_Values[0].Set("ay", sizeof(m_AppId), m_AppId);
+        m_Values[1].Set("s", "en");
+        m_Values[2].Set("s", m_DeviceId);
+        m_Values[3].Set("s", "Kitchen light");
+        m_Values[4].Set("s", "Light controller");
+        m_Values[5].Set("s", "Example Manufacturer");
+        m_Values[6].Set("s", "LC-100");
+        m_Values[7].Set("s", "Dims and switches the lights of a room");
+        m_Values[8].Set("s", "1.0.3");
+        m_Values[9].Set("s", "14.12.00");
+        m_Values[10].Set("as", sizeof(LANGUAGES) / sizeof(LANGUAGES[0]), LANGUAGES);
+
+        const char* names[] = { "AppId", "DefaultLanguage", "DeviceId", "DeviceName", "AppName", "Manufacturer",
+                                "ModelNumber", "Description", "SoftwareVersion", "AJSoftwareVersion", "SupportedLanguages" };
+        for (size_t i = 0; i < NUM_FIELDS; i++) {
+            m_Fields[i].Set("{sv}", names[i], &m_Values[i]);
+        }
+        m_AboutData.Set("a{sv}", NUM_FIELDS, m_Fields);
+    }
+
+    const MsgArg& getAboutData() const
+    {
+        return m_AboutData;
+    }
+
+    const char* getBusName() const
+    {
+        return m_BusName;
+    }
+
+  private:
+    static const size_t NUM_FIELDS = 11;
+    uint8_t m_AppId[16];
+    char m_DeviceId[32];
+    char m_BusName[32];
+    MsgArg m_Values[NUM_FIELDS];
+    MsgArg m_Fields[NUM_FIELDS];
+    MsgArg m_AboutData;
+};
+
+static void report(const char* name, double seconds, int count)
+{
+    printf("%-40s %10.0f ns/announcement\n", name, seconds * 1e9 / count);
+}
+
+int main()
+{
+    std::vector<Announcement*> announcements;
+    for (int device = 0; device < NUM_DEVICES; device++) {
+        announcements.push_back(new Announcement(device));
+    }
+    int count = NUM_DEVICES * NUM_ROUNDS;
+
+    //before: a full AboutData is built to read two fields
+    size_t found = 0;
+    double start = now();
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        for (int device = 0; device < NUM_DEVICES; device++) {
+            AboutData aboutData;
+            aboutData.CreatefromMsgArg(announcements[device]->getAboutData());
+            char* deviceId = NULL;
+            uint8_t* appId = NULL;
+            size_t appIdLen = 0;
+            aboutData.GetDeviceId(&deviceId);
+            aboutData.GetAppId(&appId, &appIdLen);
+            found += appIdLen && deviceId;
+        }
+    }
+    report("AboutData::CreatefromMsgArg", now() - start, count);
+
+    //after: the two fields are read in place
+    start = now();
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        for (int device = 0; device < NUM_DEVICES; device++) {
+            const uint8_t* appId = NULL;
+            size_t appIdLen = 0;
+            const char* deviceId = NULL;
+            found += GatewayAppIdentifier::extractFromAboutData(announcements[device]->getAboutData(), &appId, &appIdLen, &deviceId);
+        }
+    }
+    report("GatewayAppIdentifier::extractFromAboutData", now() - start, count);
+
+    GatewayRouterPolicyManager policyManager;
+    start = now();
+    for (int device = 0; device < NUM_DEVICES; device++) {
+        policyManager.Announced(announcements[device]->getBusName(), 1, 0, MsgArg(), announcements[device]->getAboutData());
+    }
+    report("Announced - new device", now() - start, NUM_DEVICES);
+
+    start = now();
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        for (int device = 0; device < NUM_DEVICES; device++) {
+            policyManager.Announced(announcements[device]->getBusName(), 1, 0, MsgArg(), announcements[device]->getAboutData());
+        }
+    }
+    report("Announced - repeated announcement", now() - start, count);
+
+    if (found != (size_t)count * 2) {
+        printf("Some announcements were not parsed\n");
+    }
+    for (size_t i = 0; i < announcements.size(); i++) {
+        delete announcements[i];
+    }
+    return 0;
+}
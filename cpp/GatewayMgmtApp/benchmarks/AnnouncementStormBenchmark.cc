@@ -0,0 +1,236 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayStats.h>
+
+/**
+ * Drives GatewayRouterPolicyManager::Announced with a storm of synthetic announcements:
+ * thousands of distinct apps announcing for the first time, repeated identical
+ * announcements, and every app coming back under a new busName. Part of the apps are
+ * referenced by the Acls of the connectors, so their announcements rewrite policy files.
+ * Commits run synchronously and the config reload is stubbed out
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int NUM_APPS = 5000;
+static const int NUM_CONNECTORS = 50;
+static const int REFERENCED_APPS_PER_CONNECTOR = 20;
+static const int REPEAT_ROUNDS = 20;
+static const int CHURN_ROUNDS = 3;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static qcc::String format(const char* fmt, int value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), fmt, value);
+    return buffer;
+}
+
+/**
+ * Policy manager counting the config reloads instead of asking the routing node
+ */
+class StubReloadPolicyManager : public GatewayRouterPolicyManager {
+  public:
+    StubReloadPolicyManager() : m_Reloads(0) { }
+
+    uint64_t getReloads() const
+    {
+        return m_Reloads;
+    }
+
+  protected:
+    QStatus reloadConfig()
+    {
+        m_Reloads++;
+        return ER_OK;
+    }
+
+  private:
+    uint64_t m_Reloads;
+};
+
+/**
+ * The AboutData announced by one app
+ */
+class Announcement {
+  public:
+    Announcement(int app)
+    {
+        memset(m_AppId, 0, sizeof(m_AppId));
+        memcpy(m_AppId, &app, sizeof(app));
+        snprintf(m_DeviceId, sizeof(m_DeviceId), "device%d", app);
+
+        m_Values[0].Set("ay", sizeof(m_AppId), m_AppId);
+        m_Values[1].Set("s", "en");
+        m_Values[2].Set("s", m_DeviceId);
+        m_Values[3].Set("s", "Storm device");
+        m_Values[4].Set("s", "Storm app");
+
+        const char* names[] = { "AppId", "DefaultLanguage", "DeviceId", "DeviceName", "AppName" };
+        for (size_t i = 0; i < NUM_FIELDS; i++) {
+            m_Fields[i].Set("{sv}", names[i], &m_Values[i]);
+        }
+        m_AboutData.Set("a{sv}", NUM_FIELDS, m_Fields);
+    }
+
+    GatewayAppIdentifier getKey() const
+    {
+        return GatewayAppIdentifier((uint8_t*)m_AppId, sizeof(m_AppId), m_DeviceId);
+    }
+
+    const MsgArg& getAboutData() const
+    {
+        return m_AboutData;
+    }
+
+  private:
+    static const size_t NUM_FIELDS = 5;
+    uint8_t m_AppId[16];
+    char m_DeviceId[32];
+    MsgArg m_Values[NUM_FIELDS];
+    MsgArg m_Fields[NUM_FIELDS];
+    MsgArg m_AboutData;
+};
+
+static GatewayRuleObjectDescriptions objectRules(int index)
+{
+    std::vector<qcc::String> interfaces;
+    interfaces.push_back(format("org.example.Interface%d", index));
+
+    GatewayRuleObjectDescriptions objects;
+    objects.push_back(GatewayRuleObjectDescription(format("/org/example/object%d", index), false, interfaces));
+    return objects;
+}
+
+static void removeDirectory(qcc::String const& dirName)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlink((dirName + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+/**
+ * Announce every app once per round and report the rate and the work it caused
+ * @param name - the name of the phase
+ * @param generation - the busName suffix. Changing it makes every app announce under a new busName
+ * @param churn - true to change the busName suffix every round
+ */
+static void runPhase(const char* name, StubReloadPolicyManager& policyManager, std::vector<Announcement*> const& announcements,
+                     int rounds, int generation, bool churn)
+{
+    uint64_t countersBefore[GW_STAT_NUM_COUNTERS];
+    uint64_t countersAfter[GW_STAT_NUM_COUNTERS];
+    GatewayStats::Histogram histograms[GW_LATENCY_NUM_HISTOGRAMS];
+    uint64_t elapsedMs;
+    GatewayStats::getInstance()->getSnapshot(countersBefore, histograms, &elapsedMs);
+    uint64_t reloadsBefore = policyManager.getReloads();
+
+    char busName[32];
+    MsgArg objectDescs;
+    double start = now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t app = 0; app < announcements.size(); app++) {
+            snprintf(busName, sizeof(busName), ":remote%u.%d", (uint32_t)app, churn ? generation + round : generation);
+            policyManager.Announced(busName, 1, 0, objectDescs, announcements[app]->getAboutData());
+        }
+    }
+    double seconds = now() - start;
+
+    GatewayStats::getInstance()->getSnapshot(countersAfter, histograms, &elapsedMs);
+    uint64_t count = (uint64_t)rounds * announcements.size();
+    printf("%-28s %8llu announcements %10.0f /sec %6llu files written %6llu reloads\n", name, (unsigned long long)count,
+           count / seconds,
+           (unsigned long long)(countersAfter[GW_STAT_POLICY_FILES_WRITTEN] - countersBefore[GW_STAT_POLICY_FILES_WRITTEN]),
+           (unsigned long long)(policyManager.getReloads() - reloadsBefore));
+}
+
+int main()
+{
+    char baseDir[] = "/tmp/gwAnnouncementStormXXXXXX";
+    if (!mkdtemp(baseDir)) {
+        printf("Could not create a temporary directory\n");
+        return 1;
+    }
+    qcc::String policyFile = qcc::String(baseDir) + "/gwagent.conf";
+    qcc::String appPolicyDir = qcc::String(baseDir) + "/apps";
+    mkdir(appPolicyDir.c_str(), 0755);
+
+    std::vector<Announcement*> announcements;
+    for (int app = 0; app < NUM_APPS; app++) {
+        announcements.push_back(new Announcement(app));
+    }
+
+    {
+        StubReloadPolicyManager policyManager;
+        policyManager.setGatewayPolicyFile(policyFile.c_str());
+        policyManager.setAppPolicyDirectory(appPolicyDir.c_str());
+
+        //every connector references its own slice of the apps, the rest are only announced
+        int app = 0;
+        for (int conn = 0; conn < NUM_CONNECTORS; conn++) {
+            GatewayAclRules rules;
+            rules.setExposedServicesRules(objectRules(conn));
+            GatewayRemoteAppRules remoteAppRules;
+            for (int remote = 0; remote < REFERENCED_APPS_PER_CONNECTOR; remote++, app++) {
+                remoteAppRules[announcements[app]->getKey()] = objectRules(remote);
+            }
+            rules.setRemoteAppRules(remoteAppRules);
+            policyManager.addConnectorAppRules(format("conn%d", conn), std::vector<GatewayAclRules>(1, rules));
+        }
+        policyManager.commit();
+        policyManager.setAutoCommit(true);
+
+        printf("%d apps, %d connectors referencing %d apps each\n", NUM_APPS, NUM_CONNECTORS, REFERENCED_APPS_PER_CONNECTOR);
+        runPhase("first announcement", policyManager, announcements, 1, 1, false);
+        runPhase("repeated announcement", policyManager, announcements, REPEAT_ROUNDS, 1, false);
+        runPhase("busName churn", policyManager, announcements, CHURN_ROUNDS, 2, true);
+    }
+
+    for (size_t i = 0; i < announcements.size(); i++) {
+        delete announcements[i];
+    }
+    removeDirectory(appPolicyDir);
+    unlink(policyFile.c_str());
+    rmdir(baseDir);
+    return 0;
+}
@@ -0,0 +1,279 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fstream>
+#include <vector>
+#include <alljoyn/gateway/GatewayConnectorApp.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
+
+/**
+ * Compares loading the Acls of the connectors at startup from their xml files with
+ * loading them from a snapshot: one read of the snapshot file, a stat of every file
+ * it depends on and decoding the binary values. Also measures indexing only the name and
+ * status of the Acls, as with --lazy-acl-bodies. The Acls are laid out like the apps
+ * directory in a temporary directory
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int NUM_CONNECTORS = 50;
+static const int ACLS_PER_CONNECTOR = 20;
+static const int OBJECTS_PER_ACL = 5;
+static const int REMOTED_APPS_PER_ACL = 10;
+static const int ROUNDS = 5;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static qcc::String format(const char* fmt, int value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), fmt, value);
+    return buffer;
+}
+
+static qcc::String objectsXml(int index)
+{
+    qcc::String xml;
+    for (int obj = 0; obj < OBJECTS_PER_ACL; obj++) {
+        xml += "<object><path>" + format("/org/example/object%d", index * OBJECTS_PER_ACL + obj) + "</path>";
+        xml += "<isPrefix>false</isPrefix><interfaces>";
+        xml += "<interface>" + format("org.example.Interface%d", obj) + "</interface>";
+        xml += "<interface>org.example.Common</interface></interfaces></object>";
+    }
+    return xml;
+}
+
+static qcc::String aclXml(int acl)
+{
+    qcc::String xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Acl>";
+    xml += "<name>" + format("acl%d", acl) + "</name><status>1</status>";
+    xml += "<exposedServices>" + objectsXml(acl) + "</exposedServices><remotedApps>";
+    for (int remote = 0; remote < REMOTED_APPS_PER_ACL; remote++) {
+        xml += "<device><deviceId>" + format("device%d", remote) + "</deviceId>";
+        xml += "<appId>" + format("%032x", remote + 1) + "</appId>";
+        xml += "<objects>" + objectsXml(remote) + "</objects></device>";
+    }
+    xml += "</remotedApps><customMetadata><data><key>owner</key><value>benchmark</value></data></customMetadata></Acl>\n";
+    return xml;
+}
+
+static void removeTree(qcc::String const& dirName)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        qcc::String path = dirName + "/" + entry->d_name;
+        if (entry->d_type == DT_DIR) {
+            removeTree(path);
+        } else {
+            unlink(path.c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+static void deleteApps(std::vector<GatewayConnectorApp*>& apps)
+{
+    for (size_t i = 0; i < apps.size(); i++) {
+        delete apps[i];
+    }
+    apps.clear();
+}
+
+/**
+ * Parse every acl file of every connector, the way the apps are loaded without a snapshot
+ */
+static size_t loadFromXml(qcc::String const& appsDir, std::vector<GatewayConnectorApp*>& apps,
+                          std::vector<std::vector<GatewayAcl*> >& acls, bool headerOnly = false)
+{
+    size_t loaded = 0;
+    for (int conn = 0; conn < NUM_CONNECTORS; conn++) {
+        qcc::String appName = format("conn%d", conn);
+        qcc::String aclDir = appsDir + "/" + appName + "/acls";
+        GatewayConnectorApp* app = new GatewayConnectorApp(appName, appName, GatewayConnectorAppManifest());
+        apps.push_back(app);
+        acls.push_back(std::vector<GatewayAcl*>());
+
+        DIR* dir = opendir(aclDir.c_str());
+        struct dirent* entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            if (entry->d_type != DT_REG) {
+                continue;
+            }
+            GatewayAcl* acl = new GatewayAcl(entry->d_name, app);
+            qcc::String fileName = aclDir + "/" + entry->d_name;
+            if ((headerOnly ? acl->loadHeaderFromFile(fileName) : acl->loadFromFile(fileName)) != ER_OK) {
+                delete acl;
+                continue;
+            }
+            acls.back().push_back(acl);
+            loaded++;
+        }
+        if (dir) {
+            closedir(dir);
+        }
+    }
+    return loaded;
+}
+
+/**
+ * Load the snapshot and decode the Acls of every connector
+ */
+static size_t loadFromSnapshot(qcc::String const& snapshotFile, std::vector<GatewayConnectorApp*>& apps)
+{
+    GatewaySnapshot snapshot;
+    if (snapshot.load(snapshotFile) != ER_OK) {
+        return 0;
+    }
+
+    size_t loaded = 0;
+    for (int conn = 0; conn < NUM_CONNECTORS; conn++) {
+        qcc::String appName = format("conn%d", conn);
+        GatewayConnectorApp* app = new GatewayConnectorApp(appName, appName, GatewayConnectorAppManifest());
+        apps.push_back(app);
+        if (!app->readSnapshot(snapshot)) {
+            return 0;
+        }
+        loaded += app->getAcls().size();
+    }
+    return loaded;
+}
+
+int main()
+{
+    char baseDir[] = "/tmp/gwColdStartXXXXXX";
+    if (!mkdtemp(baseDir)) {
+        printf("Could not create a temporary directory\n");
+        return 1;
+    }
+    qcc::String appsDir = qcc::String(baseDir) + "/apps";
+    qcc::String snapshotFile = qcc::String(baseDir) + "/gwagent.snapshot";
+    mkdir(appsDir.c_str(), 0755);
+
+    size_t xmlBytes = 0;
+    for (int conn = 0; conn < NUM_CONNECTORS; conn++) {
+        qcc::String appDir = appsDir + "/" + format("conn%d", conn);
+        mkdir(appDir.c_str(), 0755);
+        mkdir((appDir + "/acls").c_str(), 0755);
+        for (int acl = 0; acl < ACLS_PER_CONNECTOR; acl++) {
+            qcc::String xml = aclXml(acl);
+            std::ofstream ofs((appDir + "/acls/" + format("acl%d", acl)).c_str());
+            ofs << xml.c_str();
+            xmlBytes += xml.size();
+        }
+    }
+
+    //the snapshot is written from the state parsed from xml, as the agent does after startup
+    std::vector<GatewayConnectorApp*> apps;
+    std::vector<std::vector<GatewayAcl*> > acls;
+    loadFromXml(appsDir, apps, acls);
+
+    GatewaySnapshot snapshot;
+    snapshot.addFile(appsDir);
+    for (int conn = 0; conn < NUM_CONNECTORS; conn++) {
+        qcc::String aclDir = appsDir + "/" + apps[conn]->getAppName() + "/acls";
+        snapshot.addFile(aclDir);
+        snapshot.putUInt32(acls[conn].size());
+        for (size_t acl = 0; acl < acls[conn].size(); acl++) {
+            snapshot.addFile(aclDir + "/" + acls[conn][acl]->getAclId());
+            snapshot.putString(acls[conn][acl]->getAclId());
+            acls[conn][acl]->writeSnapshot(snapshot);
+            delete acls[conn][acl];
+        }
+    }
+    deleteApps(apps);
+    acls.clear();
+
+    if (snapshot.save(snapshotFile) != ER_OK) {
+        printf("Could not write the snapshot\n");
+        removeTree(baseDir);
+        return 1;
+    }
+    struct stat st;
+    stat(snapshotFile.c_str(), &st);
+
+    printf("%d connectors, %d acls each: %zu bytes of xml, %lld bytes of snapshot\n", NUM_CONNECTORS, ACLS_PER_CONNECTOR,
+           xmlBytes, (long long)st.st_size);
+
+    double bestXml = 0;
+    double bestHeader = 0;
+    double bestSnapshot = 0;
+    size_t xmlLoaded = 0;
+    size_t headerLoaded = 0;
+    size_t snapshotLoaded = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int headerOnly = 0; headerOnly < 2; headerOnly++) {
+            double start = now();
+            size_t& loaded = headerOnly ? headerLoaded : xmlLoaded;
+            loaded = loadFromXml(appsDir, apps, acls, headerOnly);
+            double seconds = now() - start;
+            double& best = headerOnly ? bestHeader : bestXml;
+            if (round == 0 || seconds < best) {
+                best = seconds;
+            }
+            for (size_t conn = 0; conn < acls.size(); conn++) {
+                for (size_t acl = 0; acl < acls[conn].size(); acl++) {
+                    delete acls[conn][acl];
+                }
+            }
+            acls.clear();
+            deleteApps(apps);
+        }
+
+        double start = now();
+        snapshotLoaded = loadFromSnapshot(snapshotFile, apps);
+        double seconds = now() - start;
+        if (round == 0 || seconds < bestSnapshot) {
+            bestSnapshot = seconds;
+        }
+        deleteApps(apps);
+    }
+
+    printf("%-10s %6zu acls %10.2f ms\n", "xml", xmlLoaded, bestXml * 1000);
+    printf("%-10s %6zu acls %10.2f ms (%.1fx)\n", "header", headerLoaded, bestHeader * 1000,
+           bestHeader > 0 ? bestXml / bestHeader : 0);
+    printf("%-10s %6zu acls %10.2f ms (%.1fx)\n", "snapshot", snapshotLoaded, bestSnapshot * 1000,
+           bestSnapshot > 0 ? bestXml / bestSnapshot : 0);
+
+    //touching one acl makes the snapshot stale
+    utimes((appsDir + "/conn0/acls/acl0").c_str(), NULL);
+    GatewaySnapshot staleSnapshot;
+    printf("snapshot after an acl changed: %s\n", staleSnapshot.load(snapshotFile) == ER_OK ? "used" : "rejected");
+
+    removeTree(baseDir);
+    return 0;
+}
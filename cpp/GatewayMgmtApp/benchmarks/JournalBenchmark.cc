@@ -0,0 +1,151 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <alljoyn/gateway/GatewayJournal.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include <alljoyn/gateway/GatewayStats.h>
+
+/**
+ * Compares Acl updates written as whole files with updates appended to the journal,
+ * with 1, 4 and 16 threads updating their own Acl files at once. Every update commits
+ * an Acl sized file and the Metadata file together, like UpdateAcl does
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int THREADS[] = { 1, 4, 16 };
+static const int UPDATES_PER_THREAD = 100;
+static const size_t ACL_SIZE = 4096;
+static const size_t METADATA_SIZE = 1024;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct Worker {
+    pthread_t thread;
+    int index;
+    qcc::String dirName;
+    GatewayJournal* journal;
+};
+
+static void* updateAcls(void* arg)
+{
+    Worker* worker = (Worker*)arg;
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "/acl%d", worker->index);
+    qcc::String aclData(ACL_SIZE, 'a');
+    qcc::String metadataData(METADATA_SIZE, 'm');
+
+    for (int update = 0; update < UPDATES_PER_THREAD; update++) {
+        GatewayPersistenceBatch batch(worker->journal);
+        batch.stage(worker->dirName + fileName, aclData.data(), aclData.size());
+        batch.stage(worker->dirName + "/Metadata.xml", metadataData.data(), metadataData.size());
+        if (batch.commit() != ER_OK) {
+            printf("Commit failed\n");
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void removeDirectory(qcc::String const& dirName)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlink((dirName + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+static void run(const char* name, qcc::String const& dirName, int numThreads, GatewayJournal* journal)
+{
+    uint64_t countersBefore[GW_STAT_NUM_COUNTERS];
+    uint64_t countersAfter[GW_STAT_NUM_COUNTERS];
+    GatewayStats::Histogram histograms[GW_LATENCY_NUM_HISTOGRAMS];
+    uint64_t elapsedMs;
+    GatewayStats::getInstance()->getSnapshot(countersBefore, histograms, &elapsedMs);
+
+    Worker* workers = new Worker[numThreads];
+    double start = now();
+    for (int i = 0; i < numThreads; i++) {
+        workers[i].index = i;
+        workers[i].dirName = dirName;
+        workers[i].journal = journal;
+        pthread_create(&workers[i].thread, NULL, updateAcls, &workers[i]);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    double seconds = now() - start;
+    delete [] workers;
+
+    GatewayStats::getInstance()->getSnapshot(countersAfter, histograms, &elapsedMs);
+    int updates = numThreads * UPDATES_PER_THREAD;
+    printf("%-8s %3d threads %6d updates %10.0f /sec %6llu syncs\n", name, numThreads, updates, updates / seconds,
+           (unsigned long long)(countersAfter[GW_STAT_JOURNAL_SYNCS] - countersBefore[GW_STAT_JOURNAL_SYNCS]));
+}
+
+int main()
+{
+    char baseDir[] = "/tmp/gwJournalXXXXXX";
+    if (!mkdtemp(baseDir)) {
+        printf("Could not create a temporary directory\n");
+        return 1;
+    }
+    qcc::String dirName = qcc::String(baseDir) + "/acls";
+    qcc::String journalFile = qcc::String(baseDir) + "/gwagent.journal";
+    mkdir(dirName.c_str(), 0755);
+
+    for (size_t i = 0; i < sizeof(THREADS) / sizeof(THREADS[0]); i++) {
+        run("files", dirName, THREADS[i], NULL);
+
+        //compaction is left to the end so it does not run during the measurement
+        GatewayJournal journal(journalFile, (size_t)-1, 3600 * 1000);
+        if (journal.init() != ER_OK) {
+            printf("Could not open the journal\n");
+            break;
+        }
+        run("journal", dirName, THREADS[i], &journal);
+        double start = now();
+        journal.shutdown();
+        printf("%-8s %3d threads compaction %.2f ms\n", "journal", THREADS[i], (now() - start) * 1000);
+    }
+
+    removeDirectory(dirName);
+    unlink(journalFile.c_str());
+    rmdir(baseDir);
+    return 0;
+}
@@ -0,0 +1,206 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/gateway/GatewayPolicyEvaluator.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+
+/**
+ * Generates the policy files of growing numbers of connectors, acls and remoted apps with
+ * GatewayRouterPolicyManager, loads them back with GatewayPolicyEvaluator and reports the
+ * number of decisions per second for a mix of allowed and denied messages.
+ * The config reload fails without a routing node - the files are written before it
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int NUM_DECISIONS = 2000000;
+
+typedef struct {
+    int connectors;
+    int aclsPerConnector;
+    int remotedAppsPerAcl;
+} Scale;
+
+static const Scale SCALES[] = { { 1, 1, 1 }, { 10, 5, 5 }, { 50, 10, 10 }, { 100, 10, 20 } };
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static qcc::String format(const char* fmt, int value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), fmt, value);
+    return buffer;
+}
+
+static GatewayAppIdentifier remoteApp(int app)
+{
+    uint8_t appId[16];
+    memset(appId, 0, sizeof(appId));
+    memcpy(appId, &app, sizeof(app));
+    return GatewayAppIdentifier(appId, sizeof(appId), format("device%d", app));
+}
+
+static void announce(GatewayRouterPolicyManager& policyManager, int app)
+{
+    uint8_t appId[16];
+    memset(appId, 0, sizeof(appId));
+    memcpy(appId, &app, sizeof(app));
+    qcc::String deviceId = format("device%d", app);
+
+    MsgArg appIdArg("ay", sizeof(appId), appId);
+    MsgArg languageArg("s", "en");
+    MsgArg deviceIdArg("s", deviceId.c_str());
+    MsgArg fields[3];
+    fields[0].Set("{sv}", "AppId", &appIdArg);
+    fields[1].Set("{sv}", "DefaultLanguage", &languageArg);
+    fields[2].Set("{sv}", "DeviceId", &deviceIdArg);
+    MsgArg aboutDataArg("a{sv}", 3, fields);
+    MsgArg objectDescs;
+
+    policyManager.Announced(format(":remote%d.1", app).c_str(), 1, 0, objectDescs, aboutDataArg);
+}
+
+static GatewayRuleObjectDescriptions objectRules(int index)
+{
+    std::vector<qcc::String> interfaces;
+    interfaces.push_back(format("org.example.Interface%d", index));
+    interfaces.push_back(format("org.example.Other%d", index));
+
+    GatewayRuleObjectDescriptions objects;
+    objects.push_back(GatewayRuleObjectDescription(format("/org/example/object%d", index), false, interfaces));
+    objects.push_back(GatewayRuleObjectDescription(format("/org/example/prefix%d", index), true, std::vector<qcc::String>()));
+    return objects;
+}
+
+static void removeDirectory(qcc::String const& dirName)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlink((dirName + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+static void runScale(Scale const& scale, qcc::String const& baseDir)
+{
+    qcc::String policyFile = baseDir + "/gwagent.conf";
+    qcc::String appPolicyDir = baseDir + "/apps";
+    mkdir(appPolicyDir.c_str(), 0755);
+
+    GatewayRouterPolicyManager policyManager;
+    policyManager.setGatewayPolicyFile(policyFile.c_str());
+    policyManager.setAppPolicyDirectory(appPolicyDir.c_str());
+
+    int app = 0;
+    for (int conn = 0; conn < scale.connectors; conn++) {
+        std::vector<GatewayAclRules> acls;
+        for (int acl = 0; acl < scale.aclsPerConnector; acl++) {
+            GatewayAclRules rules;
+            rules.setExposedServicesRules(objectRules(acl));
+            GatewayRemoteAppRules remoteAppRules;
+            for (int remote = 0; remote < scale.remotedAppsPerAcl; remote++, app++) {
+                announce(policyManager, app);
+                remoteAppRules[remoteApp(app)] = objectRules(remote);
+            }
+            rules.setRemoteAppRules(remoteAppRules);
+            acls.push_back(rules);
+        }
+        policyManager.addConnectorAppRules(format("conn%d", conn), acls);
+    }
+    policyManager.commit();
+
+    GatewayPolicyEvaluator evaluator;
+    if (evaluator.loadPolicies(policyFile) != ER_OK) {
+        printf("Could not load the generated policies\n");
+        removeDirectory(appPolicyDir);
+        unlink(policyFile.c_str());
+        return;
+    }
+
+    //one allowed and one denied message in each direction, spread over the connectors
+    std::vector<GatewayPolicyEvaluator::Query> queries;
+    int appsPerConnector = scale.aclsPerConnector * scale.remotedAppsPerAcl;
+    for (int conn = 0; conn < scale.connectors; conn++) {
+        GatewayPolicyEvaluator::Query query;
+        query.user = format("conn%d", conn);
+        query.direction = GatewayPolicyEvaluator::GW_PD_SEND;
+        query.type = GatewayPolicyEvaluator::GW_PT_METHOD_CALL;
+        query.path = format("/org/example/prefix%d/light", scale.remotedAppsPerAcl - 1);
+        query.peer = format(":remote%d.1", conn * appsPerConnector + appsPerConnector - 1);
+        queries.push_back(query);
+        query.path = "/org/example/unknown";
+        queries.push_back(query);
+
+        query.direction = GatewayPolicyEvaluator::GW_PD_RECEIVE;
+        query.path = format("/org/example/object%d", scale.aclsPerConnector - 1);
+        query.interfaceName = format("org.example.Interface%d", scale.aclsPerConnector - 1);
+        query.peer = "";
+        queries.push_back(query);
+        query.interfaceName = "org.example.Unknown";
+        queries.push_back(query);
+    }
+
+    uint32_t allowed = 0;
+    double start = now();
+    for (int i = 0; i < NUM_DECISIONS; i++) {
+        allowed += evaluator.isAllowed(queries[i % queries.size()]);
+    }
+    double seconds = now() - start;
+
+    printf("%4d connectors %3d acls %3d remoted apps: %7u rules %12.0f decisions/sec (%u%% allowed)\n",
+           scale.connectors, scale.aclsPerConnector, scale.remotedAppsPerAcl, (uint32_t)evaluator.getNumRules(),
+           NUM_DECISIONS / seconds, (uint32_t)(allowed * 100.0 / NUM_DECISIONS));
+
+    removeDirectory(appPolicyDir);
+    unlink(policyFile.c_str());
+}
+
+int main()
+{
+    char baseDir[] = "/tmp/gwPolicyBenchmarkXXXXXX";
+    if (!mkdtemp(baseDir)) {
+        printf("Could not create a temporary directory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(SCALES) / sizeof(SCALES[0]); i++) {
+        runScale(SCALES[i], baseDir);
+    }
+    rmdir(baseDir);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+
+/**
+ * Times the full commit done at startup, writing the policy files of a growing number
+ * of connectors with 1, 2, 4 and one thread per core. Every run writes into an empty
+ * directory so no file is skipped as unchanged. The config reload fails without a
+ * routing node - the files are written before it
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int CONNECTORS[] = { 16, 64, 256 };
+static const int ACLS_PER_CONNECTOR = 5;
+static const int REMOTED_APPS_PER_ACL = 10;
+static const int NUM_RUNS = 3;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static qcc::String format(const char* fmt, int value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), fmt, value);
+    return buffer;
+}
+
+static GatewayAppIdentifier remoteApp(int app, uint8_t* appId, size_t appIdLen)
+{
+    memset(appId, 0, appIdLen);
+    memcpy(appId, &app, sizeof(app));
+    return GatewayAppIdentifier(appId, appIdLen, format("device%d", app));
+}
+
+static void announce(GatewayRouterPolicyManager& policyManager, int app)
+{
+    uint8_t appId[16];
+    remoteApp(app, appId, sizeof(appId));
+    qcc::String deviceId = format("device%d", app);
+
+    MsgArg appIdArg("ay", sizeof(appId), appId);
+    MsgArg languageArg("s", "en");
+    MsgArg deviceIdArg("s", deviceId.c_str());
+    MsgArg fields[3];
+    fields[0].Set("{sv}", "AppId", &appIdArg);
+    fields[1].Set("{sv}", "DefaultLanguage", &languageArg);
+    fields[2].Set("{sv}", "DeviceId", &deviceIdArg);
+    MsgArg aboutDataArg("a{sv}", 3, fields);
+    MsgArg objectDescs;
+
+    policyManager.Announced(format(":remote%d.1", app).c_str(), 1, 0, objectDescs, aboutDataArg);
+}
+
+static GatewayRuleObjectDescriptions objectRules(int index)
+{
+    std::vector<qcc::String> interfaces;
+    interfaces.push_back(format("org.example.Interface%d", index));
+    interfaces.push_back(format("org.example.Other%d", index));
+
+    GatewayRuleObjectDescriptions objects;
+    objects.push_back(GatewayRuleObjectDescription(format("/org/example/object%d", index), false, interfaces));
+    objects.push_back(GatewayRuleObjectDescription(format("/org/example/prefix%d", index), true, std::vector<qcc::String>()));
+    return objects;
+}
+
+static void removeDirectory(qcc::String const& dirName)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlink((dirName + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+static double timeStartupCommit(int connectors, uint32_t threads, qcc::String const& baseDir)
+{
+    qcc::String policyFile = baseDir + "/gwagent.conf";
+    qcc::String appPolicyDir = baseDir + "/apps";
+    mkdir(appPolicyDir.c_str(), 0755);
+
+    GatewayRouterPolicyManager policyManager;
+    policyManager.setGatewayPolicyFile(policyFile.c_str());
+    policyManager.setAppPolicyDirectory(appPolicyDir.c_str());
+    policyManager.setPolicyWriterThreads(threads);
+
+    int app = 0;
+    for (int conn = 0; conn < connectors; conn++) {
+        std::vector<GatewayAclRules> acls;
+        for (int acl = 0; acl < ACLS_PER_CONNECTOR; acl++) {
+            GatewayAclRules rules;
+            rules.setExposedServicesRules(objectRules(acl));
+            GatewayRemoteAppRules remoteAppRules;
+            for (int remote = 0; remote < REMOTED_APPS_PER_ACL; remote++, app++) {
+                uint8_t appId[16];
+                announce(policyManager, app);
+                remoteAppRules[remoteApp(app, appId, sizeof(appId))] = objectRules(remote);
+            }
+            rules.setRemoteAppRules(remoteAppRules);
+            acls.push_back(rules);
+        }
+        policyManager.addConnectorAppRules(format("conn%d", conn), acls);
+    }
+
+    double start = now();
+    policyManager.commit();
+    double seconds = now() - start;
+
+    removeDirectory(appPolicyDir);
+    unlink(policyFile.c_str());
+    return seconds;
+}
+
+int main()
+{
+    char baseDir[] = "/tmp/gwStartupBenchmarkXXXXXX";
+    if (!mkdtemp(baseDir)) {
+        printf("Could not create a temporary directory\n");
+        return 1;
+    }
+
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    std::vector<uint32_t> threadCounts;
+    threadCounts.push_back(1);
+    threadCounts.push_back(2);
+    threadCounts.push_back(4);
+    if (numCores > 4) {
+        threadCounts.push_back((uint32_t)numCores);
+    }
+    printf("%ld cores, %d acls of %d remoted apps per connector, best of %d runs\n", numCores, ACLS_PER_CONNECTOR,
+           REMOTED_APPS_PER_ACL, NUM_RUNS);
+
+    for (size_t i = 0; i < sizeof(CONNECTORS) / sizeof(CONNECTORS[0]); i++) {
+        double serialSeconds = 0;
+        for (size_t t = 0; t < threadCounts.size(); t++) {
+            double best = 0;
+            for (int run = 0; run < NUM_RUNS; run++) {
+                double seconds = timeStartupCommit(CONNECTORS[i], threadCounts[t], baseDir);
+                if (!run || seconds < best) {
+                    best = seconds;
+                }
+            }
+            if (!t) {
+                serialSeconds = best;
+            }
+            printf("%4d connectors %3u threads: %9.2f ms %6.2fx\n", CONNECTORS[i], threadCounts[t], best * 1000,
+                   serialSeconds / best);
+        }
+    }
+    rmdir(baseDir);
+    return 0;
+}
@@ -0,0 +1,309 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <alljoyn/gateway/GatewayAcl.h>
+#include <alljoyn/gateway/GatewayConnectorApp.h>
+#include <alljoyn/gateway/GatewayConnectorAppManager.h>
+
+/**
+ * Measures parsing the Manifests and Acls of the installed apps at startup with a
+ * growing number of worker threads. One app has a malformed Manifest and one Acl is
+ * malformed, which must only drop that app and that Acl. The Acls alone are then loaded
+ * again into the loaded apps, which shows how the Acl parsing scales by itself. The apps
+ * directory is laid out in a temporary directory. The Manifests are validated against the
+ * installed schema. The thread counts go up to the number of cores, or to the first argument
+ */
+
+using namespace ajn;
+using namespace ajn::gw;
+
+static const int NUM_CONNECTORS = 300;
+static const int ACLS_PER_CONNECTOR = 10;
+static const int OBJECTS_PER_ACL = 5;
+static const int REMOTED_APPS_PER_ACL = 4;
+static const int ROUNDS = 3;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static qcc::String format(const char* fmt, int value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), fmt, value);
+    return buffer;
+}
+
+static qcc::String objectsXml(int index)
+{
+    qcc::String xml;
+    for (int obj = 0; obj < OBJECTS_PER_ACL; obj++) {
+        xml += "<object><path>" + format("/org/example/object%d", index * OBJECTS_PER_ACL + obj) + "</path>";
+        xml += "<isPrefix>false</isPrefix><interfaces>";
+        xml += "<interface>" + format("org.example.Interface%d", obj) + "</interface>";
+        xml += "<interface>org.example.Common</interface></interfaces></object>";
+    }
+    return xml;
+}
+
+static qcc::String manifestObjectsXml(int index)
+{
+    qcc::String xml;
+    for (int obj = 0; obj < OBJECTS_PER_ACL; obj++) {
+        xml += "<object name=\"" + format("object%d", obj) + "\">";
+        xml += "<path>" + format("/org/example/object%d", index * OBJECTS_PER_ACL + obj) + "</path>";
+        xml += "<isPrefix>false</isPrefix><interfaces>";
+        xml += "<interface name=\"example\">" + format("org.example.Interface%d", obj) + "</interface>";
+        xml += "</interfaces></object>";
+    }
+    return xml;
+}
+
+static qcc::String manifestXml(int conn)
+{
+    qcc::String xml = "<?xml version=\"1.0\"?>\n<manifest xmlns=\"http://www.alljoyn.org/gateway/manifest\">";
+    xml += "<connectorId>" + format("conn%d", conn) + "</connectorId>";
+    xml += "<friendlyName>" + format("Connector %d", conn) + "</friendlyName>";
+    xml += "<packageName>" + format("conn%d_1.0.0_ar71xx.ipk", conn) + "</packageName>";
+    xml += "<version>1.0.0</version><minAjSdkVersion>14.12</minAjSdkVersion>";
+    xml += "<exposedServices>" + manifestObjectsXml(conn) + "</exposedServices>";
+    xml += "<remotedServices><object name=\"all\"><path>/</path><isPrefix>true</isPrefix><interfaces>";
+    xml += "<interface name=\"about\">org.alljoyn.About</interface>";
+    xml += "<interface name=\"notification\">org.alljoyn.Notification</interface>";
+    xml += "</interfaces></object></remotedServices>";
+    xml += "<executionInfo><executable>connector</executable><env_variables>";
+    xml += "<variable name=\"ER_DEBUG\">0</variable></env_variables><arguments></arguments></executionInfo>";
+    xml += "</manifest>\n";
+    return xml;
+}
+
+static qcc::String aclXml(int acl)
+{
+    qcc::String xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<Acl>";
+    xml += "<name>" + format("acl%d", acl) + "</name><status>" + format("%d", acl % 2) + "</status>";
+    xml += "<exposedServices>" + objectsXml(acl) + "</exposedServices><remotedApps>";
+    for (int remote = 0; remote < REMOTED_APPS_PER_ACL; remote++) {
+        xml += "<device><deviceId>" + format("device%d", remote) + "</deviceId>";
+        xml += "<appId>" + format("%032x", remote + 1) + "</appId>";
+        xml += "<objects>" + objectsXml(remote) + "</objects></device>";
+    }
+    xml += "</remotedApps><customMetadata></customMetadata></Acl>\n";
+    return xml;
+}
+
+static void writeFile(qcc::String const& fileName, qcc::String const& content)
+{
+    std::ofstream ofs(fileName.c_str());
+    ofs << content.c_str();
+}
+
+static void removeTree(qcc::String const& dirName)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        qcc::String path = dirName + "/" + entry->d_name;
+        if (entry->d_type == DT_DIR) {
+            removeTree(path);
+        } else {
+            unlink(path.c_str());
+        }
+    }
+    closedir(dir);
+    rmdir(dirName.c_str());
+}
+
+/**
+ * Summarize the loaded apps as their connectorIds and numbers of Acls, which must not
+ * depend on the number of threads
+ */
+static qcc::String describeApps(std::map<qcc::String, GatewayConnectorApp*> const& apps, size_t* numAcls)
+{
+    qcc::String description;
+    *numAcls = 0;
+    std::map<qcc::String, GatewayConnectorApp*>::const_iterator it;
+    for (it = apps.begin(); it != apps.end(); it++) {
+        description += it->first + format(":%d,", (int)it->second->getAcls().size());
+        *numAcls += it->second->getAcls().size();
+    }
+    return description;
+}
+
+/**
+ * Loads one Acl file of the loaded apps per item
+ */
+class LoadAclsTask : public GatewayWorkerTask {
+
+  public:
+
+    LoadAclsTask(qcc::String const& appsDir, std::map<qcc::String, GatewayConnectorApp*> const& apps)
+    {
+        std::map<qcc::String, GatewayConnectorApp*>::const_iterator it;
+        for (it = apps.begin(); it != apps.end(); it++) {
+            for (int acl = 0; acl < ACLS_PER_CONNECTOR; acl++) {
+                m_Apps.push_back(it->second);
+                m_AclIds.push_back(format("acl%d", acl));
+                m_FileNames.push_back(appsDir + "/" + it->second->getAppName() + "/acls/" + m_AclIds.back());
+            }
+        }
+        m_Acls.resize(m_AclIds.size(), NULL);
+    }
+
+    ~LoadAclsTask()
+    {
+        for (size_t indx = 0; indx < m_Acls.size(); indx++) {
+            delete m_Acls[indx];
+        }
+    }
+
+    void execute(size_t taskIndex, size_t workerIndex)
+    {
+        QCC_UNUSED(workerIndex);
+        m_Acls[taskIndex] = new GatewayAcl(m_AclIds[taskIndex], m_Apps[taskIndex]);
+        m_Acls[taskIndex]->loadFromFile(m_FileNames[taskIndex]);
+    }
+
+    size_t size() const
+    {
+        return m_AclIds.size();
+    }
+
+  private:
+    std::vector<GatewayConnectorApp*> m_Apps;
+    std::vector<qcc::String> m_AclIds;
+    std::vector<qcc::String> m_FileNames;
+    std::vector<GatewayAcl*> m_Acls;
+};
+
+static void deleteApps(std::map<qcc::String, GatewayConnectorApp*>& apps)
+{
+    std::map<qcc::String, GatewayConnectorApp*>::iterator it;
+    for (it = apps.begin(); it != apps.end(); it++) {
+        delete it->second;
+    }
+    apps.clear();
+}
+
+int main(int argc, char** argv)
+{
+    char baseDir[] = "/tmp/gwStartupParseXXXXXX";
+    if (!mkdtemp(baseDir)) {
+        printf("Could not create a temporary directory\n");
+        return 1;
+    }
+    qcc::String appsDir = baseDir;
+
+    for (int conn = 0; conn < NUM_CONNECTORS; conn++) {
+        qcc::String appDir = appsDir + "/" + format("conn%d", conn);
+        mkdir(appDir.c_str(), 0755);
+        mkdir((appDir + "/acls").c_str(), 0755);
+        writeFile(appDir + "/Manifest.xml", conn == 1 ? qcc::String("<manifest><connectorId>") : manifestXml(conn));
+        for (int acl = 0; acl < ACLS_PER_CONNECTOR; acl++) {
+            qcc::String xml = conn == 2 && acl == 0 ? qcc::String("<Acl><name>broken") : aclXml(acl);
+            writeFile(appDir + "/acls/" + format("acl%d", acl), xml);
+        }
+    }
+
+    //created before the workers look it up
+    GatewayMgmt::getInstance();
+
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    long maxThreads = argc > 1 ? atol(argv[1]) : numCores;
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < (size_t)maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    printf("%d connectors, %d acls each, %ld cores\n", NUM_CONNECTORS, ACLS_PER_CONNECTOR, numCores);
+
+    double baseline = 0;
+    double aclBaseline = 0;
+    qcc::String expected;
+    for (size_t indx = 0; indx < threadCounts.size(); indx++) {
+        GatewayWorkerPool workerPool(threadCounts[indx]);
+        double best = 0;
+        double aclBest = 0;
+        size_t numAcls = 0;
+        size_t numApps = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            std::map<qcc::String, GatewayConnectorApp*> apps;
+            double start = now();
+            GatewayConnectorAppManager::loadConnectorApps(appsDir, workerPool, apps);
+            double seconds = now() - start;
+            if (round == 0 || seconds < best) {
+                best = seconds;
+            }
+
+            qcc::String description = describeApps(apps, &numAcls);
+            numApps = apps.size();
+            if (expected.empty()) {
+                expected = description;
+            } else if (description != expected) {
+                printf("%zu threads loaded different apps than 1 thread\n", threadCounts[indx]);
+            }
+
+            //the Acls are deleted before the apps they belong to
+            {
+                LoadAclsTask aclsTask(appsDir, apps);
+                start = now();
+                workerPool.run(aclsTask, aclsTask.size());
+                seconds = now() - start;
+                if (round == 0 || seconds < aclBest) {
+                    aclBest = seconds;
+                }
+            }
+            deleteApps(apps);
+        }
+
+        if (numApps == 0) {
+            printf("No app was loaded - is the manifest schema installed?\n");
+            removeTree(baseDir);
+            return 1;
+        }
+        if (indx == 0) {
+            baseline = best;
+            aclBaseline = aclBest;
+        }
+        printf("%3zu threads %5zu apps %6zu acls %10.2f ms (%.1fx)  acls only %10.2f ms (%.1fx)\n", threadCounts[indx],
+               numApps, numAcls, best * 1000, best > 0 ? baseline / best : 0, aclBest * 1000, aclBest > 0 ? aclBaseline / aclBest : 0);
+    }
+
+    removeTree(baseDir);
+    return 0;
+}
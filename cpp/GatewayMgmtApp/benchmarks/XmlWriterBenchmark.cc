@@ -0,0 +1,224 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <string>
+#include <alljoyn/gateway/GatewayXmlWriter.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <libxml/xmlwriter.h>
+
+/**
+ * Compares writing an Acl file of NUM_RULES rules with the libxml2 DOM writer
+ * (what the gateway used before) and with GatewayXmlWriter.
+ * Reports bytes/sec and number of heap allocations per document
+ */
+
+using namespace ajn::gw;
+
+static const int NUM_RULES = 500;
+static const int NUM_ITERATIONS = 200;
+static const char ACL_NAME[] = "benchmark & \"acl\"\t\r\n";
+static const char CONTROL_TEXT[] = "benchmark \x01 acl";
+
+static unsigned long s_Allocations = 0;
+
+void* operator new(size_t size)
+{
+    s_Allocations++;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) throw()
+{
+    free(ptr);
+}
+
+static void* countingMalloc(size_t size)
+{
+    s_Allocations++;
+    return malloc(size);
+}
+
+static void* countingRealloc(void* ptr, size_t size)
+{
+    s_Allocations++;
+    return realloc(ptr, size);
+}
+
+static char* countingStrdup(const char* str)
+{
+    s_Allocations++;
+    return strdup(str);
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void ruleValues(int rule, char* objectPath, char* interfaceName, size_t len)
+{
+    snprintf(objectPath, len, "/org/example/device%d/light", rule / 10);
+    snprintf(interfaceName, len, "org.example.Interface%d", rule);
+}
+
+static std::string writeWithLibxml()
+{
+    char objectPath[64];
+    char interfaceName[64];
+    std::string result;
+    xmlDocPtr doc = xmlNewDoc((xmlChar*)XML_DEFAULT_VERSION);
+    xmlTextWriterPtr writer = xmlNewTextWriterDoc(&doc, 0);
+
+    xmlTextWriterStartDocument(writer, NULL, NULL, NULL);
+    xmlTextWriterWriteComment(writer, (xmlChar*)"Benchmark Acl");
+    xmlTextWriterStartElement(writer, (xmlChar*)"Acl");
+    xmlTextWriterWriteAttribute(writer, (xmlChar*)"xmlns", (xmlChar*)"http://www.alljoyn.org/gateway/acl/sample");
+    xmlTextWriterWriteElement(writer, (xmlChar*)"name", (xmlChar*)ACL_NAME);
+    xmlTextWriterWriteElement(writer, (xmlChar*)"status", (xmlChar*)"1");
+    xmlTextWriterStartElement(writer, (xmlChar*)"exposedServices");
+    for (int rule = 0; rule < NUM_RULES; rule++) {
+        ruleValues(rule, objectPath, interfaceName, sizeof(objectPath));
+        xmlTextWriterStartElement(writer, (xmlChar*)"object");
+        xmlTextWriterWriteElement(writer, (xmlChar*)"path", (xmlChar*)objectPath);
+        xmlTextWriterWriteElement(writer, (xmlChar*)"isPrefix", (xmlChar*)(rule % 2 ? "true" : "false"));
+        xmlTextWriterStartElement(writer, (xmlChar*)"interfaces");
+        xmlTextWriterWriteElement(writer, (xmlChar*)"interface", (xmlChar*)interfaceName);
+        xmlTextWriterEndElement(writer);
+        xmlTextWriterEndElement(writer);
+    }
+    xmlTextWriterEndElement(writer);
+    xmlTextWriterStartElement(writer, (xmlChar*)"remotedApps");
+    xmlTextWriterEndElement(writer);
+    xmlTextWriterStartElement(writer, (xmlChar*)"customMetadata");
+    xmlTextWriterEndElement(writer);
+    xmlTextWriterEndDocument(writer);
+
+    xmlChar* content = NULL;
+    int size = 0;
+    xmlDocDumpFormatMemory(doc, &content, &size, 1);
+    if (content) {
+        result.assign((const char*)content, size);
+        xmlFree(content);
+    }
+    xmlFreeTextWriter(writer);
+    xmlFreeDoc(doc);
+    return result;
+}
+
+static void writeWithGatewayWriter(GatewayXmlWriter& writer)
+{
+    char objectPath[64];
+    char interfaceName[64];
+    writer.reset();
+
+    writer.startDocument();
+    writer.writeComment("Benchmark Acl");
+    writer.startElement("Acl");
+    writer.writeAttribute("xmlns", "http://www.alljoyn.org/gateway/acl/sample");
+    writer.writeElement("name", ACL_NAME);
+    writer.writeElement("status", "1");
+    writer.startElement("exposedServices");
+    for (int rule = 0; rule < NUM_RULES; rule++) {
+        ruleValues(rule, objectPath, interfaceName, sizeof(objectPath));
+        writer.startElement("object");
+        writer.writeElement("path", objectPath);
+        writer.writeElement("isPrefix", rule % 2 ? "true" : "false");
+        writer.startElement("interfaces");
+        writer.writeElement("interface", interfaceName);
+        writer.endElement();
+        writer.endElement();
+    }
+    writer.endElement();
+    writer.startElement("remotedApps");
+    writer.endElement();
+    writer.startElement("customMetadata");
+    writer.endElement();
+    writer.endDocument();
+}
+
+static void report(const char* name, size_t bytes, double seconds, unsigned long allocations)
+{
+    printf("%-18s %8.1f MB/s %10.1f allocations/document\n", name,
+           (double)bytes * NUM_ITERATIONS / seconds / (1024 * 1024), (double)allocations / NUM_ITERATIONS);
+}
+
+int main()
+{
+    xmlMemSetup(free, countingMalloc, countingRealloc, countingStrdup);
+    xmlInitParser();
+
+    std::string reference = writeWithLibxml();
+    GatewayXmlWriter writer;
+    writeWithGatewayWriter(writer);
+    if (reference.size() != writer.getSize() || memcmp(reference.data(), writer.getData(), writer.getSize()) != 0) {
+        printf("Output of GatewayXmlWriter differs from libxml2\n");
+        return 1;
+    }
+
+    //XML 1.0 can't represent the other C0 controls - they must be rejected, not written raw
+    GatewayXmlWriter controlWriter;
+    controlWriter.startDocument();
+    controlWriter.startElement("Acl");
+    if (controlWriter.writeAttribute("name", CONTROL_TEXT) >= 0 || controlWriter.writeElement("name", CONTROL_TEXT) >= 0) {
+        printf("GatewayXmlWriter wrote a control character\n");
+        return 1;
+    }
+    controlWriter.endDocument();
+    xmlDocPtr parsed = xmlReadMemory(controlWriter.getData(), controlWriter.getSize(), NULL, NULL, XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+    if (!parsed) {
+        printf("Output of GatewayXmlWriter is not well formed after rejecting a control character\n");
+        return 1;
+    }
+    xmlFreeDoc(parsed);
+    printf("Acl with %d rules: %u bytes, %d iterations\n", NUM_RULES, (unsigned)reference.size(), NUM_ITERATIONS);
+
+    s_Allocations = 0;
+    double start = now();
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        writeWithLibxml();
+    }
+    report("libxml2", reference.size(), now() - start, s_Allocations);
+
+    s_Allocations = 0;
+    start = now();
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        GatewayXmlWriter freshWriter;
+        writeWithGatewayWriter(freshWriter);
+    }
+    report("GatewayXmlWriter", writer.getSize(), now() - start, s_Allocations);
+
+    s_Allocations = 0;
+    start = now();
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        writeWithGatewayWriter(writer);
+    }
+    report("  (reused)", writer.getSize(), now() - start, s_Allocations);
+
+    xmlCleanupParser();
+    return 0;
+}
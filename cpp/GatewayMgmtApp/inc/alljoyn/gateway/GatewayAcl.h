@@ -19,8 +19,11 @@
 
 #include <alljoyn/gateway/GatewayAclRules.h>
 #include <alljoyn/gateway/GatewayEnums.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
+#include <alljoyn/gateway/GatewayXmlWriter.h>
 #include <libxml/tree.h>
-#include <libxml/xmlwriter.h>
+#include <list>
 
 namespace ajn {
 namespace gw {
@@ -67,11 +70,53 @@ class GatewayAcl {
      */
     QStatus loadFromFile(qcc::String const& fileName);
 
+    /**
+     * Load only the name and status of this Acl from a file. The rules and
+     * customMetadata are parsed on first access
+     * @param fileName - file used to parse
+     * @return status - success/failure
+     */
+    QStatus loadHeaderFromFile(qcc::String const& fileName);
+
     /**
      * Write the Acl to its file
+     * @param batch - optional. batch to stage the file in. If not set the file is written immediately
      * @return status - success/failure
      */
-    QStatus writeToFile();
+    QStatus writeToFile(GatewayPersistenceBatch* batch = NULL);
+
+    /**
+     * Append the values of this Acl to a snapshot
+     * @param snapshot - the snapshot
+     */
+    void writeSnapshot(GatewaySnapshot& snapshot) const;
+
+    /**
+     * Load the values of this Acl from a snapshot instead of its file.
+     * Does not count the references to the remoted apps in the MetadataManager
+     * @param snapshot - the snapshot
+     * @return true if the Acl was read
+     */
+    bool readSnapshot(GatewaySnapshot& snapshot);
+
+    /**
+     * Count the references of the loaded rules to the remoted apps in the
+     * MetadataManager. Does nothing if they were counted already
+     */
+    void countReferences();
+
+    /**
+     * Mark the rules staged by the last writeToFile as persisted, which lets them
+     * be evicted while the Acl is inactive
+     */
+    void setBodyPersisted();
+
+    /**
+     * Are the references of all Acls to the remoted apps counted. False while
+     * Acls exist whose rules were never parsed
+     * @return referencesCounted
+     */
+    static bool referencesCounted();
 
     /**
      * Initialize this Acl
@@ -88,10 +133,17 @@ class GatewayAcl {
     QStatus shutdown(BusAttachment* bus);
 
     /**
-     * Get the rules of the Acl
+     * Get the rules of the Acl. Parses them if they are not loaded
      * @return AclRules
      */
-    const GatewayAclRules& getAclRules() const;
+    GatewayAclRules getAclRules();
+
+    /**
+     * Get the revision of the rules of the Acl. Changes whenever the rules change
+     * and is unique across all Acls
+     * @return revision
+     */
+    uint64_t getRevision() const;
 
     /**
      * Get the AclId of the Acl
@@ -118,10 +170,10 @@ class GatewayAcl {
     const qcc::String& getObjectPath() const;
 
     /**
-     * Get the CustomMetadata map of the Acl
+     * Get the CustomMetadata map of the Acl. Parses it if it is not loaded
      * @return CustomMetadata
      */
-    const std::map<qcc::String, qcc::String>& getCustomMetadata() const;
+    std::map<qcc::String, qcc::String> getCustomMetadata();
 
     /**
      * Update the Acl
@@ -177,6 +229,11 @@ class GatewayAcl {
      */
     GatewayAclRules m_AclRules;
 
+    /**
+     * The revision of m_AclRules
+     */
+    uint64_t m_Revision;
+
     /**
      * The AclStatus of the Acl
      */
@@ -197,6 +254,86 @@ class GatewayAcl {
      */
     GatewayConnectorApp* m_ConnectorApp;
 
+    /**
+     * Whether m_AclRules and m_CustomMetadata are loaded
+     */
+    bool m_BodyLoaded;
+
+    /**
+     * Whether the references of the rules to the remoted apps are counted
+     */
+    bool m_ReferencesCounted;
+
+    /**
+     * Number of changes made to the Acl in memory
+     */
+    uint64_t m_Changes;
+
+    /**
+     * Number of changes written by the last writeToFile
+     */
+    uint64_t m_StagedChanges;
+
+    /**
+     * Number of changes known to be persisted
+     */
+    uint64_t m_PersistedChanges;
+
+    /**
+     * Position in the LRU list of the loaded rules of inactive Acls. The end of the
+     * list if the rules are not loaded or the Acl is active
+     */
+    std::list<GatewayAcl*>::iterator m_LruPosition;
+
+    /**
+     * Get the file of the Acl
+     * @return fileName
+     */
+    qcc::String getFileName() const;
+
+    /**
+     * Parse the content of an Acl file. Does not touch the Acl, so it needs no lock
+     * @param content - the xml
+     * @param aclName - filled with the name. NULL to skip the name
+     * @param aclStatus - filled with the status. NULL to skip the status
+     * @param exposedServices - filled with the exposed services rules
+     * @param remoteAppRules - filled with the remoted apps rules
+     * @param customMetadata - filled with the customMetadata
+     * @return status - success/failure
+     */
+    QStatus parseContent(std::string const& content, qcc::String* aclName, AclStatus* aclStatus,
+                         GatewayRuleObjectDescriptions* exposedServices, GatewayRemoteAppRules* remoteAppRules,
+                         std::map<qcc::String, qcc::String>* customMetadata);
+
+    /**
+     * Load the rules and customMetadata if they are not loaded and mark them as
+     * accessed. Called with the body lock held
+     * @return status - success/failure
+     */
+    QStatus touchBody();
+
+    /**
+     * Drop the rules and customMetadata. Called with the body lock held
+     */
+    void unloadBody();
+
+    /**
+     * Move the Acl to the front of the LRU list if its rules are loaded and it is
+     * inactive, otherwise take it out. Called with the body lock held
+     */
+    void updateLruPosition();
+
+    /**
+     * Evict the least recently used inactive rules beyond the configured limit.
+     * Called with the body lock held
+     */
+    static void evictBodies();
+
+    /**
+     * Count the references of the rules to the remoted apps. Called with the body lock held
+     */
+    void countReferencesLocked();
+
     /**
      * Parse Metadata - helper function to parse an xml
      * @param currentKey - current key in the xml
@@ -224,7 +361,7 @@ class GatewayAcl {
      * @param objects - the gateway Objects to write
      * @return rc - success/failure
      */
-    int writeObjectsToFile(xmlTextWriterPtr writer, const GatewayRuleObjectDescriptions& objects);
+    int writeObjectsToFile(GatewayXmlWriter& writer, const GatewayRuleObjectDescriptions& objects);
 
     /**
      * Helper function to write remotePermissions to a file
@@ -232,7 +369,22 @@ class GatewayAcl {
      * @param remoteAppRules - the gateway remoteAppRules to write
      * @return rc - success/failure
      */
-    int writeRemotedAppsToFile(xmlTextWriterPtr writer, const GatewayRemoteAppRules& remoteAppRules);
+    int writeRemotedAppsToFile(GatewayXmlWriter& writer, const GatewayRemoteAppRules& remoteAppRules);
+
+    /**
+     * Helper function to append Objects to a snapshot
+     * @param snapshot - the snapshot
+     * @param objects - the gateway Objects to write
+     */
+    static void writeObjectsToSnapshot(GatewaySnapshot& snapshot, const GatewayRuleObjectDescriptions& objects);
+
+    /**
+     * Helper function to read Objects from a snapshot
+     * @param snapshot - the snapshot
+     * @param objects - filled with the gateway Objects
+     * @return true if the Objects were read
+     */
+    static bool readObjectsFromSnapshot(GatewaySnapshot& snapshot, GatewayRuleObjectDescriptions& objects);
 
 };
 
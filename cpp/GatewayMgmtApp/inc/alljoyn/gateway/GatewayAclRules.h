@@ -44,6 +44,30 @@ class GatewayAclRules {
      */
     virtual ~GatewayAclRules();
 
+    /**
+     * Get the id of the Acl the rules belong to
+     * @return aclId - empty for rules merged from several Acls
+     */
+    const qcc::String& getAclId() const;
+
+    /**
+     * Set the id of the Acl the rules belong to
+     * @param aclId
+     */
+    void setAclId(const qcc::String& aclId);
+
+    /**
+     * Get the revision of the rules
+     * @return revision - 0 if unknown
+     */
+    uint64_t getRevision() const;
+
+    /**
+     * Set the revision of the rules
+     * @param revision
+     */
+    void setRevision(uint64_t revision);
+
     /**
      * Get the ExposedServicesRules of the AclRules
      * @return exposedServicesRules
@@ -68,8 +92,37 @@ class GatewayAclRules {
      */
     void setRemoteAppRules(const GatewayRemoteAppRules& remoteAppRules);
 
+    /**
+     * Add the rules of another AclRules to these rules
+     * @param aclRules - the rules to add
+     */
+    void addRules(const GatewayAclRules& aclRules);
+
+    /**
+     * Normalize the rules. Merges rules of the same object path, drops the
+     * interfaces already allowed by a prefix rule and groups the interfaces
+     * of each object path into one rule
+     */
+    void normalize();
+
+    /**
+     * Normalize a list of object descriptions the way normalize() does
+     * @param objects - the objects to normalize in place
+     */
+    static void normalizeObjectDescriptions(GatewayRuleObjectDescriptions& objects);
+
   private:
 
+    /**
+     * Id of the Acl
+     */
+    qcc::String m_AclId;
+
+    /**
+     * Revision of the rules
+     */
+    uint64_t m_Revision;
+
     /**
      * Exposed Services Rules
      */
@@ -17,7 +17,10 @@
 #ifndef GATEWAYAPPIDDEVICEIDKEY_H_
 #define GATEWAYAPPIDDEVICEIDKEY_H_
 
+#include <stddef.h>
+#include <unordered_map>
 #include <qcc/String.h>
+#include <alljoyn/MsgArg.h>
 
 namespace ajn {
 namespace gw {
@@ -25,11 +28,22 @@ namespace gw {
 #define APPID_LENGTH 16
 
 /**
- * Class used to define a key combining appId and DeviceId
+ * Class used to define a key combining appId and DeviceId. The appId is kept as bytes and the
+ * key carries a precomputed hash, so comparisons and hashed lookups avoid string compares
  */
 class GatewayAppIdentifier {
   public:
 
+    /**
+     * Hash functor for hashed containers keyed by GatewayAppIdentifier
+     */
+    struct Hash {
+        size_t operator()(const GatewayAppIdentifier& key) const
+        {
+            return (size_t)key.getHash();
+        }
+    };
+
     /**
      * Constructor for GatewayAppIdentifier
      * @param appId as a qcc::String
@@ -51,7 +65,8 @@ class GatewayAppIdentifier {
     virtual ~GatewayAppIdentifier();
 
     /**
-     * operator < used for key comparisons
+     * operator < used for key comparisons. Orders by hash first - the order is stable
+     * but not the order of the appId strings
      * @param other
      * @return boolean smaller or not
      */
@@ -65,10 +80,10 @@ class GatewayAppIdentifier {
     bool operator==(const GatewayAppIdentifier& other) const;
 
     /**
-     * get the AppId as string
+     * get the AppId as hex string, for display and persistence
      * @return appID
      */
-    const qcc::String& getAppId() const;
+    qcc::String getAppId() const;
 
     /**
      * get the AppIdHex
@@ -88,12 +103,32 @@ class GatewayAppIdentifier {
      */
     const qcc::String& getDeviceId() const;
 
-  private:
+    /**
+     * Get the hash of the appId and deviceId
+     * @return hash
+     */
+    uint64_t getHash() const;
 
     /**
-     * the AppId of the Key
+     * Compare with an appId and deviceId without building a GatewayAppIdentifier
+     * @param appId - the appId bytes
+     * @param appIdLen - the number of bytes
+     * @param deviceId - the deviceId
+     * @return true if they identify this app
      */
-    qcc::String m_AppId;
+    bool matches(const uint8_t* appId, size_t appIdLen, const char* deviceId) const;
+
+    /**
+     * Find the AppId and DeviceId of an announcement without copying or parsing the other fields
+     * @param aboutDataArg - the a{sv} AboutData of the announcement
+     * @param appId - set to the AppId bytes inside aboutDataArg
+     * @param appIdLen - set to the number of AppId bytes
+     * @param deviceId - set to the DeviceId inside aboutDataArg
+     * @return true if both were found
+     */
+    static bool extractFromAboutData(const ajn::MsgArg& aboutDataArg, const uint8_t** appId, size_t* appIdLen, const char** deviceId);
+
+  private:
 
     /**
      * The AppId in Hex form of the Key
@@ -105,6 +140,16 @@ class GatewayAppIdentifier {
      */
     qcc::String m_DeviceId;
 
+    /**
+     * Hash of m_AppIdHex and m_DeviceId
+     */
+    uint64_t m_Hash;
+
+    /**
+     * Compute m_Hash
+     */
+    void computeHash();
+
 };
 
 } /* namespace gw */
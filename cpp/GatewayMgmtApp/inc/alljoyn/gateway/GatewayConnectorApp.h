@@ -189,6 +189,26 @@ class GatewayConnectorApp {
      */
     bool hasActiveAcl();
 
+    /**
+     * Append the Acls of this Connector App to a snapshot
+     * @param snapshot - the snapshot
+     */
+    void writeSnapshot(GatewaySnapshot& snapshot) const;
+
+    /**
+     * Load the Acls of this Connector App from a snapshot instead of its acls directory
+     * @param snapshot - the snapshot
+     * @return true if the Acls were read
+     */
+    bool readSnapshot(GatewaySnapshot& snapshot);
+
+    /**
+     * Load the Acls of this App from its acls directory. Called by init if they are not loaded
+     * @param appsDirectory - the directory of the installed apps
+     * @return status - success/failure
+     */
+    QStatus loadAcls(qcc::String const& appsDirectory);
+
     /**
      * static Restart function for new thread
      * @param app
@@ -210,12 +230,6 @@ class GatewayConnectorApp {
      */
     qcc::String generateAclId(qcc::String const& aclName);
 
-    /**
-     * load the Acls of this App
-     * @return status - success/failure
-     */
-    QStatus loadAcls();
-
     /**
      * Function that shuts down the Application
      * @return success - true/false
@@ -276,6 +290,11 @@ class GatewayConnectorApp {
      * The Acls of this App
      */
     std::map<qcc::String, GatewayAcl*> m_Acls;
+
+    /**
+     * Were the Acls loaded already
+     */
+    bool m_AclsLoaded;
 };
 
 } /* namespace gw */
@@ -19,6 +19,8 @@
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/gateway/GatewayMgmt.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
+#include <alljoyn/gateway/GatewayWorkerPool.h>
 #include <map>
 
 namespace ajn {
@@ -44,12 +46,19 @@ class GatewayConnectorAppManager {
      */
     virtual ~GatewayConnectorAppManager();
 
+    /**
+     * Set the number of threads parsing the Manifests and Acls at startup. Set before init
+     * @param numThreads - number of threads, the caller included. 0 for one per core
+     */
+    void setLoadThreads(uint32_t numThreads);
+
     /**
      * Initialize the GatewayConnectorAppManager
      * @param bus - bus used to register
+     * @param snapshot - optional. snapshot to load the Apps from instead of the apps directory
      * @return status - success/failure
      */
-    QStatus init(BusAttachment* bus);
+    QStatus init(BusAttachment* bus, GatewaySnapshot* snapshot = NULL);
 
     /**
      * Shutdown the GatewayConnectorAppManager
@@ -70,6 +79,31 @@ class GatewayConnectorAppManager {
      */
     std::map<qcc::String, GatewayConnectorApp*> getConnectorApps() const;
 
+    /**
+     * Count the Acls of all the Apps
+     * @param numAcls - filled with the number of Acls
+     * @param numActiveAcls - filled with the number of active Acls
+     */
+    void getAclCounts(size_t* numAcls, size_t* numActiveAcls) const;
+
+    /**
+     * Append the Apps and their Acls to a snapshot, together with the
+     * files and directories they were loaded from
+     * @param snapshot - the snapshot
+     */
+    void writeSnapshot(GatewaySnapshot& snapshot) const;
+
+    /**
+     * Parse the Manifests and Acls of the Apps in a directory on a worker pool. An App whose
+     * Manifest can not be parsed is skipped and the others are still loaded
+     * @param appsDirectory - the directory of the installed apps
+     * @param workerPool - the pool parsing the Apps
+     * @param connectorApps - filled with the parsed Apps by connectorId
+     * @return status - success/failure
+     */
+    static QStatus loadConnectorApps(qcc::String const& appsDirectory, GatewayWorkerPool& workerPool,
+                                     std::map<qcc::String, GatewayConnectorApp*>& connectorApps);
+
   private:
 
     /**
@@ -78,11 +112,23 @@ class GatewayConnectorAppManager {
      */
     QStatus loadConnectorApps();
 
+    /**
+     * Load the installed Apps from a snapshot
+     * @param snapshot - the snapshot
+     * @return true if the Apps were read
+     */
+    bool readSnapshot(GatewaySnapshot& snapshot);
+
     /**
      * BusObject used for AppMgmt
      */
     AppMgmtBusObject* m_AppMgmtBusObject;
 
+    /**
+     * Number of threads parsing the Apps at startup
+     */
+    uint32_t m_LoadThreads;
+
     /**
      * The map storing the Apps
      */
@@ -20,6 +20,7 @@
 #include <qcc/String.h>
 #include <alljoyn/Status.h>
 #include <alljoyn/gateway/GatewayConnectorAppCapability.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
 #include <libxml/tree.h>
 #include <map>
 #include <vector>
@@ -56,6 +57,19 @@ class GatewayConnectorAppManifest {
      */
     QStatus parseManifestFile(qcc::String const& manifestFileName);
 
+    /**
+     * Append the parsed manifest to a snapshot
+     * @param snapshot - the snapshot
+     */
+    void writeSnapshot(GatewaySnapshot& snapshot) const;
+
+    /**
+     * Fill this class from a snapshot instead of parsing the ManifestFile
+     * @param snapshot - the snapshot
+     * @return true if the manifest was read
+     */
+    bool readSnapshot(GatewaySnapshot& snapshot);
+
     /**
      * Get the FriendlyName
      * @return friendlyName
@@ -181,6 +195,21 @@ class GatewayConnectorAppManifest {
      */
     void parseExecutionInfo(xmlNode* currentKey);
 
+    /**
+     * Append capabilities to a snapshot
+     * @param snapshot - the snapshot
+     * @param capabilities - the capabilities
+     */
+    static void writeCapabilities(GatewaySnapshot& snapshot, Capabilities const& capabilities);
+
+    /**
+     * Read capabilities from a snapshot
+     * @param snapshot - the snapshot
+     * @param capabilities - filled with the capabilities
+     * @return true if the capabilities were read
+     */
+    static bool readCapabilities(GatewaySnapshot& snapshot, Capabilities& capabilities);
+
 };
 
 } /* namespace gw */
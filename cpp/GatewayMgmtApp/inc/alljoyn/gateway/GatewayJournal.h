@@ -0,0 +1,246 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_JOURNAL_H_
+#define GATEWAY_JOURNAL_H_
+
+#include <pthread.h>
+#include <map>
+#include <vector>
+#include <qcc/String.h>
+#include <alljoyn/Status.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * A change of one file recorded in the journal
+ */
+struct GatewayJournalEntry {
+    qcc::String fileName;               ///< The file changed
+    qcc::String data;                   ///< The new content of the file
+    bool remove;                        ///< True if the file is removed
+};
+
+/**
+ * GatewayJournal - Append only log of the changes of the Acl and Metadata files.
+ * Each commit of a GatewayPersistenceBatch becomes one record. Records appended
+ * concurrently are written and synced together, one sync per group. A background
+ * thread folds the journal into the files once it grows or goes idle, and the journal
+ * left by a previous run is folded into the files by init
+ */
+class GatewayJournal {
+
+  public:
+
+    /**
+     * Constructor for the GatewayJournal class
+     * @param fileName - the journal file
+     * @param compactionThreshold - size of the journal that triggers a compaction
+     * @param compactionIntervalMs - time after which a non empty journal is compacted
+     */
+    GatewayJournal(qcc::String const& fileName, size_t compactionThreshold, uint32_t compactionIntervalMs);
+
+    /**
+     * Destructor for the GatewayJournal class
+     */
+    virtual ~GatewayJournal();
+
+    /**
+     * Replay the journal of the previous run into the files, open the journal
+     * and start the compaction thread
+     * @return status - success/failure
+     */
+    QStatus init();
+
+    /**
+     * Stop the compaction thread and fold the journal into the files
+     * @return status - success/failure
+     */
+    QStatus shutdown();
+
+    /**
+     * Append a record and wait until it is durable
+     * @param entries - the changes of the record. Applied together on replay
+     * @return status - success/failure
+     */
+    QStatus append(std::vector<GatewayJournalEntry> const& entries);
+
+    /**
+     * Fold the journal into the files and truncate it. Appends wait meanwhile
+     * @return status - success/failure
+     */
+    QStatus compact();
+
+    /**
+     * Get the size of the journal
+     * @return bytes appended since the last compaction
+     */
+    size_t getSize();
+
+    /**
+     * Get the latest durable change of a file that is not folded into the file yet
+     * @param fileName - the file
+     * @param entry - filled with the change
+     * @return true if the journal holds a change of the file
+     */
+    bool getLatest(qcc::String const& fileName, GatewayJournalEntry& entry);
+
+  private:
+
+    /**
+     * The journal file
+     */
+    qcc::String m_FileName;
+
+    /**
+     * Descriptor of the journal file
+     */
+    int m_Fd;
+
+    /**
+     * Bytes appended since the last compaction
+     */
+    size_t m_Size;
+
+    /**
+     * Size of the journal that triggers a compaction
+     */
+    size_t m_CompactionThreshold;
+
+    /**
+     * Time after which a non empty journal is compacted
+     */
+    uint32_t m_CompactionIntervalMs;
+
+    /**
+     * Time of the last append
+     */
+    uint64_t m_LastAppendMs;
+
+    /**
+     * Latest durable change of every file since the last compaction
+     */
+    std::map<qcc::String, GatewayJournalEntry> m_Latest;
+
+    /**
+     * Encoded records waiting for the next write
+     */
+    std::vector<uint8_t> m_PendingData;
+
+    /**
+     * Entries of the records waiting for the next write
+     */
+    std::vector<GatewayJournalEntry> m_PendingEntries;
+
+    /**
+     * Sequence number of the last record appended
+     */
+    uint64_t m_LastSequence;
+
+    /**
+     * Sequence number of the last record written, successfully or not
+     */
+    uint64_t m_WrittenSequence;
+
+    /**
+     * Sequence number of the last record written successfully
+     */
+    uint64_t m_DurableSequence;
+
+    /**
+     * Is a thread writing the journal or compacting it
+     */
+    bool m_Busy;
+
+    /**
+     * Did a write fail. The journal refuses records afterwards
+     */
+    bool m_Failed;
+
+    /**
+     * Is the compaction thread asked to stop
+     */
+    bool m_Stopping;
+
+    /**
+     * Lock protecting the members
+     */
+    pthread_mutex_t m_Lock;
+
+    /**
+     * Signaled when a write or compaction ends
+     */
+    pthread_cond_t m_Done;
+
+    /**
+     * Signaled to wake the compaction thread
+     */
+    pthread_cond_t m_CompactionNeeded;
+
+    /**
+     * The compaction thread
+     */
+    pthread_t m_CompactionThread;
+
+    /**
+     * Is the compaction thread running
+     */
+    bool m_ThreadStarted;
+
+    /**
+     * Write changes into the files
+     * @param latest - the latest change of every file
+     * @return status - success/failure
+     */
+    static QStatus fold(std::map<qcc::String, GatewayJournalEntry> const& latest);
+
+    /**
+     * Decode the records of a journal. Stops at the first torn or corrupt record
+     * @param data - the journal content
+     * @param length - the length of the content
+     * @param latest - filled with the latest change of every file
+     * @return number of records decoded
+     */
+    static size_t decode(const uint8_t* data, size_t length, std::map<qcc::String, GatewayJournalEntry>& latest);
+
+    /**
+     * Entry point of the compaction thread
+     * @param arg - the journal
+     * @return NULL
+     */
+    static void* CompactionThreadWrapper(void* arg);
+
+    /**
+     * Compact the journal when it grows past the threshold or stays idle for the interval
+     */
+    void CompactionThread();
+
+    /**
+     * Copy constructor - not implemented
+     */
+    GatewayJournal(const GatewayJournal&);
+
+    /**
+     * Assignment operator - not implemented
+     */
+    GatewayJournal& operator=(const GatewayJournal&);
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_JOURNAL_H_ */
@@ -15,6 +15,8 @@
  ******************************************************************************/
 
 #include <alljoyn/gateway/GatewayAppIdentifier.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
 #include <alljoyn/Status.h>
 #include <map>
 
@@ -43,22 +45,31 @@ class GatewayMetadataManager {
 
     /**
      * Initialize the MetadataManager
+     * @param snapshot - optional. snapshot to read the Metadata from instead of the Metadata file
      * @return status - success/failure
      */
-    QStatus init();
+    QStatus init(GatewaySnapshot* snapshot = NULL);
 
     /**
      * Cleanup the MetadataManager
+     * @param updated - optional. set to true if the Metadata file was rewritten
      * @return status - success/failure
      */
-    QStatus cleanup();
+    QStatus cleanup(bool* updated = NULL);
+
+    /**
+     * Append the Metadata to a snapshot
+     * @param snapshot - the snapshot
+     */
+    void writeSnapshot(GatewaySnapshot& snapshot) const;
 
     /**
      * Update the metadata
      * @param metadata - metadata to update
+     * @param batch - optional. batch to stage the file in. If not set the file is written immediately
      * @return status - success/failure
      */
-    QStatus updateMetadata(std::map<qcc::String, qcc::String> const& metadata);
+    QStatus updateMetadata(std::map<qcc::String, qcc::String> const& metadata, GatewayPersistenceBatch* batch = NULL);
 
     /**
      * add MetadataValues to metadata map based on key passed in
@@ -73,6 +84,12 @@ class GatewayMetadataManager {
      */
     void incRemoteAppRefCount(GatewayAppIdentifier const& key);
 
+    /**
+     * Get the number of remote apps with metadata
+     * @return numEntries
+     */
+    size_t getNumMetadataEntries() const;
+
   private:
 
     /**
@@ -97,13 +114,21 @@ class GatewayMetadataManager {
     /**
      * Metadata being managed
      */
-    std::map<GatewayAppIdentifier, MetadataValues> m_Metadata;
+    std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash> m_Metadata;
 
     /**
      * Write Metadata to file
+     * @param batch - optional. batch to stage the file in. If not set the file is written immediately
      * @return status - success/failure
      */
-    QStatus writeToFile();
+    QStatus writeToFile(GatewayPersistenceBatch* batch = NULL);
+
+    /**
+     * Read the Metadata from a snapshot
+     * @param snapshot - the snapshot
+     * @return true if the Metadata was read
+     */
+    bool readSnapshot(GatewaySnapshot& snapshot);
 
 };
 
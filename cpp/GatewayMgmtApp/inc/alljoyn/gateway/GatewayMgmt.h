@@ -19,7 +19,9 @@
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/gateway/GatewayBusListener.h>
+#include <alljoyn/gateway/GatewayJournal.h>
 #include <map>
+#include <pthread.h>
 
 #define GW_WELLKNOWN_NAME "org.alljoyn.GWAgent.GMApp"
 
@@ -115,6 +117,94 @@ class GatewayMgmt {
      */
     void setAppPolicyDir(const char* appPolicyDirectory);
 
+    /**
+     * Set the window used to batch policy changes into a single config reload
+     * @param windowMs - a batch is committed once no change arrived for this long
+     * @param maxLatencyMs - a batch is committed at the latest this long after its first change
+     */
+    void setPolicyCommitWindow(uint32_t windowMs, uint32_t maxLatencyMs);
+
+    /**
+     * Bound the devices remembered from announcements. Devices referenced by active Acls are kept
+     * @param maxDevices - the least recently announced devices are evicted above this number. 0 for no limit
+     * @param ttlMs - devices not announced for this long are evicted. 0 for no limit
+     */
+    void setAnnouncedDevicesLimit(uint32_t maxDevices, uint32_t ttlMs);
+
+    /**
+     * Write every active Acl to its own policy fragment instead of one file per connector
+     * @param aclPolicyFragments - true for a fragment per Acl
+     */
+    void setAclPolicyFragments(bool aclPolicyFragments);
+
+    /**
+     * Leave the Acl interfaces out of the About announcement. Controllers find
+     * the Acls through ListAcls instead. Set before init
+     * @param aclsUnannounced - true to not announce the Acls
+     */
+    void setAclsUnannounced(bool aclsUnannounced);
+
+    /**
+     * Are the Acl interfaces left out of the announcement
+     * @return aclsUnannounced
+     */
+    bool getAclsUnannounced() const;
+
+    /**
+     * Append the changes of the Acl and Metadata files to a journal with group commit
+     * instead of rewriting the files. Set before init
+     * @param aclJournal - true to journal the changes
+     */
+    void setAclJournal(bool aclJournal);
+
+    /**
+     * Get the journal of the Acl and Metadata files
+     * @return journal - NULL if the files are written directly
+     */
+    GatewayJournal* getJournal() const;
+
+    /**
+     * Load the state from the binary snapshot at startup. The snapshot is written after
+     * startup and at shutdown. Disabled by default. Set before init
+     * @param snapshotEnabled - true to use the snapshot
+     */
+    void setSnapshotEnabled(bool snapshotEnabled);
+
+    /**
+     * Set the number of threads parsing the Manifests and Acls of the Apps at startup.
+     * Set before init
+     * @param numThreads - number of threads, the main thread included. 0 for one per core
+     */
+    void setStartupThreads(uint32_t numThreads);
+
+    /**
+     * Index only the name and status of the Acls at startup and parse their rules on
+     * first access. Set before init
+     * @param lazyAclBodies - true to parse the rules on first access
+     * @param maxInactiveBodies - rules of inactive Acls kept in memory before the least
+     *                            recently used are evicted. 0 to never evict
+     */
+    void setLazyAclBodies(bool lazyAclBodies, uint32_t maxInactiveBodies);
+
+    /**
+     * Are the rules of the Acls parsed on first access
+     * @return lazyAclBodies
+     */
+    bool getLazyAclBodies() const;
+
+    /**
+     * Get the number of rules of inactive Acls kept in memory
+     * @return maxInactiveBodies - 0 if they are never evicted
+     */
+    uint32_t getMaxInactiveAclBodies() const;
+
+    /**
+     * Write the loaded Apps, Acls and Metadata to the snapshot file. Called after startup
+     * and at shutdown - a snapshot that is stale by then is ignored on the next start
+     * @return status - success/failure
+     */
+    QStatus saveSnapshot();
+
   private:
 
     /**
@@ -163,6 +253,71 @@ class GatewayMgmt {
      */
     qcc::String m_appPolicyDirectory;
 
+    /**
+     * Quiet period used to batch policy changes
+     */
+    uint32_t m_PolicyCommitWindowMs;
+
+    /**
+     * Maximum delay of a batched policy change
+     */
+    uint32_t m_PolicyCommitMaxLatencyMs;
+
+    /**
+     * Maximum number of announced devices remembered
+     */
+    uint32_t m_MaxAnnouncedDevices;
+
+    /**
+     * Time an announced device is remembered without announcing again
+     */
+    uint32_t m_AnnouncedDeviceTtlMs;
+
+    /**
+     * Whether every Acl is written to its own policy fragment
+     */
+    bool m_AclPolicyFragments;
+
+    /**
+     * Whether the Acl interfaces are left out of the announcement
+     */
+    bool m_AclsUnannounced;
+
+    /**
+     * Whether the changes of the Acl and Metadata files are journaled
+     */
+    bool m_AclJournal;
+
+    /**
+     * The journal of the Acl and Metadata files
+     */
+    GatewayJournal* m_Journal;
+
+    /**
+     * Number of threads parsing the Apps at startup
+     */
+    uint32_t m_StartupThreads;
+
+    /**
+     * Whether the rules of the Acls are parsed on first access
+     */
+    bool m_LazyAclBodies;
+
+    /**
+     * Rules of inactive Acls kept in memory
+     */
+    uint32_t m_MaxInactiveAclBodies;
+
+    /**
+     * Whether the snapshot is used
+     */
+    bool m_SnapshotEnabled;
+
+    /**
+     * Serializes the writers of the snapshot
+     */
+    pthread_mutex_t m_SnapshotLock;
+
 };
 
 } //namespace gw
@@ -0,0 +1,174 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_PERSISTENCEBATCH_H_
+#define GATEWAY_PERSISTENCEBATCH_H_
+
+#include <pthread.h>
+#include <vector>
+#include <qcc/String.h>
+#include <alljoyn/Status.h>
+#include <alljoyn/gateway/GatewayJournal.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewayPersistenceBatch - Class that replaces a set of files atomically and durably.
+ * Every file is staged into a temporary file next to its destination. On commit all
+ * staged files are synced before being renamed over their destinations,
+ * and one more barrier makes the renames durable. A crash leaves either the old or
+ * the new version of each file, never a truncated one. A batch given a journal keeps
+ * the files in memory and appends them to the journal as one record on commit
+ */
+class GatewayPersistenceBatch {
+
+  public:
+
+    /**
+     * Constructor for the GatewayPersistenceBatch class
+     */
+    GatewayPersistenceBatch();
+
+    /**
+     * Constructor for a GatewayPersistenceBatch committing to a journal
+     * @param journal - the journal. If NULL the files are written directly
+     */
+    GatewayPersistenceBatch(GatewayJournal* journal);
+
+    /**
+     * Destructor for the GatewayPersistenceBatch class. Staged files that were
+     * not committed are discarded
+     */
+    virtual ~GatewayPersistenceBatch();
+
+    /**
+     * Stage the content of a file. Can be called from several threads at once,
+     * but not while the batch is committed or aborted
+     * @param fileName - the destination of the content
+     * @param data - the content to write
+     * @param length - the length of the content
+     * @return status - success/failure
+     */
+    QStatus stage(qcc::String const& fileName, const void* data, size_t length);
+
+    /**
+     * Stage the removal of a file. The file is removed on commit
+     * @param fileName - the file to remove
+     * @return status - success/failure
+     */
+    QStatus stageRemoval(qcc::String const& fileName);
+
+    /**
+     * Sync and rename all staged files over their destinations and remove the files
+     * staged for removal. With a journal, append them to the journal instead
+     * @return status - success/failure
+     */
+    QStatus commit();
+
+    /**
+     * Discard all staged files
+     */
+    void abort();
+
+    /**
+     * Is anything staged
+     * @return true/false
+     */
+    bool empty() const;
+
+    /**
+     * Get the destinations of the staged files
+     * @return fileNames
+     */
+    std::vector<qcc::String> getFileNames() const;
+
+    /**
+     * Replace a single file atomically and durably
+     * @param fileName - the destination of the content
+     * @param data - the content to write
+     * @param length - the length of the content
+     * @return status - success/failure
+     */
+    static QStatus writeFile(qcc::String const& fileName, const void* data, size_t length);
+
+    /**
+     * Check whether a directory entry is a temporary file left behind by a batch
+     * @param entryName - the name of the entry, without its directory
+     * @return true/false
+     */
+    static bool isTempFile(qcc::String const& entryName);
+
+  private:
+
+    /**
+     * A file staged in the batch
+     */
+    struct StagedFile {
+        qcc::String fileName;
+        qcc::String tempName;
+        int fd;
+    };
+
+    /**
+     * The files staged in the batch
+     */
+    std::vector<StagedFile> m_StagedFiles;
+
+    /**
+     * The files staged for removal
+     */
+    std::vector<qcc::String> m_RemovedFiles;
+
+    /**
+     * The journal to commit to, or NULL
+     */
+    GatewayJournal* m_Journal;
+
+    /**
+     * The changes staged for the journal
+     */
+    std::vector<GatewayJournalEntry> m_JournalEntries;
+
+    /**
+     * Lock protecting the staged files while files are staged concurrently
+     */
+    pthread_mutex_t m_StageLock;
+
+    /**
+     * Sync the given descriptors. Large batches use one syncfs per filesystem
+     * on kernels where it reports writeback errors
+     * @param fds - open descriptors, one per file or directory to make durable
+     * @param dataOnly - whether fdatasync is enough, as for the staged files
+     * @return status - success/failure
+     */
+    static QStatus syncBarrier(std::vector<int> const& fds, bool dataOnly);
+
+    /**
+     * Copy constructor - not implemented
+     */
+    GatewayPersistenceBatch(const GatewayPersistenceBatch&);
+
+    /**
+     * Assignment operator - not implemented
+     */
+    GatewayPersistenceBatch& operator=(const GatewayPersistenceBatch&);
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_PERSISTENCEBATCH_H_ */
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_POLICYCOMMITLISTENER_H_
+#define GATEWAY_POLICYCOMMITLISTENER_H_
+
+#include <alljoyn/Status.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewayPolicyCommitListener - Completion callback of a policy commit
+ */
+class GatewayPolicyCommitListener {
+
+  public:
+
+    /**
+     * Destructor for the GatewayPolicyCommitListener class
+     */
+    virtual ~GatewayPolicyCommitListener() { }
+
+    /**
+     * Called once the policy changes made before the listener was registered
+     * are written and the config is reloaded
+     * @param status - status of the commit
+     */
+    virtual void policiesCommitted(QStatus status) = 0;
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_POLICYCOMMITLISTENER_H_ */
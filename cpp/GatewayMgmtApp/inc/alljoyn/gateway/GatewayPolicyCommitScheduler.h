@@ -0,0 +1,330 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_POLICYCOMMITSCHEDULER_H_
+#define GATEWAY_POLICYCOMMITSCHEDULER_H_
+
+#include <pthread.h>
+#include <set>
+#include <vector>
+#include <qcc/String.h>
+#include <alljoyn/Status.h>
+#include <alljoyn/gateway/GatewayPolicyCommitListener.h>
+
+namespace ajn {
+namespace gw {
+
+class GatewayRouterPolicyManager;
+
+/**
+ * GatewayPolicyCommitScheduler - Class that coalesces policy changes and commits
+ * them in batches on a dedicated thread, issuing a single config reload per batch
+ */
+class GatewayPolicyCommitScheduler {
+
+  public:
+
+    /**
+     * Constructor for the GatewayPolicyCommitScheduler class
+     * @param policyManager - the policyManager that commits the batches
+     */
+    GatewayPolicyCommitScheduler(GatewayRouterPolicyManager* policyManager);
+
+    /**
+     * Destructor for the GatewayPolicyCommitScheduler class
+     */
+    virtual ~GatewayPolicyCommitScheduler();
+
+    /**
+     * Start the commit thread
+     * @return status - success/failure
+     */
+    QStatus start();
+
+    /**
+     * Stop the commit thread. Pending changes are committed before returning
+     */
+    void stop();
+
+    /**
+     * Is the commit thread running
+     * @return true/false
+     */
+    bool isRunning() const;
+
+    /**
+     * Set the batching window. A batch is committed once no change arrived for
+     * windowMs, or once maxLatencyMs passed since its first change
+     * @param windowMs - quiet period in milliseconds
+     * @param maxLatencyMs - maximum delay of a change in milliseconds
+     */
+    void setWindow(uint32_t windowMs, uint32_t maxLatencyMs);
+
+    /**
+     * Mark the policies of a connector as changed
+     * @param connectorId - the connectorId to rewrite
+     * @param defaultPoliciesChanged - whether the default policy file must be rewritten as well
+     */
+    void markConnectorDirty(qcc::String const& connectorId, bool defaultPoliciesChanged);
+
+    /**
+     * Mark the default policy file as changed
+     */
+    void markDefaultPoliciesDirty();
+
+    /**
+     * Call a listener once the changes marked so far are committed. The listener
+     * is called on the commit thread, or right away when nothing is pending
+     * @param listener - the listener to call. The scheduler deletes it after calling it
+     */
+    void notifyWhenCommitted(GatewayPolicyCommitListener* listener);
+
+    /**
+     * Commit the pending batch on the calling thread and wait for a commit in
+     * progress, so that all listeners registered so far are called on return
+     */
+    void flush();
+
+    /**
+     * Start a full commit. Waits for a commit in progress and takes over the pending
+     * batch, which the full commit supersedes
+     */
+    void startFullCommit();
+
+    /**
+     * Complete a full commit started with startFullCommit. If it failed, the batch
+     * it took over is retried
+     * @param status - status of the full commit
+     */
+    void completeFullCommit(QStatus status);
+
+    /**
+     * Get the number of batches committed
+     * @return batches committed
+     */
+    uint32_t getBatchesCommitted() const;
+
+    /**
+     * Get the number of changes merged into all batches committed
+     * @return changes committed
+     */
+    uint32_t getChangesCommitted() const;
+
+    /**
+     * Get the number of changes merged into the last batch
+     * @return changes in last batch
+     */
+    uint32_t getLastBatchChanges() const;
+
+  private:
+
+    /**
+     * The policyManager used to commit the batches
+     */
+    GatewayRouterPolicyManager* m_PolicyManager;
+
+    /**
+     * The commit thread
+     */
+    pthread_t m_Thread;
+
+    /**
+     * The mutex Lock
+     */
+    mutable pthread_mutex_t m_Lock;
+
+    /**
+     * The Pending changed thread condition
+     */
+    pthread_cond_t m_PendingChanged;
+
+    /**
+     * The Commit done thread condition
+     */
+    pthread_cond_t m_CommitDone;
+
+    /**
+     * is the thread running
+     */
+    bool m_IsRunning;
+
+    /**
+     * is the thread in the process of shutting down
+     */
+    bool m_IsStopping;
+
+    /**
+     * Quiet period of a batch in milliseconds
+     */
+    uint32_t m_WindowMs;
+
+    /**
+     * Maximum delay of a change in milliseconds
+     */
+    uint32_t m_MaxLatencyMs;
+
+    /**
+     * Connectors changed in the pending batch
+     */
+    std::set<qcc::String> m_DirtyConnectors;
+
+    /**
+     * Whether the default policies changed in the pending batch
+     */
+    bool m_DefaultPoliciesDirty;
+
+    /**
+     * Number of changes merged into the pending batch
+     */
+    uint32_t m_PendingChanges;
+
+    /**
+     * Time of the first change of the pending batch
+     */
+    uint64_t m_FirstChangeMs;
+
+    /**
+     * Time of the last change of the pending batch
+     */
+    uint64_t m_LastChangeMs;
+
+    /**
+     * Is a batch being committed
+     */
+    bool m_IsCommitting;
+
+    /**
+     * Status of the last commit
+     */
+    QStatus m_LastCommitStatus;
+
+    /**
+     * Listeners waiting for the pending batch
+     */
+    std::vector<GatewayPolicyCommitListener*> m_PendingListeners;
+
+    /**
+     * Listeners waiting for the batch being committed
+     */
+    std::vector<GatewayPolicyCommitListener*> m_CommittingListeners;
+
+    /**
+     * Delay before retrying a failed batch. 0 when the last commit succeeded
+     */
+    uint32_t m_RetryDelayMs;
+
+    /**
+     * Time before which a failed batch is not retried
+     */
+    uint64_t m_RetryAtMs;
+
+    /**
+     * Connectors of the failed batch waiting to be retried
+     */
+    std::set<qcc::String> m_RetryConnectors;
+
+    /**
+     * Whether the failed batch waiting to be retried wrote the default policies
+     */
+    bool m_RetryDefaultPolicies;
+
+    /**
+     * Number of changes of the failed batch waiting to be retried
+     */
+    uint32_t m_RetryChanges;
+
+    /**
+     * Connectors of the pending batch taken over by the full commit in progress
+     */
+    std::set<qcc::String> m_FullCommitConnectors;
+
+    /**
+     * Whether the default policies were dirty when the full commit in progress started
+     */
+    bool m_FullCommitDefaultPolicies;
+
+    /**
+     * Number of pending changes taken over by the full commit in progress
+     */
+    uint32_t m_FullCommitChanges;
+
+    /**
+     * Number of batches committed
+     */
+    uint32_t m_BatchesCommitted;
+
+    /**
+     * Number of changes committed
+     */
+    uint32_t m_ChangesCommitted;
+
+    /**
+     * Number of changes in the last batch
+     */
+    uint32_t m_LastBatchChanges;
+
+    /**
+     * Register a change in the pending batch. Called with the lock held
+     */
+    void addPendingChange();
+
+    /**
+     * Move the pending batch and the failed batch waiting to be retried to the commit
+     * in progress. Called with the lock held
+     * @param connectorIds - filled with the connectors of the batch
+     * @param writeDefaultPolicies - set if the default policies changed
+     * @return number of changes in the batch
+     */
+    uint32_t takePending(std::set<qcc::String>& connectorIds, bool& writeDefaultPolicies);
+
+    /**
+     * Keep the changes of a failed commit aside and back off before retrying them.
+     * New changes are still committed on the normal window, together with these.
+     * Called with the lock held
+     * @param connectorIds - the connectors of the failed commit
+     * @param writeDefaultPolicies - whether the failed commit wrote the default policies
+     * @param changes - number of changes in the failed commit
+     */
+    void retryLater(std::set<qcc::String> const& connectorIds, bool writeDefaultPolicies, uint32_t changes);
+
+    /**
+     * Commit the pending batch. Called with the lock held, releases it while committing
+     */
+    void commitPending();
+
+    /**
+     * End the commit in progress and call its listeners. Called with the lock
+     * held, releases it while calling the listeners
+     * @param status - status of the commit
+     */
+    void finishCommit(QStatus status);
+
+    /**
+     * A wrapper for the commit Thread
+     * @param context
+     */
+    static void* CommitThreadWrapper(void* context);
+
+    /**
+     * The function run in the commit thread
+     */
+    void CommitThread();
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_POLICYCOMMITSCHEDULER_H_ */
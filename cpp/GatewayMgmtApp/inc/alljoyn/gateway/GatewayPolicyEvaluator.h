@@ -0,0 +1,204 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_POLICYEVALUATOR_H_
+#define GATEWAY_POLICYEVALUATOR_H_
+
+#include <map>
+#include <vector>
+#include <qcc/String.h>
+#include <alljoyn/Status.h>
+#include <libxml/tree.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewayPolicyEvaluator - Loads a busconfig policy file, with the files it includes, into
+ * memory and decides whether messages are allowed the way the routing node would.
+ * Used to check the generated policies offline
+ */
+class GatewayPolicyEvaluator {
+
+  public:
+
+    /**
+     * Direction of the message as seen by the connection of the user
+     */
+    typedef enum {
+        GW_PD_SEND = 0,       //!< the user sends the message
+        GW_PD_RECEIVE = 1     //!< the user receives the message
+    } Direction;
+
+    /**
+     * Type of the message
+     */
+    typedef enum {
+        GW_PT_METHOD_CALL = 1,    //!< method_call
+        GW_PT_METHOD_RETURN = 2,  //!< method_return
+        GW_PT_ERROR = 4,          //!< error
+        GW_PT_SIGNAL = 8          //!< signal
+    } MessageType;
+
+    /**
+     * A message to decide on
+     */
+    typedef struct {
+        qcc::String user;             ///< The user of the connection
+        Direction direction;          ///< Whether the user sends or receives the message
+        MessageType type;             ///< The type of the message
+        qcc::String path;             ///< The object path
+        qcc::String interfaceName;    ///< The interface
+        qcc::String peer;             ///< The destination when sending, the sender when receiving
+    } Query;
+
+    /**
+     * Constructor for the GatewayPolicyEvaluator class
+     */
+    GatewayPolicyEvaluator();
+
+    /**
+     * Destructor for the GatewayPolicyEvaluator class
+     */
+    virtual ~GatewayPolicyEvaluator();
+
+    /**
+     * Load a policy file, replacing the policies loaded before. Included files and
+     * the *.conf files of included directories are loaded as well
+     * @param policyFile - the policy file
+     * @return status - success/failure
+     */
+    QStatus loadPolicies(qcc::String const& policyFile);
+
+    /**
+     * Decide whether a message is allowed. The last matching rule decides. Messages
+     * no rule matches are allowed
+     * @param query - the message
+     * @return true if the message is allowed
+     */
+    bool isAllowed(Query const& query) const;
+
+    /**
+     * Decide whether a user may connect
+     * @param user - the user
+     * @return true if the user is allowed
+     */
+    bool isUserAllowed(qcc::String const& user) const;
+
+    /**
+     * Get the number of send and receive rules loaded
+     * @return number of rules
+     */
+    size_t getNumRules() const;
+
+  private:
+
+    /**
+     * A compiled allow or deny element. An empty string matches anything
+     */
+    typedef struct {
+        bool allow;                   ///< Whether the rule allows or denies
+        uint8_t types;                ///< Mask of the MessageTypes matched
+        qcc::String path;             ///< The object path
+        bool isPathPrefix;            ///< Whether the path is a prefix
+        qcc::String interfaceName;    ///< The interface
+        qcc::String peer;             ///< The send_destination or receive_sender
+    } Rule;
+
+    /**
+     * The rules of a policy, split by direction
+     */
+    struct RuleSet {
+        std::vector<Rule> rules[2];
+    };
+
+    /**
+     * The rules of the policies found in the files, in file order
+     */
+    struct ParsedPolicies {
+        RuleSet defaultRules;
+        RuleSet mandatoryRules;
+        std::map<qcc::String, RuleSet> userRules;
+        std::vector<std::pair<qcc::String, bool> > connectRules;
+    };
+
+    /**
+     * Parse a policy file
+     * @param fileName - the file
+     * @param depth - include depth of the file
+     * @param policies - the policies to fill
+     * @return status - success/failure
+     */
+    QStatus parseFile(qcc::String const& fileName, int depth, ParsedPolicies& policies);
+
+    /**
+     * Parse the *.conf files of a directory in name order
+     * @param dirName - the directory
+     * @param depth - include depth of the directory
+     * @param policies - the policies to fill
+     * @return status - success/failure
+     */
+    QStatus parseDirectory(qcc::String const& dirName, int depth, ParsedPolicies& policies);
+
+    /**
+     * Parse the rules of a policy element
+     * @param policyNode - the policy element
+     * @param ruleSet - the rules of the policy
+     * @param connectRules - the allow/deny user rules
+     */
+    void parsePolicy(xmlNode* policyNode, RuleSet& ruleSet, std::vector<std::pair<qcc::String, bool> >& connectRules);
+
+    /**
+     * Compile an allow or deny element
+     * @param ruleNode - the element
+     * @param rule - the compiled rule
+     * @param direction - the direction of the rule
+     * @return false if the rule is not a send or receive rule this class can evaluate
+     */
+    bool parseRule(xmlNode* ruleNode, Rule& rule, Direction& direction);
+
+    /**
+     * Append rules to the rule set of a user, last rule first
+     * @param from - the rules to add
+     * @param to - the rule set of a user
+     */
+    static void appendReversed(RuleSet const& from, RuleSet& to);
+
+    /**
+     * Rules of each user: the default, user and mandatory rules with the last rule first
+     */
+    std::map<qcc::String, RuleSet> m_UserRules;
+
+    /**
+     * Rules of users without a policy of their own
+     */
+    RuleSet m_OtherUserRules;
+
+    /**
+     * The allow/deny user rules with the last rule first
+     */
+    std::vector<std::pair<qcc::String, bool> > m_ConnectRules;
+
+    /**
+     * Number of rules loaded
+     */
+    size_t m_NumRules;
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_POLICYEVALUATOR_H_ */
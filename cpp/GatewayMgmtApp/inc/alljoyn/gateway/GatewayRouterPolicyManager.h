@@ -17,14 +17,21 @@
 #ifndef GATEWAY_POLICYMANAGER_H_
 #define GATEWAY_POLICYMANAGER_H_
 
+#include <list>
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
+#include <pthread.h>
+#include <sys/types.h>
 #include <qcc/String.h>
 #include <alljoyn/gateway/GatewayAclRules.h>
+#include <alljoyn/gateway/GatewayConnectorAppManifest.h>
+#include <alljoyn/gateway/GatewayPolicyCommitScheduler.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
 #include <alljoyn/gateway/GatewayMgmt.h>
-#include <libxml/tree.h>
-#include <libxml/xmlwriter.h>
+#include <alljoyn/gateway/GatewayWorkerPool.h>
+#include <alljoyn/gateway/GatewayXmlWriter.h>
 
 namespace ajn {
 namespace gw {
@@ -33,10 +40,15 @@ namespace gw {
  * GatewayRouterPolicyManager - Class that manages policies defined and updates the
  * daemon config file accordingly
  */
-class GatewayRouterPolicyManager : public AboutListener {
+class GatewayRouterPolicyManager : public AboutListener, public BusListener {
 
   public:
 
+    /**
+     * Announced devices, mapped to their busName
+     */
+    typedef std::unordered_map<GatewayAppIdentifier, qcc::String, GatewayAppIdentifier::Hash> AnnouncedDevices;
+
     /**
      * Constructor for the GatewayRouterPolicyManager class
      *
@@ -63,7 +75,8 @@ class GatewayRouterPolicyManager : public AboutListener {
     QStatus shutdown(BusAttachment* bus);
 
     /**
-     * Add rules for a connector app
+     * Add rules for a connector app. The rules are merged and normalized
+     * before they are stored. Inside a transaction the change is staged
      * @param connectorId - the connectorId to add
      * @param rules - the rules for that app
      * @return success/failure
@@ -71,18 +84,82 @@ class GatewayRouterPolicyManager : public AboutListener {
     bool addConnectorAppRules(qcc::String const& connectorId, std::vector<GatewayAclRules> const& rules);
 
     /**
-     * Remove rules for a connector app
+     * Remove rules for a connector app. Inside a transaction the change is staged
      * @param connectorId - connectorId to remove
      * @return success/failure
      */
     bool removeConnectorAppRules(qcc::String const& connectorId);
 
+    /**
+     * Start a transaction. Until it is committed, the rule changes made by the calling
+     * thread are staged aside and no commit writes them. Transactions of other threads
+     * wait for it to end. Transactions nest - the outermost commit applies the changes
+     */
+    void beginTransaction();
+
+    /**
+     * Write the rule changes staged in the transaction with a single write and config reload.
+     * If that commit fails the rules the transaction changed are restored
+     * @return status - success/failure. When the commit scheduler runs the changes are
+     * queued as one batch, and notifyWhenCommitted reports the status of the commit
+     */
+    QStatus commitTransaction();
+
+    /**
+     * Discard the rule changes staged since the matching beginTransaction and end that
+     * level. The changes staged by enclosing levels are kept
+     */
+    void rollbackTransaction();
+
+    /**
+     * Subscribe to the announcements of apps implementing the remoted services of a connector app
+     * @param connectorId - the connectorId of the app
+     * @param remotedServices - the remoted services of the app's manifest
+     * @return status - success/failure
+     */
+    QStatus addRemotedInterfaces(qcc::String const& connectorId, GatewayConnectorAppManifest::Capabilities const& remotedServices);
+
+    /**
+     * Cancel the announcement subscriptions that only this connector app needed
+     * @param connectorId - the connectorId of the app
+     * @return status - success/failure
+     */
+    QStatus removeRemotedInterfaces(qcc::String const& connectorId);
+
     /**
      * Commit all Rules as policies in the daemon config file
      * @return success/failure
      */
     QStatus commit();
 
+    /**
+     * Write the policy files of the given connectors, and optionally the default
+     * policy file, then reload the config once
+     * @param connectorIds - the connectors to process. Connectors without rules are skipped
+     * @param includeDefaultPolicies - whether the default policy file should be rewritten
+     * @return success/failure
+     */
+    QStatus commitPolicies(std::set<qcc::String> const& connectorIds, bool includeDefaultPolicies);
+
+    /**
+     * Call a listener once the policy changes made so far are committed
+     * @param listener - the listener to call. It is deleted after the call
+     */
+    void notifyWhenCommitted(GatewayPolicyCommitListener* listener);
+
+    /**
+     * Commit the pending policy changes now, so every listener registered
+     * so far has been called on return. Blocks - meant for process shutdown
+     */
+    void flushCommits();
+
+    /**
+     * Delete an unregistered BusObject once the policy changes made so far are
+     * committed, so the method calls waiting for them can still be replied to
+     * @param busObject - the BusObject to delete
+     */
+    void deleteWhenCommitted(BusObject* busObject);
+
     /**
      * @param[in] busName              well known name of the remote BusAttachment
      * @param[in] version              version of the Announce signal from the remote About Object
@@ -107,7 +184,19 @@ class GatewayRouterPolicyManager : public AboutListener {
      * Get the map of announced devices
      * @return announced devices map
      */
-    const std::map<GatewayAppIdentifier, qcc::String>& getAnnouncedDevices() const;
+    const AnnouncedDevices& getAnnouncedDevices() const;
+
+    /**
+     * Get the number of announced devices
+     * @return numAnnouncedDevices
+     */
+    size_t getNumAnnouncedDevices();
+
+    /**
+     * Get the total size of the policy files last written
+     * @return size in bytes
+     */
+    uint64_t getPolicyBytes();
 
     /**
      * Get the currently defined AclRules for each connector App
@@ -115,6 +204,13 @@ class GatewayRouterPolicyManager : public AboutListener {
      */
     const std::map<qcc::String, std::vector<GatewayAclRules> >& getConnectorAppRules() const;
 
+    /**
+     * Get the connectorIds whose active AclRules reference the given remote app
+     * @param appKey - the remote app to look up
+     * @return set of connectorIds - empty if no rules reference the app
+     */
+    const std::set<qcc::String>& getConnectorsReferencingApp(GatewayAppIdentifier const& appKey) const;
+
     /**
      * Set the AutoCommit flag. When autocommit is on every change automatically
      * updates the daemon config file. If autocommit is off the daemon config file
@@ -135,6 +231,57 @@ class GatewayRouterPolicyManager : public AboutListener {
      */
     void setAppPolicyDirectory(const char* appPolicyDirectory);
 
+    /**
+     * Set the window used to batch autocommitted changes into a single reload
+     * @param windowMs - a batch is committed once no change arrived for this long
+     * @param maxLatencyMs - a batch is committed at the latest this long after its first change
+     */
+    void setCommitWindow(uint32_t windowMs, uint32_t maxLatencyMs);
+
+    /**
+     * Get the scheduler batching the autocommitted changes
+     * @return commitScheduler
+     */
+    const GatewayPolicyCommitScheduler& getCommitScheduler() const;
+
+    /**
+     * Bound the announced devices. Devices referenced by active Acls are never evicted
+     * @param maxDevices - the least recently announced devices are evicted above this number. 0 for no limit
+     * @param ttlMs - devices not announced for this long are evicted. 0 for no limit
+     */
+    void setAnnouncedDevicesLimit(uint32_t maxDevices, uint32_t ttlMs);
+
+    /**
+     * Set the number of threads generating the app policy files
+     * @param numThreads - number of threads. 0 for one per core
+     */
+    void setPolicyWriterThreads(uint32_t numThreads);
+
+    /**
+     * Write every active Acl to its own fragment included by the connector's policy file,
+     * so activating or deactivating an Acl writes or removes one file. Only this layout reuses the
+     * serialized policies of unchanged Acls. Set before rules are added
+     * @param aclPolicyFragments - true for a fragment per Acl, false for one file per connector
+     */
+    void setAclPolicyFragments(bool aclPolicyFragments);
+
+    /**
+     * NameOwnerChanged callback. Evicts the devices announced by a name that left the bus
+     * @param busName - the name that changed owner
+     * @param previousOwner - the previous owner
+     * @param newOwner - the new owner. NULL when the name left the bus
+     */
+    void NameOwnerChanged(const char* busName, const char* previousOwner, const char* newOwner);
+
+  protected:
+
+    /**
+     * Ask the daemon to reload its config files. A bundled router (BR=on) is reloaded
+     * the same way - its policy database is only filled by parsing busconfig files
+     * @return success/failure
+     */
+    virtual QStatus reloadConfig();
+
   private:
 
     /**
@@ -142,22 +289,163 @@ class GatewayRouterPolicyManager : public AboutListener {
      */
     bool m_AboutListenerRegistered;
 
+    /**
+     * The bus used for the announcement subscriptions
+     */
+    BusAttachment* m_Bus;
+
+    /**
+     * The remoted interfaces of each connector app. An empty name stands for any interface
+     */
+    std::map<qcc::String, std::set<qcc::String> > m_RemotedInterfaces;
+
+    /**
+     * Number of connector apps needing the WhoImplements subscription of each interface
+     */
+    std::map<qcc::String, uint32_t> m_WhoImplementsRefs;
+
+    /**
+     * Lock protecting the announcement subscriptions. Never held with m_PolicyLock
+     */
+    pthread_mutex_t m_WhoImplementsLock;
+
     /**
      * Boolean to dictate whether we will commit automatically after each change
      * or only manually via the commit function
      */
     bool m_AutoCommit;
 
+    /**
+     * Boolean to track whether the BusListener was already registered
+     */
+    bool m_BusListenerRegistered;
+
     /**
      * Map of Announced devices, mapped to their busName
      */
-    std::map<GatewayAppIdentifier, qcc::String> m_AnnouncedDevices;
+    AnnouncedDevices m_AnnouncedDevices;
+
+    /**
+     * Eviction state of an announced device
+     */
+    struct AnnouncedDeviceState {
+        uint64_t lastAnnouncedMs;
+        std::list<GatewayAppIdentifier>::iterator lruPosition;
+        uint64_t announcementHash;         //hash of the last announcement's appId, deviceId and busName
+    };
+
+    /**
+     * Map of Announced devices to their eviction state
+     */
+    std::unordered_map<GatewayAppIdentifier, AnnouncedDeviceState, GatewayAppIdentifier::Hash> m_AnnouncedDeviceStates;
+
+    /**
+     * Announced devices, most recently announced first
+     */
+    std::list<GatewayAppIdentifier> m_AnnouncedDevicesLru;
+
+    /**
+     * Reverse index of m_AnnouncedDevices. Map of busNames to the devices they announced
+     */
+    std::map<qcc::String, std::set<GatewayAppIdentifier> > m_BusNameDevices;
+
+    /**
+     * Announced devices by the hash of their last announcement. Repeated announcements are
+     * recognized with it before a GatewayAppIdentifier is built
+     */
+    std::unordered_map<uint64_t, GatewayAppIdentifier> m_AnnouncementHashes;
+
+    /**
+     * Maximum number of announced devices that are not pinned. 0 for no limit
+     */
+    uint32_t m_MaxAnnouncedDevices;
+
+    /**
+     * Time after which a device that is not pinned and did not announce is evicted. 0 for no limit
+     */
+    uint32_t m_AnnouncedDeviceTtlMs;
 
     /**
      * AclRules. Map of ConnectorIds to their AclRules
      */
     std::map<qcc::String, std::vector<GatewayAclRules> > m_ConnectorAppRules;
 
+    /**
+     * Reverse index of m_ConnectorAppRules. Map of remote apps to the connectorIds
+     * whose AclRules reference them
+     */
+    std::unordered_map<GatewayAppIdentifier, std::set<qcc::String>, GatewayAppIdentifier::Hash> m_AppConnectorIndex;
+
+    /**
+     * Revision of the rules of each connector. Changed with every update of its rules
+     */
+    std::map<qcc::String, uint64_t> m_RulesRevisions;
+
+    /**
+     * Last revision given to rules
+     */
+    uint64_t m_LastRulesRevision;
+
+    /**
+     * The rules of a connector before a transaction changed them
+     */
+    struct PreviousRules {
+        bool existed;
+        std::vector<GatewayAclRules> rules;
+        uint64_t committedRevision;
+    };
+
+    /**
+     * Map of connectorIds to their rules before a transaction changed them
+     */
+    typedef std::map<qcc::String, PreviousRules> TransactionUndoLog;
+
+    /**
+     * Recursive lock held by the thread running a transaction
+     */
+    pthread_mutex_t m_TransactionLock;
+
+    /**
+     * The thread running the transaction
+     */
+    pthread_t m_TransactionOwner;
+
+    /**
+     * A rule change staged in a transaction
+     */
+    struct StagedRules {
+        bool removed;
+        std::vector<GatewayAclRules> rules;
+    };
+
+    /**
+     * Map of connectorIds to their staged rules
+     */
+    typedef std::map<qcc::String, StagedRules> StagedRulesMap;
+
+    /**
+     * The changes staged by one nesting level of the running transaction
+     */
+    struct TransactionLevel {
+        StagedRulesMap rules;
+        bool defaultPoliciesChanged;
+    };
+
+    /**
+     * The levels of the running transaction, outermost first. Empty when there is none
+     */
+    std::vector<TransactionLevel> m_TransactionLevels;
+
+    /**
+     * Listener restoring the rules of a transaction whose commit failed
+     */
+    class TransactionRollback;
+
+    /**
+     * Listener deleting a BusObject once the commit it waits for is done
+     */
+    class BusObjectRelease;
+
     /**
      * Filename for the gateway agent default policies file
      */
@@ -168,25 +456,327 @@ class GatewayRouterPolicyManager : public AboutListener {
      */
     qcc::String m_appPolicyDirectory;
 
+    /**
+     * Whether every Acl is written to its own fragment
+     */
+    bool m_AclPolicyFragments;
+
+    /**
+     * The serialized policies of one revision of Acl rules
+     */
+    struct RulesFragment {
+        std::vector<qcc::String> busNames;         //announced bus names of the remoted apps when serialized
+        std::string data;
+    };
+
+    /**
+     * Serialized policies of a connector by rules revision
+     */
+    typedef std::map<uint64_t, RulesFragment> RulesFragmentCache;
+
+    /**
+     * Serialized policies by connectorId. An entry exists for every connector with rules, so the
+     * workers writing the policies only modify the cache of their own connector. Only the rules
+     * of single Acls have a revision, so only the fragment layout uses the cache
+     */
+    std::map<qcc::String, RulesFragmentCache> m_RulesFragments;
+
+    /**
+     * Lock protecting the rules and announced devices while they are updated or written
+     */
+    pthread_mutex_t m_PolicyLock;
+
+    /**
+     * Scheduler batching the autocommitted changes
+     */
+    GatewayPolicyCommitScheduler m_CommitScheduler;
+
+    /**
+     * Fingerprint of a policy file as last written or read
+     */
+    struct PolicyFileState {
+        uint64_t hash;
+        off_t size;
+        time_t mtime;
+    };
+
+    /**
+     * Map of policy filenames to the fingerprint of their content
+     */
+    std::map<qcc::String, PolicyFileState> m_PolicyFileStates;
+
+    /**
+     * Policy files staged by the current commit. They share one sync barrier
+     */
+    GatewayPersistenceBatch m_PolicyFileBatch;
+
+    /**
+     * Hashes of the policy files staged by the current commit
+     */
+    std::map<qcc::String, uint64_t> m_StagedPolicyHashes;
+
+    /**
+     * Acl fragments whose removal is staged by the current commit
+     */
+    std::set<qcc::String> m_StagedFragmentRemovals;
+
+    /**
+     * Lock protecting the policy file fingerprints while app policies are written in parallel
+     */
+    pthread_mutex_t m_PolicyFileStateLock;
+
+    /**
+     * Writer reused to generate the default policy file
+     */
+    GatewayXmlWriter m_XmlWriter;
+
+    /**
+     * Workers generating and staging the app policy files in parallel
+     */
+    GatewayWorkerPool m_WorkerPool;
+
+    /**
+     * Writer reused by each worker to generate the app policy files
+     */
+    std::vector<GatewayXmlWriter> m_WorkerWriters;
+
+    /**
+     * Task writing the policy files of a set of connectors
+     */
+    class AppPoliciesTask;
+
+    /**
+     * Whether policy files were written or removed since the last successful reload
+     */
+    bool m_ReloadPending;
+
+    /**
+     * Incremented whenever m_ReloadPending is set, so that a reload only clears it
+     * for the files it saw
+     */
+    uint64_t m_PolicyFilesVersion;
+
     /**
      * Helper function to write the default policies to a file
+     * @param changed - set to true if the file content changed
      * @return status - success/failure
      */
-    QStatus writeDefaultPolicies();
+    QStatus writeDefaultPolicies(bool& changed);
 
     /**
      * Write Policies for an app to the daemon config file
      * @param iter - iter pointing to connectorId to process
+     * @param writer - the writer used to generate the file
+     * @param changed - set to true if the file content changed
      * @return success/failure
      */
-    QStatus writeAppPolicies(std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter);
+    QStatus writeAppPolicies(std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter, GatewayXmlWriter& writer, bool& changed);
 
     /**
-     * Commit ies for an app to the daemon config file
-     * @param iter - iter pointing to connectorId to process
+     * Write the policies of several apps on the worker pool
+     * @param apps - iters pointing to the connectorIds to process
+     * @param changed - set to true if the content of a file changed
+     * @return success/failure
+     */
+    QStatus writeAppPolicies(std::vector<std::map<qcc::String, std::vector<GatewayAclRules> >::iterator> const& apps, bool& changed);
+
+    /**
+     * Stage a policy document unless the file already holds the same content
+     * @param fileName - the file to write
+     * @param writer - the writer holding the document
+     * @param changed - set to true if the file was staged
+     * @return success/failure
+     */
+    QStatus savePolicyFile(qcc::String const& fileName, GatewayXmlWriter const& writer, bool& changed);
+
+    /**
+     * Atomically replace all staged policy files and record their fingerprints
      * @return success/failure
      */
-    QStatus commitAppPolicies(std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter);
+    QStatus persistPolicyFiles();
+
+    /**
+     * Discard all staged policy files
+     */
+    void discardPolicyFiles();
+
+    /**
+     * Record that the policy files changed and the config must be reloaded.
+     * Called with the policy lock held
+     */
+    void markReloadPending();
+
+    /**
+     * Clear the pending reload after a successful reload, unless the policy files
+     * changed again meanwhile
+     * @param version - m_PolicyFilesVersion when the reload was decided
+     */
+    void clearReloadPending(uint64_t version);
+
+    /**
+     * Get the fingerprint of a policy file, rehashing it if it changed on disk
+     * @param fileName - the file to look up
+     * @param state - the fingerprint of the file
+     * @return true if the file exists
+     */
+    bool getPolicyFileState(qcc::String const& fileName, PolicyFileState& state);
+
+    /**
+     * Schedule the commit of the policies of the given connectors
+     * @param connectorIds - the connectorIds to rewrite
+     */
+    void scheduleCommit(std::set<qcc::String> const& connectorIds);
+
+    /**
+     * Call WhoImplements for an interface. An empty name subscribes to all announcements
+     * @param interfaceName - the interface
+     * @return status - success/failure
+     */
+    QStatus whoImplements(qcc::String const& interfaceName);
+
+    /**
+     * Cancel the WhoImplements of an interface. An empty name cancels the subscription to all announcements
+     * @param interfaceName - the interface
+     * @return status - success/failure
+     */
+    QStatus cancelWhoImplements(qcc::String const& interfaceName);
+
+    /**
+     * Record an announcement in the announced devices. Called with the policy lock held
+     * @param key - the announced device
+     * @param busName - the busName it announced from
+     * @param announcementHash - hash of the announcement's appId, deviceId and busName
+     * @return true if the busName of the device changed
+     */
+    bool addAnnouncedDevice(GatewayAppIdentifier const& key, qcc::String const& busName, uint64_t announcementHash);
+
+    /**
+     * Refresh the eviction state of a device that announced again. Called with the policy lock held
+     * @param key - the announced device
+     * @param announcementHash - hash of the announcement's appId, deviceId and busName
+     */
+    void touchAnnouncedDevice(GatewayAppIdentifier const& key, uint64_t announcementHash);
+
+    /**
+     * Remove a device from the announced devices. Called with the policy lock held
+     * @param key - the device to remove
+     */
+    void removeAnnouncedDevice(GatewayAppIdentifier const& key);
+
+    /**
+     * Evict expired and least recently announced devices that are not
+     * referenced by an active Acl. Called with the policy lock held
+     */
+    void evictAnnouncedDevices();
+
+    /**
+     * Write every policy file and reload the config if any changed
+     * @return success/failure
+     */
+    QStatus commitAllPolicies();
+
+    /**
+     * Commit the changed policies of a connector if autocommit is on. Changes are
+     * batched by the commit scheduler while it is running
+     * @param connectorId - the connectorId that changed
+     * @param defaultPoliciesChanged - whether the default policy file changed as well
+     * @return success/failure
+     */
+    bool scheduleCommit(qcc::String const& connectorId, bool defaultPoliciesChanged);
+
+    /**
+     * Add the remote apps referenced by rules to the reverse index
+     * @param connectorId - the connectorId owning the rules
+     * @param rules - the rules to index
+     */
+    void indexConnectorAppRules(qcc::String const& connectorId, std::vector<GatewayAclRules> const& rules);
+
+    /**
+     * Remove all entries of a connector from the reverse index
+     * @param connectorId - the connectorId to remove
+     */
+    void unindexConnectorAppRules(qcc::String const& connectorId);
+
+    /**
+     * Replace the rules of a connector and update the index and its revision.
+     * Called with m_PolicyLock held
+     * @param connectorId - the connectorId to update
+     * @param rules - the new rules. NULL to remove the connector
+     */
+    void setConnectorAppRules(qcc::String const& connectorId, std::vector<GatewayAclRules> const* rules);
+
+    /**
+     * Stage a rule change in the innermost level of the calling thread's transaction.
+     * Called with m_PolicyLock held
+     * @param connectorId - the connectorId to change
+     * @param defaultPoliciesChanged - whether the change affects the default policy file
+     * @param rules - the new rules. NULL to remove the connector
+     * @return true if the change is staged in a transaction, false if it must be applied
+     */
+    bool stageRulesChange(qcc::String const& connectorId, bool defaultPoliciesChanged, std::vector<GatewayAclRules> const* rules);
+
+    /**
+     * Is the calling thread running a transaction. Called with m_PolicyLock held
+     * @return true/false
+     */
+    bool inTransaction() const;
+
+    /**
+     * Does a connector have rules, counting the changes staged by the calling
+     * thread's transaction. Called with m_PolicyLock held
+     * @param connectorId - the connectorId
+     * @return true/false
+     */
+    bool hasConnectorAppRules(qcc::String const& connectorId) const;
+
+    /**
+     * Restore the rules a committed transaction replaced, unless they changed since.
+     * The policy files of connectors it added are deleted
+     * @param undoLog - the rules before the transaction
+     * @return the connectorIds that were restored
+     */
+    std::set<qcc::String> restoreRules(TransactionUndoLog const& undoLog);
+
+    /**
+     * Delete the policy file of a connector. Called with m_PolicyLock held
+     * @param connectorId - the connectorId whose file is deleted
+     */
+    void removeAppPolicyFile(qcc::String const& connectorId);
+
+    /**
+     * Get the directory holding the Acl fragments of a connector
+     * @param connectorId - the connectorId
+     * @return the directory
+     */
+    qcc::String getAclFragmentDirectory(qcc::String const& connectorId) const;
+
+    /**
+     * Write the fragment of one Acl
+     * @param connectorId - the connector the Acl belongs to
+     * @param rules - the rules of the Acl
+     * @param writer - the writer to generate the fragment with
+     * @param changed - set to whether the fragment was rewritten
+     * @return success/failure
+     */
+    QStatus writeAclFragment(qcc::String const& connectorId, GatewayAclRules const& rules, GatewayXmlWriter& writer, bool& changed);
+
+    /**
+     * Write the policies of one Acl, splicing in the serialized policies of an unchanged revision
+     * @param writer - the writer to use
+     * @param rules - the rules of the Acl
+     * @param cache - the serialized policies of the connector. NULL, or rules without a revision, to write without caching
+     * @return rc - success/failure
+     */
+    int writeAclUserPolicies(GatewayXmlWriter& writer, GatewayAclRules const& rules, RulesFragmentCache* cache);
+
+    /**
+     * Stage the removal of the Acl fragments of a connector that are no longer active.
+     * They are deleted by the next persistPolicyFiles
+     * @param connectorId - the connectorId
+     * @param activeAclIds - the aclIds whose fragments are kept
+     * @return whether a fragment removal was staged
+     */
+    bool removeAclFragments(qcc::String const& connectorId, std::set<qcc::String> const& activeAclIds);
 
     /**
      * Helper function to write the default ies per user to a file
@@ -194,7 +784,7 @@ class GatewayRouterPolicyManager : public AboutListener {
      * @param userName - user the y should be written for
      * @return rc - success/failure
      */
-    int writeDefaultUserPolicies(xmlTextWriterPtr writer, qcc::String const& userName);
+    int writeDefaultUserPolicies(GatewayXmlWriter& writer, qcc::String const& userName);
 
     /**
      * Helper function to write the default policies per user to a file
@@ -202,7 +792,15 @@ class GatewayRouterPolicyManager : public AboutListener {
      * @param policies - the policies that should be written for this User
      * @return rc - success/failure
      */
-    int writeAclUserPolicies(xmlTextWriterPtr writer, std::vector<GatewayAclRules> const& rules);
+    int writeAclUserPolicies(GatewayXmlWriter& writer, std::vector<GatewayAclRules> const& rules);
+
+    /**
+     * Helper function to write the policies of one Acl
+     * @param writer - the writer to use
+     * @param rules - the rules of the Acl
+     * @return rc - success/failure
+     */
+    int writeAclUserPolicies(GatewayXmlWriter& writer, GatewayAclRules const& rules);
 
     /**
      * Helper function to write RemotedApps to a file
@@ -211,7 +809,7 @@ class GatewayRouterPolicyManager : public AboutListener {
      * @param uniqueName - the uniqueName for the object where applicable
      * @return rc - success/failure
      */
-    int writeRemotedApps(xmlTextWriterPtr writer, const GatewayRuleObjectDescriptions& objects, qcc::String const& uniqueName);
+    int writeRemotedApps(GatewayXmlWriter& writer, const GatewayRuleObjectDescriptions& objects, qcc::String const& uniqueName);
 
     /**
      * Helper function to write ExposedServices to a file
@@ -219,7 +817,7 @@ class GatewayRouterPolicyManager : public AboutListener {
      * @param objects - the objects to write
      * @return rc - success/failure
      */
-    int writeExposedServices(xmlTextWriterPtr writer, const GatewayRuleObjectDescriptions& objects);
+    int writeExposedServices(GatewayXmlWriter& writer, const GatewayRuleObjectDescriptions& objects);
 
 };
 
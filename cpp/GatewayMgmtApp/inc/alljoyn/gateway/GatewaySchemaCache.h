@@ -0,0 +1,138 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_SCHEMACACHE_H_
+#define GATEWAY_SCHEMACACHE_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <map>
+#include <qcc/String.h>
+#include <alljoyn/Status.h>
+#include <libxml/xmlschemas.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewaySchemaCache - Process wide cache of compiled xml schemas. A schema is compiled
+ * on first use and again once its file changes, recognized by its modification time,
+ * size and inode. Every thread validates with its own context, kept for the next validation
+ */
+class GatewaySchemaCache {
+
+  public:
+
+    /**
+     * Get the process wide cache
+     * @return the instance
+     */
+    static GatewaySchemaCache* getInstance();
+
+    /**
+     * Validate a document against a schema
+     * @param schemaFileName - the schema file
+     * @param doc - the document
+     * @return status - ER_OK if valid, ER_BUS_BAD_XML if invalid, ER_FAIL if the schema could not be used
+     */
+    QStatus validate(qcc::String const& schemaFileName, xmlDocPtr doc);
+
+    /**
+     * Drop the compiled schemas and the contexts of the calling thread. Schemas still
+     * used by the contexts of other threads are freed with those
+     */
+    void clear();
+
+  private:
+
+    /**
+     * A compiled schema
+     */
+    struct Schema {
+        xmlSchemaPtr schema;            ///< The compiled schema
+        uint64_t mtimeNs;               ///< Modification time of the file it was compiled from
+        off_t size;                     ///< Size of the file
+        ino_t inode;                    ///< Inode of the file
+        size_t refCount;                ///< The cache and the thread contexts using it
+    };
+
+    /**
+     * The validation context of a thread for one schema file
+     */
+    struct ThreadContext {
+        Schema* schema;                 ///< The schema the context validates against. Holds a reference
+        xmlSchemaValidCtxtPtr validCtxt;
+    };
+
+    /**
+     * The validation contexts of a thread by schema file
+     */
+    typedef std::map<qcc::String, ThreadContext> ThreadContexts;
+
+    /**
+     * Constructor for the GatewaySchemaCache class
+     */
+    GatewaySchemaCache();
+
+    /**
+     * Destructor for the GatewaySchemaCache class
+     */
+    virtual ~GatewaySchemaCache();
+
+    /**
+     * Get the current schema of a file, compiling it if needed
+     * @param fileName - the schema file
+     * @return schema with a reference for the caller. NULL if it could not be compiled
+     */
+    Schema* acquire(qcc::String const& fileName);
+
+    /**
+     * Drop a reference to a schema and free it with the last one
+     * @param schema - the schema
+     */
+    void release(Schema* schema);
+
+    /**
+     * Free the validation contexts of a thread. Run when the thread exits
+     * @param contexts - the ThreadContexts of the thread
+     */
+    static void freeThreadContexts(void* contexts);
+
+    /**
+     * The process wide instance
+     */
+    static GatewaySchemaCache s_Instance;
+
+    /**
+     * The current schema of each file
+     */
+    std::map<qcc::String, Schema*> m_Schemas;
+
+    /**
+     * Lock protecting m_Schemas and the reference counts
+     */
+    pthread_mutex_t m_Lock;
+
+    /**
+     * Key of the ThreadContexts of each thread
+     */
+    pthread_key_t m_ThreadContexts;
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_SCHEMACACHE_H_ */
@@ -0,0 +1,202 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_SNAPSHOT_H_
+#define GATEWAY_SNAPSHOT_H_
+
+#include <map>
+#include <vector>
+#include <qcc/String.h>
+#include <alljoyn/Status.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewaySnapshot - Versioned binary image of the state loaded from the xml files, read at
+ * startup instead of parsing them. The snapshot records the modification time of the files
+ * and directories it was taken from and is rejected when any of them changed
+ */
+class GatewaySnapshot {
+
+  public:
+
+    /**
+     * Version of the snapshot format. Snapshots of another version are ignored
+     */
+    static const uint32_t VERSION = 2;
+
+    /**
+     * Constructor for the GatewaySnapshot class
+     */
+    GatewaySnapshot();
+
+    /**
+     * Destructor for the GatewaySnapshot class
+     */
+    virtual ~GatewaySnapshot();
+
+    /**
+     * Record the current state of a file or directory the snapshot depends on
+     * @param fileName - the file or directory. May not exist
+     */
+    void addFile(qcc::String const& fileName);
+
+    /**
+     * Append a value to the snapshot
+     * @param value - the value
+     */
+    void putUInt8(uint8_t value);
+
+    /**
+     * Append a value to the snapshot
+     * @param value - the value
+     */
+    void putUInt32(uint32_t value);
+
+    /**
+     * Append a value to the snapshot
+     * @param value - the value
+     */
+    void putUInt64(uint64_t value);
+
+    /**
+     * Append a value to the snapshot
+     * @param value - the value
+     */
+    void putString(qcc::String const& value);
+
+    /**
+     * Append a value to the snapshot
+     * @param values - the values
+     */
+    void putStrings(std::vector<qcc::String> const& values);
+
+    /**
+     * Append a value to the snapshot
+     * @param values - the values
+     */
+    void putStringMap(std::map<qcc::String, qcc::String> const& values);
+
+    /**
+     * Write the snapshot to a file
+     * @param fileName - the file
+     * @return status - success/failure
+     */
+    QStatus save(qcc::String const& fileName);
+
+    /**
+     * Read a snapshot from a file. Fails if the file is missing, corrupt, of another
+     * version, or if one of the files it depends on changed
+     * @param fileName - the file
+     * @return status - success/failure
+     */
+    QStatus load(qcc::String const& fileName);
+
+    /**
+     * Read the next value of the snapshot
+     * @param value - filled with the value
+     * @return true if read, false if the snapshot ended
+     */
+    bool getUInt8(uint8_t& value);
+
+    /**
+     * Read the next value of the snapshot
+     * @param value - filled with the value
+     * @return true if read, false if the snapshot ended
+     */
+    bool getUInt32(uint32_t& value);
+
+    /**
+     * Read the next value of the snapshot
+     * @param value - filled with the value
+     * @return true if read, false if the snapshot ended
+     */
+    bool getUInt64(uint64_t& value);
+
+    /**
+     * Read the next value of the snapshot
+     * @param value - filled with the value
+     * @return true if read, false if the snapshot ended
+     */
+    bool getString(qcc::String& value);
+
+    /**
+     * Read the next value of the snapshot
+     * @param values - filled with the values
+     * @return true if read, false if the snapshot ended
+     */
+    bool getStrings(std::vector<qcc::String>& values);
+
+    /**
+     * Read the next value of the snapshot
+     * @param values - filled with the values
+     * @return true if read, false if the snapshot ended
+     */
+    bool getStringMap(std::map<qcc::String, qcc::String>& values);
+
+    /**
+     * Have all the reads succeeded so far
+     * @return true if no read went past the end of the snapshot
+     */
+    bool isValid() const;
+
+  private:
+
+    /**
+     * Serialized file states
+     */
+    std::vector<uint8_t> m_Files;
+
+    /**
+     * Number of file states in m_Files
+     */
+    uint32_t m_NumFiles;
+
+    /**
+     * Serialized values
+     */
+    std::vector<uint8_t> m_Data;
+
+    /**
+     * Read position in m_Data
+     */
+    size_t m_ReadPosition;
+
+    /**
+     * Did a read go past the end
+     */
+    bool m_Invalid;
+
+    /**
+     * Check that the recorded file states at the start of m_Data are still current
+     * @return true if none of the files changed
+     */
+    bool checkFiles();
+
+    /**
+     * Read raw bytes
+     * @param data - filled with the bytes
+     * @param length - number of bytes
+     * @return true if read
+     */
+    bool getBytes(void* data, size_t length);
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_SNAPSHOT_H_ */
@@ -0,0 +1,226 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_STATS_H_
+#define GATEWAY_STATS_H_
+
+#include <pthread.h>
+#include <qcc/platform.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * Counters collected by GatewayStats
+ */
+typedef enum {
+    GW_STAT_POLICY_COMMITS,             //!< Policy commits done
+    GW_STAT_POLICY_COMMIT_FAILURES,     //!< Policy commits that failed
+    GW_STAT_POLICY_RELOADS,             //!< Router config reloads requested
+    GW_STAT_POLICY_RELOAD_FAILURES,     //!< Router config reloads that failed
+    GW_STAT_POLICY_FILES_WRITTEN,       //!< Policy files written to disk
+    GW_STAT_POLICY_FILES_UNCHANGED,     //!< Policy file writes skipped because the content did not change
+    GW_STAT_POLICY_BYTES_WRITTEN,       //!< Bytes of policy written to disk
+    GW_STAT_ANNOUNCEMENTS,              //!< Announcements received
+    GW_STAT_ANNOUNCEMENTS_UNCHANGED,    //!< Announcements identical to the previous one of the device
+    GW_STAT_ANNOUNCED_DEVICES_EVICTED,  //!< Announced devices dropped by the cap or the ttl
+    GW_STAT_CONNECTOR_APP_EXITS,        //!< Connector app processes that exited
+    GW_STAT_METADATA_WRITES,            //!< Metadata file writes
+    GW_STAT_JOURNAL_RECORDS,            //!< Records appended to the journal
+    GW_STAT_JOURNAL_SYNCS,              //!< Syncs of the journal. Records committed together share one
+    GW_STAT_JOURNAL_COMPACTIONS,        //!< Journal folds into the files
+    GW_STAT_ACL_BODY_LOADS,             //!< Acl rules parsed on first access
+    GW_STAT_ACL_BODY_EVICTIONS,         //!< Inactive Acl rules dropped from memory
+    GW_STAT_SCHEMA_COMPILES,            //!< Xml schemas compiled by the schema cache
+    GW_STAT_NUM_COUNTERS
+} GatewayStatsCounter;
+
+/**
+ * Latency histograms collected by GatewayStats
+ */
+typedef enum {
+    GW_LATENCY_POLICY_COMMIT,           //!< Time to write the policies of a commit
+    GW_LATENCY_POLICY_RELOAD,           //!< Time to reload the router config
+    GW_LATENCY_METHOD_CALL,             //!< Time spent in the bus object method handlers. Replies sent
+                                        //!< once a commit is done are not included
+    GW_LATENCY_NUM_HISTOGRAMS
+} GatewayStatsHistogram;
+
+/**
+ * GatewayStats - Process wide counters and latency histograms of the agent.
+ * Latencies are kept in microseconds, in power of two buckets
+ */
+class GatewayStats {
+
+  public:
+
+    /**
+     * Number of buckets of a histogram. Bucket i holds the samples below 2^i us,
+     * the last one everything above
+     */
+    static const size_t NUM_BUCKETS = 32;
+
+    /**
+     * A snapshot of a histogram
+     */
+    struct Histogram {
+        uint64_t count;
+        uint64_t sumUs;
+        uint64_t maxUs;
+        uint64_t buckets[NUM_BUCKETS];
+    };
+
+    /**
+     * Get the instance of GatewayStats
+     * @return instance
+     */
+    static GatewayStats* getInstance();
+
+    /**
+     * Get the time of a monotonic clock
+     * @return time in microseconds
+     */
+    static uint64_t getMonotonicUs();
+
+    /**
+     * Get the name of a counter
+     * @param counter - the counter
+     * @return name
+     */
+    static const char* getCounterName(GatewayStatsCounter counter);
+
+    /**
+     * Get the name of a histogram
+     * @param histogram - the histogram
+     * @return name
+     */
+    static const char* getHistogramName(GatewayStatsHistogram histogram);
+
+    /**
+     * Add to a counter
+     * @param counter - the counter
+     * @param delta - optional. the amount to add
+     */
+    void increment(GatewayStatsCounter counter, uint64_t delta = 1);
+
+    /**
+     * Add a sample to a histogram
+     * @param histogram - the histogram
+     * @param latencyUs - the sample in microseconds
+     */
+    void recordLatency(GatewayStatsHistogram histogram, uint64_t latencyUs);
+
+    /**
+     * Take a snapshot of the counters and histograms
+     * @param counters - filled with GW_STAT_NUM_COUNTERS values
+     * @param histograms - filled with GW_LATENCY_NUM_HISTOGRAMS histograms
+     * @param elapsedMs - filled with the time since the last reset
+     */
+    void getSnapshot(uint64_t* counters, Histogram* histograms, uint64_t* elapsedMs);
+
+    /**
+     * Zero all the counters and histograms
+     */
+    void reset();
+
+  private:
+
+    /**
+     * Constructor for the GatewayStats class
+     */
+    GatewayStats();
+
+    /**
+     * Destructor for the GatewayStats class
+     */
+    virtual ~GatewayStats();
+
+    /**
+     * The instance
+     */
+    static GatewayStats s_Instance;
+
+    /**
+     * Lock protecting the values
+     */
+    pthread_mutex_t m_Lock;
+
+    /**
+     * The counters
+     */
+    uint64_t m_Counters[GW_STAT_NUM_COUNTERS];
+
+    /**
+     * The histograms
+     */
+    Histogram m_Histograms[GW_LATENCY_NUM_HISTOGRAMS];
+
+    /**
+     * Time of the last reset
+     */
+    uint64_t m_ResetTimeUs;
+
+    /**
+     * Copy constructor - not implemented
+     */
+    GatewayStats(const GatewayStats&);
+
+    /**
+     * Assignment operator - not implemented
+     */
+    GatewayStats& operator=(const GatewayStats&);
+};
+
+/**
+ * GatewayStatsTimer - Records the time between its construction and destruction
+ * in a histogram
+ */
+class GatewayStatsTimer {
+
+  public:
+
+    /**
+     * Constructor for the GatewayStatsTimer class
+     * @param histogram - the histogram to record the time in
+     */
+    GatewayStatsTimer(GatewayStatsHistogram histogram) :
+        m_Histogram(histogram), m_StartUs(GatewayStats::getMonotonicUs()) { }
+
+    /**
+     * Destructor for the GatewayStatsTimer class
+     */
+    ~GatewayStatsTimer()
+    {
+        GatewayStats::getInstance()->recordLatency(m_Histogram, GatewayStats::getMonotonicUs() - m_StartUs);
+    }
+
+  private:
+
+    /**
+     * The histogram to record the time in
+     */
+    GatewayStatsHistogram m_Histogram;
+
+    /**
+     * Time of the construction
+     */
+    uint64_t m_StartUs;
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_STATS_H_ */
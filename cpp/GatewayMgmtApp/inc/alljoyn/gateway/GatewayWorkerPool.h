@@ -0,0 +1,195 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_WORKERPOOL_H_
+#define GATEWAY_WORKERPOOL_H_
+
+#include <pthread.h>
+#include <vector>
+#include <qcc/platform.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewayWorkerTask - A set of independent work items run by a GatewayWorkerPool
+ */
+class GatewayWorkerTask {
+
+  public:
+
+    /**
+     * Destructor for the GatewayWorkerTask class
+     */
+    virtual ~GatewayWorkerTask() { }
+
+    /**
+     * Run one work item. Called concurrently for different items
+     * @param taskIndex - the index of the item
+     * @param workerIndex - the index of the worker running it. Workers run one item at a time
+     */
+    virtual void execute(size_t taskIndex, size_t workerIndex) = 0;
+};
+
+/**
+ * GatewayWorkerPool - Fixed set of threads, sized to the cores by default, running the
+ * items of a task in parallel. The calling thread works as worker 0 and run() returns
+ * once every item is done. The threads are started on the first parallel run
+ */
+class GatewayWorkerPool {
+
+  public:
+
+    /**
+     * Constructor for the GatewayWorkerPool class
+     * @param numWorkers - optional. number of workers, the caller included. 0 for one per core
+     */
+    GatewayWorkerPool(size_t numWorkers = 0);
+
+    /**
+     * Destructor for the GatewayWorkerPool class
+     */
+    virtual ~GatewayWorkerPool();
+
+    /**
+     * Get the number of workers, the caller included
+     * @return numWorkers
+     */
+    size_t getNumWorkers() const;
+
+    /**
+     * Change the number of workers. The running threads are stopped and the new
+     * ones are started on the next parallel run
+     * @param numWorkers - number of workers, the caller included. 0 for one per core
+     */
+    void setNumWorkers(size_t numWorkers);
+
+    /**
+     * Run the items of a task and wait for them
+     * @param task - the task
+     * @param numTasks - the number of items
+     */
+    void run(GatewayWorkerTask& task, size_t numTasks);
+
+  private:
+
+    /**
+     * A thread of the pool
+     */
+    struct WorkerThread {
+        GatewayWorkerPool* pool;
+        size_t index;
+        pthread_t thread;
+    };
+
+    /**
+     * Number of workers, the caller included
+     */
+    size_t m_NumWorkers;
+
+    /**
+     * The started threads
+     */
+    std::vector<WorkerThread> m_Threads;
+
+    /**
+     * Serializes concurrent calls to run
+     */
+    pthread_mutex_t m_RunLock;
+
+    /**
+     * Lock protecting the state of the current run
+     */
+    pthread_mutex_t m_Lock;
+
+    /**
+     * Signaled when a run starts or the pool stops
+     */
+    pthread_cond_t m_WorkAvailable;
+
+    /**
+     * Signaled when the last thread finished its part of a run
+     */
+    pthread_cond_t m_WorkDone;
+
+    /**
+     * The task of the current run
+     */
+    GatewayWorkerTask* m_Task;
+
+    /**
+     * Number of items of the current run
+     */
+    size_t m_NumTasks;
+
+    /**
+     * Next item to hand out
+     */
+    size_t m_NextTask;
+
+    /**
+     * Incremented for every run so the threads see each run once
+     */
+    uint64_t m_Generation;
+
+    /**
+     * Number of threads still working on the current run
+     */
+    size_t m_BusyThreads;
+
+    /**
+     * Are the threads being stopped
+     */
+    bool m_IsStopping;
+
+    /**
+     * Stop and join the threads. Called with m_RunLock held
+     */
+    void stopThreads();
+
+    /**
+     * Run items until none is left
+     * @param workerIndex - the index of the worker
+     */
+    void executeTasks(size_t workerIndex);
+
+    /**
+     * A wrapper for the worker threads
+     * @param context
+     */
+    static void* WorkerThreadWrapper(void* context);
+
+    /**
+     * The function run in a worker thread
+     * @param workerIndex - the index of the worker
+     */
+    void WorkerThreadLoop(size_t workerIndex);
+
+    /**
+     * Copy constructor - not implemented
+     */
+    GatewayWorkerPool(const GatewayWorkerPool&);
+
+    /**
+     * Assignment operator - not implemented
+     */
+    GatewayWorkerPool& operator=(const GatewayWorkerPool&);
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_WORKERPOOL_H_ */
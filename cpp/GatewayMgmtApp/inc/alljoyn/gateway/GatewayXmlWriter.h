@@ -0,0 +1,175 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef GATEWAY_XMLWRITER_H_
+#define GATEWAY_XMLWRITER_H_
+
+#include <string>
+#include <vector>
+#include <qcc/String.h>
+
+namespace ajn {
+namespace gw {
+
+/**
+ * GatewayXmlWriter - Lightweight streaming xml emitter. Writes escaped xml straight into a
+ * growable buffer without building a document tree. The output is formatted the same way
+ * xmlSaveFormatFile formats a document. The buffer is kept across reset() calls so a
+ * writer can be reused for many documents without reallocating
+ */
+class GatewayXmlWriter {
+
+  public:
+
+    /**
+     * Constructor for the GatewayXmlWriter class
+     * @param initialCapacity - optional. number of bytes to reserve up front
+     */
+    GatewayXmlWriter(size_t initialCapacity = 0);
+
+    /**
+     * Destructor for the GatewayXmlWriter class
+     */
+    virtual ~GatewayXmlWriter();
+
+    /**
+     * Clear the content of the writer, keeping its buffer
+     */
+    void reset();
+
+    /**
+     * Start the document by writing the xml declaration
+     * @return rc - negative on failure
+     */
+    int startDocument();
+
+    /**
+     * Write a comment
+     * @param comment - the text of the comment
+     * @return rc - negative on failure
+     */
+    int writeComment(const char* comment);
+
+    /**
+     * Open an element
+     * @param name - the name of the element
+     * @return rc - negative on failure
+     */
+    int startElement(const char* name);
+
+    /**
+     * Write an attribute of the element that was just opened
+     * @param name - the name of the attribute
+     * @param value - the value of the attribute. It is escaped
+     * @return rc - negative on failure, or if the value has a control character XML 1.0 doesn't allow
+     */
+    int writeAttribute(const char* name, const char* value);
+
+    /**
+     * Write an element containing only text
+     * @param name - the name of the element
+     * @param content - the text of the element. It is escaped
+     * @return rc - negative on failure, or if the content has a control character XML 1.0 doesn't allow
+     */
+    int writeElement(const char* name, const char* content);
+
+    /**
+     * Close the innermost open element
+     * @return rc - negative on failure
+     */
+    int endElement();
+
+    /**
+     * Close all open elements and end the document
+     * @return rc - negative on failure
+     */
+    int endDocument();
+
+    /**
+     * Write content serialized earlier by this writer at the same depth
+     * @param data - the content
+     * @param length - the length of the content
+     * @return rc - negative on failure
+     */
+    int writeRaw(const char* data, size_t length);
+
+    /**
+     * Whether the start tag of the innermost element is still open.
+     * Content written next starts by closing it
+     * @return true if open
+     */
+    bool isStartTagOpen() const;
+
+    /**
+     * Get the content written so far
+     * @return data
+     */
+    const char* getData() const;
+
+    /**
+     * Get the length of the content written so far
+     * @return size
+     */
+    size_t getSize() const;
+
+  private:
+
+    /**
+     * An element that is still open
+     */
+    struct OpenElement {
+        size_t nameOffset;
+        size_t nameLength;
+        bool startTagOpen;
+    };
+
+    /**
+     * The buffer holding the document
+     */
+    std::string m_Buffer;
+
+    /**
+     * The elements that are still open, outermost first
+     */
+    std::vector<OpenElement> m_OpenElements;
+
+    /**
+     * Names of the open elements. Copied so callers may pass temporaries
+     */
+    std::string m_Names;
+
+    /**
+     * Close the start tag of the innermost element before writing a child
+     */
+    void closeStartTag();
+
+    /**
+     * Write the indentation of the current depth
+     */
+    void writeIndent();
+
+    /**
+     * Write escaped text
+     * @param text - the text to write
+     * @param inAttribute - whether the text is an attribute value
+     */
+    void writeEscaped(const char* text, bool inAttribute);
+};
+
+} /* namespace gw */
+} /* namespace ajn */
+
+#endif /* GATEWAY_XMLWRITER_H_ */
@@ -18,13 +18,18 @@
 #include <alljoyn/gateway/GatewayConnectorApp.h>
 #include <alljoyn/gateway/GatewayMgmt.h>
 #include <alljoyn/gateway/GatewayMetadataManager.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayStats.h>
 #include "busObjects/AclBusObject.h"
 #include "busObjects/AppBusObject.h"
 #include "GatewayConstants.h"
+#include <algorithm>
 #include <fstream>
+#include <list>
 #include <sstream>
 #include <dirent.h>
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -33,22 +38,54 @@ namespace gw {
 using namespace gwConsts;
 using namespace qcc;
 
+static pthread_mutex_t s_RevisionLock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t s_LastRevision = 0;
+
+static uint64_t nextRevision()
+{
+    pthread_mutex_lock(&s_RevisionLock);
+    uint64_t revision = ++s_LastRevision;
+    pthread_mutex_unlock(&s_RevisionLock);
+    return revision;
+}
+
+//guards the rules and customMetadata of all Acls, which are loaded and evicted on demand
+static pthread_mutex_t s_BodyLock = PTHREAD_MUTEX_INITIALIZER;
+//loaded rules of inactive Acls, the most recently used first
+static std::list<GatewayAcl*> s_InactiveBodiesLru;
+static uint32_t s_UncountedAcls = 0;
+
 GatewayAcl::GatewayAcl(qcc::String const& aclId, GatewayConnectorApp* connectorApp) :
     m_AclId(aclId), m_AclName(""), m_ObjectPath(connectorApp->getObjectPath() + "/" + aclId),
-    m_AclStatus(GW_AS_INACTIVE), m_AclBusObject(NULL), m_ConnectorApp(connectorApp)
+    m_Revision(nextRevision()), m_AclStatus(GW_AS_INACTIVE), m_AclBusObject(NULL), m_ConnectorApp(connectorApp),
+    m_BodyLoaded(false), m_ReferencesCounted(false), m_Changes(0), m_StagedChanges(0), m_PersistedChanges(0), m_LruPosition(s_InactiveBodiesLru.end())
 {
+    pthread_mutex_lock(&s_BodyLock);
+    s_UncountedAcls++;
+    pthread_mutex_unlock(&s_BodyLock);
 }
 
 GatewayAcl::GatewayAcl(qcc::String const& aclId, qcc::String const& aclName, GatewayConnectorApp* connectorApp,
                        GatewayAclRules const& aclRules, std::map<qcc::String, qcc::String> const& customMetadata, AclStatus aclStatus) :
     m_AclId(aclId), m_AclName(aclName), m_ObjectPath(connectorApp->getObjectPath() + "/" + aclId), m_AclRules(aclRules),
-    m_AclStatus(aclStatus), m_CustomMetadata(customMetadata), m_AclBusObject(NULL), m_ConnectorApp(connectorApp)
+    m_Revision(nextRevision()), m_AclStatus(aclStatus), m_CustomMetadata(customMetadata), m_AclBusObject(NULL), m_ConnectorApp(connectorApp),
+    m_BodyLoaded(true), m_ReferencesCounted(true), m_Changes(1), m_StagedChanges(0), m_PersistedChanges(0), m_LruPosition(s_InactiveBodiesLru.end())
 {
+    pthread_mutex_lock(&s_BodyLock);
+    updateLruPosition();
+    pthread_mutex_unlock(&s_BodyLock);
 }
 
 GatewayAcl::~GatewayAcl()
 {
-
+    pthread_mutex_lock(&s_BodyLock);
+    if (m_LruPosition != s_InactiveBodiesLru.end()) {
+        s_InactiveBodiesLru.erase(m_LruPosition);
+    }
+    if (!m_ReferencesCounted) {
+        s_UncountedAcls--;
+    }
+    pthread_mutex_unlock(&s_BodyLock);
 }
 
 QStatus GatewayAcl::init(BusAttachment* bus)
@@ -66,7 +103,9 @@ QStatus GatewayAcl::init(BusAttachment* bus)
         return status;
     }
 
-    m_AclBusObject = new AclBusObject(bus, this, m_ObjectPath, &status);
+    //unannounced acls are found through the ListAcls method of the app instead of the announcement
+    BusObject::AnnounceFlag announceFlag = GatewayMgmt::getInstance()->getAclsUnannounced() ? BusObject::UNANNOUNCED : BusObject::ANNOUNCED;
+    m_AclBusObject = new AclBusObject(bus, this, m_ObjectPath, announceFlag, &status);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not create AppBusObject"));
         return status;
@@ -95,15 +134,30 @@ QStatus GatewayAcl::shutdown(BusAttachment* bus)
     }
 
     bus->UnregisterBusObject(*m_AclBusObject);
-    delete m_AclBusObject;
+    //the method calls waiting for a policy commit are replied to before the BusObject is deleted
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (policyManager) {
+        policyManager->deleteWhenCommitted(m_AclBusObject);
+    } else {
+        delete m_AclBusObject;
+    }
     m_AclBusObject = NULL;
 
     return status;
 }
 
-const GatewayAclRules& GatewayAcl::getAclRules() const
+GatewayAclRules GatewayAcl::getAclRules()
+{
+    pthread_mutex_lock(&s_BodyLock);
+    touchBody();
+    GatewayAclRules aclRules = m_AclRules;
+    pthread_mutex_unlock(&s_BodyLock);
+    return aclRules;
+}
+
+uint64_t GatewayAcl::getRevision() const
 {
-    return m_AclRules;
+    return m_Revision;
 }
 
 const qcc::String& GatewayAcl::getAclId() const
@@ -126,27 +180,57 @@ const qcc::String& GatewayAcl::getObjectPath() const
     return m_ObjectPath;
 }
 
-const std::map<qcc::String, qcc::String>& GatewayAcl::getCustomMetadata() const
+std::map<qcc::String, qcc::String> GatewayAcl::getCustomMetadata()
 {
-    return m_CustomMetadata;
+    pthread_mutex_lock(&s_BodyLock);
+    touchBody();
+    std::map<qcc::String, qcc::String> customMetadata = m_CustomMetadata;
+    pthread_mutex_unlock(&s_BodyLock);
+    return customMetadata;
 }
 
 AclResponseCode GatewayAcl::updateAclStatus(AclStatus aclStatus)
 {
     bool hasActiveAcl = m_ConnectorApp->hasActiveAcl();
+
+    //the file is rewritten with the rules, and an active Acl needs them for the policy
+    pthread_mutex_lock(&s_BodyLock);
     AclStatus previousStatus = m_AclStatus;
-    m_AclStatus = aclStatus;
+    QStatus status = touchBody();
+    if (status == ER_OK) {
+        m_AclStatus = aclStatus;
+        m_Changes++;
+        updateLruPosition();
+    }
+    pthread_mutex_unlock(&s_BodyLock);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not load the rules of the acl"));
+        return GW_ACL_RC_PERSISTENCE_ERROR;
+    }
 
-    QStatus status = writeToFile();
+    status = writeToFile();
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not persist aclStatus - rolling back changes"));
+        pthread_mutex_lock(&s_BodyLock);
         m_AclStatus = previousStatus;
+        m_Changes++;
+        updateLruPosition();
+        pthread_mutex_unlock(&s_BodyLock);
         return GW_ACL_RC_PERSISTENCE_ERROR;
     }
 
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (!policyManager) {
+        QCC_DbgHLPrintf(("PolicyManager not defined"));
+        return GW_ACL_RC_POLICYMANAGER_ERROR;
+    }
+
+    //the policies and the start or stop of the app are committed with a single reload
+    policyManager->beginTransaction();
     status = m_ConnectorApp->updatePolicyManager();
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not update policies successfully"));
+        policyManager->rollbackTransaction();
         return GW_ACL_RC_POLICYMANAGER_ERROR;
     }
 
@@ -169,9 +253,9 @@ AclResponseCode GatewayAcl::updateAclStatus(AclStatus aclStatus)
         }
     }
 
-    status = m_ConnectorApp->updatePolicyManager();
+    status = policyManager->commitTransaction();
     if (status != ER_OK) {
-        QCC_DbgPrintf(("Could not update Policies for app %s", m_ConnectorApp->getConnectorId().c_str()));
+        QCC_LogError(status, ("Could not commit the Policies of app %s", m_ConnectorApp->getConnectorId().c_str()));
         return GW_ACL_RC_POLICYMANAGER_ERROR;
     }
 
@@ -192,27 +276,53 @@ AclResponseCode GatewayAcl::updateAcl(qcc::String const& aclName, GatewayAclRule
         return GW_ACL_RC_METADATA_ERROR;
     }
 
-    QStatus status = metadataManager->updateMetadata(metadata);
+    //metadata and acl file share one sync barrier
+    GatewayPersistenceBatch batch(GatewayMgmt::getInstance()->getJournal());
+    QStatus status = metadataManager->updateMetadata(metadata, &batch);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not persist metadata"));
         return GW_ACL_RC_METADATA_ERROR;
     }
 
+    //the previous rules are loaded to roll back to them
+    pthread_mutex_lock(&s_BodyLock);
+    status = touchBody();
+    if (status != ER_OK) {
+        pthread_mutex_unlock(&s_BodyLock);
+        QCC_LogError(status, ("Could not load the rules of the acl"));
+        return GW_ACL_RC_PERSISTENCE_ERROR;
+    }
     qcc::String previousName = m_AclName;
     GatewayAclRules previousRules = m_AclRules;
     std::map<qcc::String, qcc::String> previousCustomMetadata = m_CustomMetadata;
 
     m_AclName = aclName;
     m_AclRules = aclRules;
+    m_Revision = nextRevision();
     m_CustomMetadata = customMetadata;
+    m_Changes++;
+    if (!m_BodyLoaded) {
+        m_BodyLoaded = true;
+        updateLruPosition();
+    }
+    pthread_mutex_unlock(&s_BodyLock);
 
-    status = writeToFile();
+    status = writeToFile(&batch);
+    if (status == ER_OK) {
+        status = batch.commit();
+    }
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not persist acl - rolling back changes"));
+        pthread_mutex_lock(&s_BodyLock);
         m_AclName = previousName;
         m_AclRules = previousRules;
+        m_Revision = nextRevision();
+        m_CustomMetadata = previousCustomMetadata;
+        m_Changes++;
+        pthread_mutex_unlock(&s_BodyLock);
         return GW_ACL_RC_PERSISTENCE_ERROR;
     }
+    setBodyPersisted();
 
     status = m_ConnectorApp->updatePolicyManager();
     if (status != ER_OK) {
@@ -246,13 +356,27 @@ AclResponseCode GatewayAcl::updateMetadata(std::map<qcc::String, qcc::String> co
 
 AclResponseCode GatewayAcl::updateCustomMetadata(std::map<qcc::String, qcc::String> const& customMetadata)
 {
+    //the file is rewritten with the rules
+    pthread_mutex_lock(&s_BodyLock);
+    QStatus status = touchBody();
     std::map<qcc::String, qcc::String> previousCustomMetadata = m_CustomMetadata;
-    m_CustomMetadata = customMetadata;
+    if (status == ER_OK) {
+        m_CustomMetadata = customMetadata;
+        m_Changes++;
+    }
+    pthread_mutex_unlock(&s_BodyLock);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not load the rules of the acl"));
+        return GW_ACL_RC_PERSISTENCE_ERROR;
+    }
 
-    QStatus status = writeToFile();
+    status = writeToFile();
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not persist acl - rolling back changes"));
+        pthread_mutex_lock(&s_BodyLock);
         m_CustomMetadata = previousCustomMetadata;
+        m_Changes++;
+        pthread_mutex_unlock(&s_BodyLock);
         return GW_ACL_RC_PERSISTENCE_ERROR;
     }
 
@@ -275,6 +399,84 @@ QStatus GatewayAcl::loadFromFile(qcc::String const& fileName)
         return ER_READ_ERROR;
     }
 
+    //the Acls are loaded in parallel at startup, so the lock is only taken to publish the rules
+    qcc::String aclName = m_AclName;
+    AclStatus aclStatus = m_AclStatus;
+    GatewayRuleObjectDescriptions exposedServices;
+    GatewayRemoteAppRules remoteAppRules;
+    std::map<qcc::String, qcc::String> customMetadata;
+    QStatus status = parseContent(content, &aclName, &aclStatus, &exposedServices, &remoteAppRules, &customMetadata);
+    if (status != ER_OK) {
+        return status;
+    }
+
+    pthread_mutex_lock(&s_BodyLock);
+    m_AclName = aclName;
+    m_AclStatus = aclStatus;
+    m_AclRules.setExposedServicesRules(exposedServices);
+    m_AclRules.setRemoteAppRules(remoteAppRules);
+    m_CustomMetadata.swap(customMetadata);
+    m_BodyLoaded = true;
+    updateLruPosition();
+    countReferencesLocked();
+    pthread_mutex_unlock(&s_BodyLock);
+    return ER_OK;
+}
+
+QStatus GatewayAcl::loadHeaderFromFile(qcc::String const& fileName)
+{
+    xmlTextReaderPtr reader = xmlReaderForFile(fileName.c_str(), NULL, XML_PARSE_NOERROR | XML_PARSE_NOBLANKS);
+    if (reader == NULL) {
+        QCC_DbgHLPrintf(("Could not read acl"));
+        return ER_READ_ERROR;
+    }
+
+    //name and status come first. The rules after them are skipped without being parsed
+    QStatus status = ER_OK;
+    bool hasName = false;
+    bool hasStatus = false;
+    int rc = xmlTextReaderRead(reader);
+    while (rc == 1 && (!hasName || !hasStatus)) {
+
+        if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT || xmlTextReaderDepth(reader) == 0) {
+            rc = xmlTextReaderRead(reader);
+            continue;
+        }
+
+        const xmlChar* keyName = xmlTextReaderConstLocalName(reader);
+
+        if (xmlStrEqual(keyName, (const xmlChar*)"name")) {
+            xmlChar* value = xmlTextReaderReadString(reader);
+            m_AclName.assign(value ? (const char*)value : "");
+            xmlFree(value);
+            hasName = true;
+        } else if (xmlStrEqual(keyName, (const xmlChar*)"status")) {
+            xmlChar* value = xmlTextReaderReadString(reader);
+            int aclStatus = value ? atoi((const char*)value) : -1;
+            xmlFree(value);
+            if (aclStatus < 0 || aclStatus > GW_AS_MAX_ACL_STATUS) {
+                QCC_DbgHLPrintf(("AclStatus is not a valid value"));
+                status = ER_INVALID_DATA;
+                break;
+            }
+            m_AclStatus = (AclStatus)aclStatus;
+            hasStatus = true;
+        }
+        rc = xmlTextReaderNext(reader);
+    }
+
+    if (status == ER_OK && rc < 0) {
+        QCC_DbgHLPrintf(("Could not parse XML from file"));
+        status = ER_XML_MALFORMED;
+    }
+    xmlFreeTextReader(reader);
+    return status;
+}
+
+QStatus GatewayAcl::parseContent(std::string const& content, qcc::String* aclName, AclStatus* aclStatus,
+                                 GatewayRuleObjectDescriptions* exposedServices, GatewayRemoteAppRules* remoteAppRules,
+                                 std::map<qcc::String, qcc::String>* customMetadata)
+{
     xmlParserCtxtPtr ctxt = xmlNewParserCtxt();
     if (ctxt == NULL) {
         QCC_DbgHLPrintf(("Could not create Parser Context"));
@@ -306,8 +508,13 @@ QStatus GatewayAcl::loadFromFile(qcc::String const& fileName)
         const xmlChar* value = currentKey->children->content;
 
         if (xmlStrEqual(keyName, (const xmlChar*)"name")) {
-            m_AclName.assign((const char*)value);
+            if (aclName) {
+                aclName->assign((const char*)value);
+            }
         } else if (xmlStrEqual(keyName, (const xmlChar*)"status")) {
+            if (!aclStatus) {
+                continue;
+            }
             int status = atoi((const char*)value);
             if (status < 0 || status > GW_AS_MAX_ACL_STATUS) {
                 QCC_DbgHLPrintf(("AclStatus is not a valid value"));
@@ -315,17 +522,15 @@ QStatus GatewayAcl::loadFromFile(qcc::String const& fileName)
                 xmlFreeDoc(doc);
                 return ER_INVALID_DATA;
             }
-            m_AclStatus = (AclStatus)status;
+            *aclStatus = (AclStatus)status;
         } else if (xmlStrEqual(keyName, (const xmlChar*)"exposedServices")) {
-            GatewayRuleObjectDescriptions exposedServices;
-            parseObjects(currentKey, exposedServices);
-            m_AclRules.setExposedServicesRules(exposedServices);
+            exposedServices->clear();
+            parseObjects(currentKey, *exposedServices);
         } else if (xmlStrEqual(keyName, (const xmlChar*)"remotedApps")) {
-            GatewayRemoteAppRules remoteAppRules;
-            parseRemotedApp(currentKey, remoteAppRules);
-            m_AclRules.setRemoteAppRules(remoteAppRules);
+            remoteAppRules->clear();
+            parseRemotedApp(currentKey, *remoteAppRules);
         } else if (xmlStrEqual(keyName, (const xmlChar*)"customMetadata")) {
-            parseMetadata(currentKey, m_CustomMetadata);
+            parseMetadata(currentKey, *customMetadata);
         }
     }
 
@@ -334,6 +539,243 @@ QStatus GatewayAcl::loadFromFile(qcc::String const& fileName)
     return ER_OK;
 }
 
+QStatus GatewayAcl::touchBody()
+{
+    if (m_BodyLoaded) {
+        updateLruPosition();
+        return ER_OK;
+    }
+
+    //a change not folded into the file yet is only in the journal
+    std::string content;
+    GatewayJournalEntry entry;
+    GatewayJournal* journal = GatewayMgmt::getInstance()->getJournal();
+    if (journal && journal->getLatest(getFileName(), entry)) {
+        content.assign(entry.data.c_str(), entry.data.size());
+    } else {
+        std::ifstream ifs(getFileName().c_str());
+        content.assign((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+    }
+
+    if (content.empty()) {
+        QCC_DbgHLPrintf(("Could not read the rules of acl %s", m_AclId.c_str()));
+        return ER_READ_ERROR;
+    }
+
+    GatewayRuleObjectDescriptions exposedServices;
+    GatewayRemoteAppRules remoteAppRules;
+    std::map<qcc::String, qcc::String> customMetadata;
+    QStatus status = parseContent(content, NULL, NULL, &exposedServices, &remoteAppRules, &customMetadata);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not parse the rules of acl %s", m_AclId.c_str()));
+        return status;
+    }
+
+    m_AclRules.setExposedServicesRules(exposedServices);
+    m_AclRules.setRemoteAppRules(remoteAppRules);
+    m_CustomMetadata.swap(customMetadata);
+    m_BodyLoaded = true;
+    updateLruPosition();
+    countReferencesLocked();
+    GatewayStats::getInstance()->increment(GW_STAT_ACL_BODY_LOADS);
+    evictBodies();
+    return ER_OK;
+}
+
+void GatewayAcl::unloadBody()
+{
+    m_AclRules = GatewayAclRules();
+    std::map<qcc::String, qcc::String>().swap(m_CustomMetadata);
+    m_BodyLoaded = false;
+    updateLruPosition();
+}
+
+void GatewayAcl::updateLruPosition()
+{
+    bool evictable = m_BodyLoaded && m_AclStatus != GW_AS_ACTIVE;
+    if (m_LruPosition == s_InactiveBodiesLru.end()) {
+        if (evictable) {
+            m_LruPosition = s_InactiveBodiesLru.insert(s_InactiveBodiesLru.begin(), this);
+        }
+    } else if (evictable) {
+        //splicing keeps the position valid
+        s_InactiveBodiesLru.splice(s_InactiveBodiesLru.begin(), s_InactiveBodiesLru, m_LruPosition);
+    } else {
+        s_InactiveBodiesLru.erase(m_LruPosition);
+        m_LruPosition = s_InactiveBodiesLru.end();
+    }
+}
+
+void GatewayAcl::evictBodies()
+{
+    uint32_t maxInactiveBodies = GatewayMgmt::getInstance()->getMaxInactiveAclBodies();
+    if (maxInactiveBodies == 0) {
+        return;
+    }
+
+    //only unchanged rules can be evicted, they are parsed again from the file. Changed
+    //rules stay loaded, and are not counted against the limit until they are persisted
+    size_t changedBodies = 0;
+    std::list<GatewayAcl*>::iterator iter = s_InactiveBodiesLru.end();
+    while (s_InactiveBodiesLru.size() > maxInactiveBodies + changedBodies && iter != s_InactiveBodiesLru.begin()) {
+        GatewayAcl* acl = *--iter;
+        if (acl->m_PersistedChanges != acl->m_Changes) {
+            changedBodies++;
+            continue;
+        }
+        iter++;
+        QCC_DbgPrintf(("Evicting the rules of acl %s", acl->m_AclId.c_str()));
+        acl->unloadBody();
+        GatewayStats::getInstance()->increment(GW_STAT_ACL_BODY_EVICTIONS);
+    }
+}
+
+void GatewayAcl::countReferences()
+{
+    pthread_mutex_lock(&s_BodyLock);
+    countReferencesLocked();
+    pthread_mutex_unlock(&s_BodyLock);
+}
+
+void GatewayAcl::countReferencesLocked()
+{
+    GatewayMetadataManager* metadataManager = GatewayMgmt::getInstance()->getMetadataManager();
+    if (!m_BodyLoaded || m_ReferencesCounted || !metadataManager) {
+        return;
+    }
+
+    const GatewayRemoteAppRules& remoteAppRules = m_AclRules.getRemoteAppRules();
+    GatewayRemoteAppRules::const_iterator iter;
+    for (iter = remoteAppRules.begin(); iter != remoteAppRules.end(); iter++) {
+        metadataManager->incRemoteAppRefCount(iter->first);
+    }
+    m_ReferencesCounted = true;
+    s_UncountedAcls--;
+}
+
+void GatewayAcl::setBodyPersisted()
+{
+    pthread_mutex_lock(&s_BodyLock);
+    if (m_StagedChanges > m_PersistedChanges) {
+        m_PersistedChanges = m_StagedChanges;
+    }
+    pthread_mutex_unlock(&s_BodyLock);
+}
+
+bool GatewayAcl::referencesCounted()
+{
+    pthread_mutex_lock(&s_BodyLock);
+    bool referencesCounted = s_UncountedAcls == 0;
+    pthread_mutex_unlock(&s_BodyLock);
+    return referencesCounted;
+}
+
+qcc::String GatewayAcl::getFileName() const
+{
+    return GATEWAY_APPS_DIRECTORY + "/" + m_ConnectorApp->getAppName() + "/acls/" + m_AclId;
+}
+
+void GatewayAcl::writeSnapshot(GatewaySnapshot& snapshot) const
+{
+    pthread_mutex_lock(&s_BodyLock);
+    snapshot.putString(m_AclName);
+    snapshot.putUInt32(m_AclStatus);
+    //rules that are not loaded stay unloaded after the snapshot is read
+    snapshot.putUInt8(m_BodyLoaded);
+    if (!m_BodyLoaded) {
+        pthread_mutex_unlock(&s_BodyLock);
+        return;
+    }
+
+    const GatewayRemoteAppRules& remoteAppRules = m_AclRules.getRemoteAppRules();
+    writeObjectsToSnapshot(snapshot, m_AclRules.getExposedServicesRules());
+    snapshot.putUInt32(remoteAppRules.size());
+    for (GatewayRemoteAppRules::const_iterator it = remoteAppRules.begin(); it != remoteAppRules.end(); it++) {
+        snapshot.putString(it->first.getAppId());
+        snapshot.putString(it->first.getDeviceId());
+        writeObjectsToSnapshot(snapshot, it->second);
+    }
+    snapshot.putStringMap(m_CustomMetadata);
+    pthread_mutex_unlock(&s_BodyLock);
+}
+
+bool GatewayAcl::readSnapshot(GatewaySnapshot& snapshot)
+{
+    uint32_t aclStatus;
+    uint8_t bodyLoaded;
+    uint32_t numRemoteApps;
+    GatewayRuleObjectDescriptions exposedServices;
+    GatewayRemoteAppRules remoteAppRules;
+    std::map<qcc::String, qcc::String> customMetadata;
+
+    if (!snapshot.getString(m_AclName) || !snapshot.getUInt32(aclStatus) || aclStatus > GW_AS_MAX_ACL_STATUS ||
+        !snapshot.getUInt8(bodyLoaded)) {
+        return false;
+    }
+
+    if (!bodyLoaded) {
+        m_AclStatus = (AclStatus)aclStatus;
+        return true;
+    }
+
+    if (!readObjectsFromSnapshot(snapshot, exposedServices) || !snapshot.getUInt32(numRemoteApps)) {
+        return false;
+    }
+
+    for (uint32_t indx = 0; indx < numRemoteApps; indx++) {
+        qcc::String appId, deviceId;
+        GatewayRuleObjectDescriptions objects;
+        if (!snapshot.getString(appId) || !snapshot.getString(deviceId) || !readObjectsFromSnapshot(snapshot, objects)) {
+            return false;
+        }
+        remoteAppRules.insert(std::pair<GatewayAppIdentifier, GatewayRuleObjectDescriptions>(GatewayAppIdentifier(appId, deviceId), objects));
+    }
+
+    if (!snapshot.getStringMap(customMetadata)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_BodyLock);
+    m_AclStatus = (AclStatus)aclStatus;
+    m_AclRules.setExposedServicesRules(exposedServices);
+    m_AclRules.setRemoteAppRules(remoteAppRules);
+    m_Revision = nextRevision();
+    m_CustomMetadata = customMetadata;
+    m_BodyLoaded = true;
+    updateLruPosition();
+    pthread_mutex_unlock(&s_BodyLock);
+    return true;
+}
+
+void GatewayAcl::writeObjectsToSnapshot(GatewaySnapshot& snapshot, const GatewayRuleObjectDescriptions& objects)
+{
+    snapshot.putUInt32(objects.size());
+    for (size_t indx = 0; indx < objects.size(); indx++) {
+        snapshot.putString(objects[indx].getObjectPath());
+        snapshot.putUInt8(objects[indx].getIsPrefix());
+        snapshot.putStrings(objects[indx].getInterfaces());
+    }
+}
+
+bool GatewayAcl::readObjectsFromSnapshot(GatewaySnapshot& snapshot, GatewayRuleObjectDescriptions& objects)
+{
+    uint32_t numObjects;
+    if (!snapshot.getUInt32(numObjects)) {
+        return false;
+    }
+
+    for (uint32_t indx = 0; indx < numObjects; indx++) {
+        qcc::String objectPath;
+        uint8_t isPrefix;
+        std::vector<qcc::String> interfaces;
+        if (!snapshot.getString(objectPath) || !snapshot.getUInt8(isPrefix) || !snapshot.getStrings(interfaces)) {
+            return false;
+        }
+        objects.push_back(GatewayRuleObjectDescription(objectPath, isPrefix != 0, interfaces));
+    }
+    return true;
+}
+
 void GatewayAcl::parseMetadata(xmlNode* currentKey, std::map<qcc::String, qcc::String>& metadata)
 {
     for  (xmlNode* metadataNode = currentKey->children; metadataNode != NULL; metadataNode = metadataNode->next) {
@@ -420,8 +862,6 @@ void GatewayAcl::parseObjects(xmlNode* currentKey, GatewayRuleObjectDescriptions
 
 void GatewayAcl::parseRemotedApp(xmlNode* currentKey, GatewayRemoteAppRules& remoteAppRules)
 {
-    GatewayMetadataManager* metadataManager = GatewayMgmt::getInstance()->getMetadataManager();
-
     for  (xmlNode* deviceKey = currentKey->children; deviceKey != NULL; deviceKey = deviceKey->next) {
 
         if (deviceKey->type != XML_ELEMENT_NODE || deviceKey->children == NULL) {
@@ -460,60 +900,53 @@ void GatewayAcl::parseRemotedApp(xmlNode* currentKey, GatewayRemoteAppRules& rem
         if ((it = remoteAppRules.find(appKey)) != remoteAppRules.end()) {
             it->second.insert(it->second.end(), objects.begin(), objects.end());
         } else {
-            if (metadataManager) {
-                metadataManager->incRemoteAppRefCount(appKey);
-            }
             remoteAppRules.insert(std::pair<GatewayAppIdentifier, GatewayRuleObjectDescriptions>(appKey, objects));
         }
     }
 }
 
-QStatus GatewayAcl::writeToFile()
+QStatus GatewayAcl::writeToFile(GatewayPersistenceBatch* batch)
 {
     QStatus status = ER_FAIL;
     std::map<qcc::String, qcc::String>::iterator iter;
-
     std::stringstream statusStr;
-    statusStr << m_AclStatus;
-
-    xmlDocPtr doc = xmlNewDoc((xmlChar*)XML_DEFAULT_VERSION);
-    if (doc == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml document tree"));
-        return status;
-    }
-
-    xmlTextWriterPtr writer = xmlNewTextWriterDoc(&doc, 0);
-    if (writer == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml writer\n"));
-        xmlFreeDoc(doc);
-        return status;
+    GatewayXmlWriter writer;
+    uint64_t changes;
+    int rc;
+
+    pthread_mutex_lock(&s_BodyLock);
+    QStatus bodyStatus = touchBody();
+    if (bodyStatus != ER_OK) {
+        status = bodyStatus;
+        goto exit;
     }
+    statusStr << m_AclStatus;
 
-    int rc = xmlTextWriterStartDocument(writer, "1.0", NULL, NULL);
+    rc = writer.startDocument();
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteComment(writer, (xmlChar*)GATEWAY_XML_COMMENT.c_str());
+    rc = writer.writeComment(GATEWAY_XML_COMMENT.c_str());
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"Acl");
+    rc = writer.startElement("Acl");
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"xmlns", (xmlChar*)GATEWAY_XML_SCHEMA.c_str());
+    rc = writer.writeAttribute("xmlns", GATEWAY_XML_SCHEMA.c_str());
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteElement(writer, (xmlChar*)"name", (xmlChar*)m_AclName.c_str());
+    rc = writer.writeElement("name", m_AclName.c_str());
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteElement(writer, (xmlChar*)"status", (xmlChar*)statusStr.str().c_str());
+    rc = writer.writeElement("status", statusStr.str().c_str());
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"exposedServices");
+    rc = writer.startElement("exposedServices");
     if (rc < 0) {
         goto exit;
     }
@@ -521,11 +954,11 @@ QStatus GatewayAcl::writeToFile()
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterEndElement(writer); //close exposedServices tag
+    rc = writer.endElement(); //close exposedServices tag
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"remotedApps");
+    rc = writer.startElement("remotedApps");
     if (rc < 0) {
         goto exit;
     }
@@ -533,90 +966,103 @@ QStatus GatewayAcl::writeToFile()
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterEndElement(writer); //close remotedApps tag
+    rc = writer.endElement(); //close remotedApps tag
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"customMetadata");
+    rc = writer.startElement("customMetadata");
     if (rc < 0) {
         goto exit;
     }
     for (iter = m_CustomMetadata.begin(); iter != m_CustomMetadata.end(); iter++) {
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"data");
+        rc = writer.startElement("data");
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"key", (xmlChar*)iter->first.c_str());
+        rc = writer.writeElement("key", iter->first.c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"value", (xmlChar*)iter->second.c_str());
+        rc = writer.writeElement("value", iter->second.c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterEndElement(writer); //close data tag
+        rc = writer.endElement(); //close data tag
         if (rc < 0) {
             goto exit;
         }
     }
-    rc = xmlTextWriterEndElement(writer); //close customMetadata tag
+    rc = writer.endElement(); //close customMetadata tag
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterEndDocument(writer); //closes all open tags (remotedServices and Acl)
+    rc = writer.endDocument(); //closes all open tags (remotedServices and Acl)
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlSaveFormatFile((GATEWAY_APPS_DIRECTORY + "/" + m_ConnectorApp->getAppName() + "/acls/" + m_AclId).c_str(), doc, 1);
-    if (rc < 0) {
-        status = ER_WRITE_ERROR;
-        goto exit;
+    changes = m_Changes;
+    pthread_mutex_unlock(&s_BodyLock);
+
+    if (batch) {
+        status = batch->stage(getFileName(), writer.getData(), writer.getSize());
+    } else {
+        GatewayPersistenceBatch fileBatch(GatewayMgmt::getInstance()->getJournal());
+        status = fileBatch.stage(getFileName(), writer.getData(), writer.getSize());
+        if (status == ER_OK) {
+            status = fileBatch.commit();
+        }
+    }
+
+    //rules staged in a batch are persisted once the caller commits it
+    pthread_mutex_lock(&s_BodyLock);
+    if (status == ER_OK) {
+        m_StagedChanges = changes;
+        if (!batch && changes > m_PersistedChanges) {
+            m_PersistedChanges = changes;
+        }
     }
-    status = ER_OK;
 
 exit:
 
-    xmlFreeTextWriter(writer);
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
+    pthread_mutex_unlock(&s_BodyLock);
     return status;
 }
 
-int GatewayAcl::writeObjectsToFile(xmlTextWriterPtr writer, const GatewayRuleObjectDescriptions& objects)
+int GatewayAcl::writeObjectsToFile(GatewayXmlWriter& writer, const GatewayRuleObjectDescriptions& objects)
 {
     int rc = 0;
     for (size_t objectsIndx = 0; objectsIndx < objects.size(); objectsIndx++) {
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"object");
+        rc = writer.startElement("object");
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"path", (xmlChar*)objects[objectsIndx].getObjectPath().c_str());
+        rc = writer.writeElement("path", objects[objectsIndx].getObjectPath().c_str());
         if (rc < 0) {
             return rc;
         }
         qcc::String isPrefix = objects[objectsIndx].getIsPrefix() ? "true" : "false";
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"isPrefix", (xmlChar*)isPrefix.c_str());
+        rc = writer.writeElement("isPrefix", isPrefix.c_str());
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"interfaces");
+        rc = writer.startElement("interfaces");
         if (rc < 0) {
             return rc;
         }
 
         const std::vector<qcc::String>& interfaces = objects[objectsIndx].getInterfaces();
         for (size_t interfacesIndx = 0; interfacesIndx < interfaces.size(); interfacesIndx++) {
-            rc = xmlTextWriterWriteElement(writer, (xmlChar*)"interface", (xmlChar*)interfaces[interfacesIndx].c_str());
+            rc = writer.writeElement("interface", interfaces[interfacesIndx].c_str());
             if (rc < 0) {
                 return rc;
             }
         }
 
-        rc = xmlTextWriterEndElement(writer);
+        rc = writer.endElement();
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterEndElement(writer);
+        rc = writer.endElement();
         if (rc < 0) {
             return rc;
         }
@@ -624,25 +1070,25 @@ int GatewayAcl::writeObjectsToFile(xmlTextWriterPtr writer, const GatewayRuleObj
     return rc;
 }
 
-int GatewayAcl::writeRemotedAppsToFile(xmlTextWriterPtr writer, const GatewayRemoteAppRules& remoteAppRules)
+int GatewayAcl::writeRemotedAppsToFile(GatewayXmlWriter& writer, const GatewayRemoteAppRules& remoteAppRules)
 {
     int rc = 0;
     GatewayRemoteAppRules::const_iterator iter;
     for (iter = remoteAppRules.begin(); iter != remoteAppRules.end(); iter++) {
 
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"device");
+        rc = writer.startElement("device");
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"deviceId", (xmlChar*)iter->first.getDeviceId().c_str());
+        rc = writer.writeElement("deviceId", iter->first.getDeviceId().c_str());
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"appId", (xmlChar*)iter->first.getAppId().c_str());
+        rc = writer.writeElement("appId", iter->first.getAppId().c_str());
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"objects");
+        rc = writer.startElement("objects");
         if (rc < 0) {
             return rc;
         }
@@ -650,11 +1096,11 @@ int GatewayAcl::writeRemotedAppsToFile(xmlTextWriterPtr writer, const GatewayRem
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterEndElement(writer); //close objects tag
+        rc = writer.endElement(); //close objects tag
         if (rc < 0) {
             return rc;
         }
-        rc = xmlTextWriterEndElement(writer); //close device tag
+        rc = writer.endElement(); //close device tag
         if (rc < 0) {
             return rc;
         }
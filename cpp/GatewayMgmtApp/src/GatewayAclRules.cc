@@ -15,12 +15,27 @@
  ******************************************************************************/
 
 #include <alljoyn/gateway/GatewayAclRules.h>
+#include <set>
 
 namespace ajn {
 namespace gw {
 using namespace qcc;
 
-GatewayAclRules::GatewayAclRules()
+namespace {
+
+/**
+ * Interfaces allowed on an object path. No interfaces means all interfaces
+ */
+struct NormalizedInterfaces {
+    bool allInterfaces;
+    std::set<String> interfaces;
+};
+
+typedef std::map<std::pair<String, bool>, NormalizedInterfaces> NormalizedObjects;
+
+} /* namespace */
+
+GatewayAclRules::GatewayAclRules() : m_Revision(0)
 {
 
 }
@@ -29,6 +44,26 @@ GatewayAclRules::~GatewayAclRules() {
 
 }
 
+const String& GatewayAclRules::getAclId() const
+{
+    return m_AclId;
+}
+
+void GatewayAclRules::setAclId(const String& aclId)
+{
+    m_AclId = aclId;
+}
+
+uint64_t GatewayAclRules::getRevision() const
+{
+    return m_Revision;
+}
+
+void GatewayAclRules::setRevision(uint64_t revision)
+{
+    m_Revision = revision;
+}
+
 const GatewayRuleObjectDescriptions& GatewayAclRules::getExposedServicesRules() const
 {
     return m_ExposedServicesRules;
@@ -49,5 +84,103 @@ void GatewayAclRules::setRemoteAppRules(const GatewayRemoteAppRules& remoteAppRu
     m_RemoteAppRules = remoteAppRules;
 }
 
+void GatewayAclRules::addRules(const GatewayAclRules& aclRules)
+{
+    const GatewayRuleObjectDescriptions& exposedServices = aclRules.getExposedServicesRules();
+    m_ExposedServicesRules.insert(m_ExposedServicesRules.end(), exposedServices.begin(), exposedServices.end());
+
+    const GatewayRemoteAppRules& remoteAppRules = aclRules.getRemoteAppRules();
+    GatewayRemoteAppRules::const_iterator iter;
+    for (iter = remoteAppRules.begin(); iter != remoteAppRules.end(); iter++) {
+        GatewayRemoteAppRules::iterator it;
+        if ((it = m_RemoteAppRules.find(iter->first)) != m_RemoteAppRules.end()) {
+            it->second.insert(it->second.end(), iter->second.begin(), iter->second.end());
+        } else {
+            m_RemoteAppRules.insert(std::pair<GatewayAppIdentifier, GatewayRuleObjectDescriptions>(iter->first, iter->second));
+        }
+    }
+}
+
+void GatewayAclRules::normalize()
+{
+    normalizeObjectDescriptions(m_ExposedServicesRules);
+
+    GatewayRemoteAppRules::iterator iter;
+    for (iter = m_RemoteAppRules.begin(); iter != m_RemoteAppRules.end(); iter++) {
+        normalizeObjectDescriptions(iter->second);
+    }
+}
+
+void GatewayAclRules::normalizeObjectDescriptions(GatewayRuleObjectDescriptions& objects)
+{
+    //merge the rules of the same object path
+    NormalizedObjects merged;
+    for (size_t objectsIndx = 0; objectsIndx < objects.size(); objectsIndx++) {
+        const std::vector<String>& interfaces = objects[objectsIndx].getInterfaces();
+        std::pair<String, bool> key(objects[objectsIndx].getObjectPath(), objects[objectsIndx].getIsPrefix());
+
+        NormalizedObjects::iterator iter = merged.find(key);
+        if (iter == merged.end()) {
+            NormalizedInterfaces normalized;
+            normalized.allInterfaces = interfaces.empty();
+            iter = merged.insert(std::pair<std::pair<String, bool>, NormalizedInterfaces>(key, normalized)).first;
+        } else if (iter->second.allInterfaces) {
+            continue;
+        } else if (interfaces.empty()) {
+            iter->second.allInterfaces = true;
+            iter->second.interfaces.clear();
+            continue;
+        }
+        iter->second.interfaces.insert(interfaces.begin(), interfaces.end());
+    }
+
+    //"*" is written to the policies differently, so it neither covers nor is covered by other rules
+    std::vector<NormalizedObjects::const_iterator> prefixRules;
+    NormalizedObjects::const_iterator iter;
+    for (iter = merged.begin(); iter != merged.end(); iter++) {
+        if (iter->first.second && iter->first.first.compare("*") != 0) {
+            prefixRules.push_back(iter);
+        }
+    }
+
+    GatewayRuleObjectDescriptions normalized;
+    for (iter = merged.begin(); iter != merged.end(); iter++) {
+        String const& objectPath = iter->first.first;
+        std::set<String> interfaces = iter->second.interfaces;
+        bool covered = false;
+
+        for (size_t prefixIndx = 0; prefixIndx < prefixRules.size() && objectPath.compare("*") != 0; prefixIndx++) {
+            NormalizedObjects::const_iterator prefixRule = prefixRules[prefixIndx];
+            String const& prefix = prefixRule->first.first;
+            if (prefixRule == iter || objectPath.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            if (prefixRule->second.allInterfaces) {
+                covered = true;
+                break;
+            }
+            if (iter->second.allInterfaces) {
+                continue;
+            }
+            std::set<String>::const_iterator interfaceIt;
+            for (interfaceIt = prefixRule->second.interfaces.begin(); interfaceIt != prefixRule->second.interfaces.end(); interfaceIt++) {
+                interfaces.erase(*interfaceIt);
+            }
+            if (interfaces.empty()) {
+                covered = true;
+                break;
+            }
+        }
+
+        if (covered) {
+            continue;
+        }
+        std::vector<String> interfaceList(interfaces.begin(), interfaces.end());
+        normalized.push_back(GatewayRuleObjectDescription(objectPath, iter->first.second, interfaceList));
+    }
+
+    objects.swap(normalized);
+}
+
 } /* namespace gw */
 } /* namespace ajn */
@@ -16,15 +16,20 @@
 
 #include <alljoyn/gateway/GatewayAppIdentifier.h>
 #include <qcc/StringUtil.h>
+#include <string.h>
 
 namespace ajn {
 namespace gw {
 
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
 GatewayAppIdentifier::GatewayAppIdentifier(qcc::String const& appId, qcc::String const& deviceId) :
-    m_AppId(appId), m_DeviceId(deviceId)
+    m_DeviceId(deviceId)
 {
     memset(m_AppIdHex, 0, APPID_LENGTH);
     qcc::HexStringToBytes(appId, m_AppIdHex, APPID_LENGTH);
+    computeHash();
 }
 
 GatewayAppIdentifier::GatewayAppIdentifier(uint8_t* appId, size_t appIdLen, qcc::String const& deviceId) :
@@ -32,7 +37,19 @@ GatewayAppIdentifier::GatewayAppIdentifier(uint8_t* appId, size_t appIdLen, qcc:
 {
     memset(m_AppIdHex, 0, APPID_LENGTH);
     memcpy(m_AppIdHex, appId, appIdLen > APPID_LENGTH ? APPID_LENGTH : appIdLen);
-    m_AppId = qcc::BytesToHexString(appId, APPID_LENGTH);
+    computeHash();
+}
+
+void GatewayAppIdentifier::computeHash()
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t indx = 0; indx < APPID_LENGTH; indx++) {
+        hash = (hash ^ m_AppIdHex[indx]) * FNV_PRIME;
+    }
+    for (const char* current = m_DeviceId.c_str(); *current; current++) {
+        hash = (hash ^ (uint8_t)*current) * FNV_PRIME;
+    }
+    m_Hash = hash;
 }
 
 GatewayAppIdentifier::~GatewayAppIdentifier()
@@ -41,25 +58,34 @@ GatewayAppIdentifier::~GatewayAppIdentifier()
 
 bool GatewayAppIdentifier::operator<(const GatewayAppIdentifier& other) const
 {
-    if (m_AppId.compare(other.m_AppId) == 0) {
-        return (m_DeviceId.compare(other.m_DeviceId) < 0);
+    if (m_Hash != other.m_Hash) {
+        return m_Hash < other.m_Hash;
     }
 
-    return (m_AppId.compare(other.m_AppId) < 0);
+    int rc = memcmp(m_AppIdHex, other.m_AppIdHex, APPID_LENGTH);
+    if (rc != 0) {
+        return rc < 0;
+    }
+    return (m_DeviceId.compare(other.m_DeviceId) < 0);
 }
 
 bool GatewayAppIdentifier::operator==(const GatewayAppIdentifier& other) const
 {
-    if (m_AppId.compare(other.m_AppId) != 0) {
+    if (m_Hash != other.m_Hash || memcmp(m_AppIdHex, other.m_AppIdHex, APPID_LENGTH) != 0) {
         return false;
     }
 
     return (m_DeviceId.compare(other.m_DeviceId) == 0);
 }
 
-const qcc::String& GatewayAppIdentifier::getAppId() const
+qcc::String GatewayAppIdentifier::getAppId() const
+{
+    return qcc::BytesToHexString(m_AppIdHex, APPID_LENGTH);
+}
+
+uint64_t GatewayAppIdentifier::getHash() const
 {
-    return m_AppId;
+    return m_Hash;
 }
 
 const uint8_t* GatewayAppIdentifier::getAppIdHex() const
@@ -77,5 +103,54 @@ size_t GatewayAppIdentifier::getAppIdHexLength() const
     return APPID_LENGTH;
 }
 
+bool GatewayAppIdentifier::matches(const uint8_t* appId, size_t appIdLen, const char* deviceId) const
+{
+    //the constructor keeps at most APPID_LENGTH bytes, padded with zeros
+    size_t length = appIdLen > APPID_LENGTH ? APPID_LENGTH : appIdLen;
+    if (memcmp(m_AppIdHex, appId, length) != 0) {
+        return false;
+    }
+    for (size_t indx = length; indx < APPID_LENGTH; indx++) {
+        if (m_AppIdHex[indx]) {
+            return false;
+        }
+    }
+    return strcmp(m_DeviceId.c_str(), deviceId) == 0;
+}
+
+bool GatewayAppIdentifier::extractFromAboutData(const ajn::MsgArg& aboutDataArg, const uint8_t** appId, size_t* appIdLen, const char** deviceId)
+{
+    *appId = NULL;
+    *appIdLen = 0;
+    *deviceId = NULL;
+
+    size_t numFields = 0;
+    ajn::MsgArg* fields = NULL;
+    if (aboutDataArg.Get("a{sv}", &numFields, &fields) != ER_OK) {
+        return false;
+    }
+
+    //Get hands out pointers into the MsgArg - nothing is copied
+    for (size_t indx = 0; indx < numFields && (!*appIdLen || !*deviceId); indx++) {
+        const char* fieldName = NULL;
+        ajn::MsgArg* value = NULL;
+        if (fields[indx].Get("{sv}", &fieldName, &value) != ER_OK) {
+            continue;
+        }
+        if (strcmp(fieldName, "AppId") == 0) {
+            uint8_t* bytes = NULL;
+            if (value->Get("ay", appIdLen, &bytes) == ER_OK) {
+                *appId = bytes;
+            }
+        } else if (strcmp(fieldName, "DeviceId") == 0) {
+            char* name = NULL;
+            if (value->Get("s", &name) == ER_OK) {
+                *deviceId = name;
+            }
+        }
+    }
+    return *appIdLen && *deviceId && **deviceId;
+}
+
 } /* namespace gw */
 } /* namespace ajn */
@@ -39,12 +39,17 @@ using namespace qcc;
 
 GatewayConnectorApp::GatewayConnectorApp(qcc::String const& connectorId, qcc::String const& appName, GatewayConnectorAppManifest const& manifest) : m_ConnectorId(connectorId), m_AppName(appName),
     m_ObjectPath(AJ_GW_OBJECTPATH + "/" + connectorId), m_ConnectionStatus(GW_CS_NOT_INITIALIZED), m_OperationalStatus(GW_OS_STOPPED),
-    m_InstallStatus(GW_IS_INSTALLED), m_InstallDescription(""), m_Manifest(manifest), m_AppBusObject(NULL), m_ProcessId(-1)
+    m_InstallStatus(GW_IS_INSTALLED), m_InstallDescription(""), m_Manifest(manifest), m_AppBusObject(NULL), m_ProcessId(-1),
+    m_AclsLoaded(false)
 {
 }
 
 GatewayConnectorApp::~GatewayConnectorApp()
 {
+    std::map<String, GatewayAcl*>::iterator it;
+    for (it = m_Acls.begin(); it != m_Acls.end(); it++) {
+        delete it->second;
+    }
 }
 
 QStatus GatewayConnectorApp::init(BusAttachment* bus)
@@ -74,12 +79,27 @@ QStatus GatewayConnectorApp::init(BusAttachment* bus)
         return status;
     }
 
-    status = loadAcls();
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (!policyManager) {
+        status = ER_FAIL;
+        QCC_LogError(status, ("PolicyManager not defined"));
+        return status;
+    }
+
+    status = policyManager->addRemotedInterfaces(m_ConnectorId, m_Manifest.getRemotedServices());
     if (status != ER_OK) {
-        QCC_LogError(status, ("Could not load App Acls"));
+        QCC_LogError(status, ("Could not subscribe to the remoted interfaces of app %s", m_ConnectorId.c_str()));
         return status;
     }
 
+    if (!m_AclsLoaded) {
+        status = loadAcls(GATEWAY_APPS_DIRECTORY);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not load App Acls"));
+            return status;
+        }
+    }
+
     std::map<String, GatewayAcl*>::iterator it;
     for (it = m_Acls.begin(); it != m_Acls.end(); it++) {
         status = it->second->init(bus);
@@ -121,7 +141,13 @@ QStatus GatewayConnectorApp::shutdown(BusAttachment* bus)
     }
 
     bus->UnregisterBusObject(*m_AppBusObject);
-    delete m_AppBusObject;
+    //the method calls waiting for a policy commit are replied to before the BusObject is deleted
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (policyManager) {
+        policyManager->deleteWhenCommitted(m_AppBusObject);
+    } else {
+        delete m_AppBusObject;
+    }
     m_AppBusObject = NULL;
 
     std::map<String, GatewayAcl*>::iterator it;
@@ -142,6 +168,14 @@ QStatus GatewayConnectorApp::shutdown(BusAttachment* bus)
         QCC_LogError(status, ("Could not update Policies for app %s", m_ConnectorId.c_str()));
         returnStatus = status;
     }
+
+    if (policyManager) {
+        status = policyManager->removeRemotedInterfaces(m_ConnectorId);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not cancel the remoted interfaces subscriptions of app %s", m_ConnectorId.c_str()));
+            returnStatus = status;
+        }
+    }
     return returnStatus;
 }
 
@@ -209,11 +243,11 @@ void GatewayConnectorApp::setConnectionStatus(ConnectionStatus connectionStatus)
     }
 }
 
-QStatus GatewayConnectorApp::loadAcls()
+QStatus GatewayConnectorApp::loadAcls(qcc::String const& appsDirectory)
 {
     DIR* dir;
     struct dirent* entry;
-    qcc::String dirName = GATEWAY_APPS_DIRECTORY + "/" + m_AppName + "/acls";
+    qcc::String dirName = appsDirectory + "/" + m_AppName + "/acls";
     if ((dir = opendir(dirName.c_str())) == NULL) {
         QCC_DbgHLPrintf(("Could not open gatewayApp Profile directory"));
         return ER_OK;
@@ -231,8 +265,19 @@ QStatus GatewayConnectorApp::loadAcls()
             continue;
         }
 
+        if (GatewayPersistenceBatch::isTempFile(aclId)) {         // left behind by an interrupted write
+            QCC_DbgHLPrintf(("Removing stale temporary file %s", entry->d_name));
+            unlink((dirName + "/" + aclId).c_str());
+            continue;
+        }
+
         GatewayAcl* acl = new GatewayAcl(aclId, this);
-        QStatus status = acl->loadFromFile(dirName + "/" + aclId);
+        QStatus status;
+        if (GatewayMgmt::getInstance()->getLazyAclBodies()) {
+            status = acl->loadHeaderFromFile(dirName + "/" + aclId);
+        } else {
+            status = acl->loadFromFile(dirName + "/" + aclId);
+        }
         if (status != ER_OK) {
             QCC_LogError(status, ("Could not parse the acl file for aclId: %s", aclId.c_str()));
             delete acl;
@@ -242,9 +287,55 @@ QStatus GatewayConnectorApp::loadAcls()
         m_Acls.insert(std::pair<qcc::String, GatewayAcl*>(aclId, acl));
     }
     closedir(dir);
+    m_AclsLoaded = true;
     return ER_OK;
 }
 
+void GatewayConnectorApp::writeSnapshot(GatewaySnapshot& snapshot) const
+{
+    snapshot.putUInt32(m_Acls.size());
+    std::map<String, GatewayAcl*>::const_iterator it;
+    for (it = m_Acls.begin(); it != m_Acls.end(); it++) {
+        snapshot.putString(it->first);
+        it->second->writeSnapshot(snapshot);
+    }
+}
+
+bool GatewayConnectorApp::readSnapshot(GatewaySnapshot& snapshot)
+{
+    uint32_t numAcls = 0;
+    bool success = snapshot.getUInt32(numAcls);
+
+    std::map<String, GatewayAcl*> acls;
+    for (uint32_t indx = 0; success && indx < numAcls; indx++) {
+        qcc::String aclId;
+        success = snapshot.getString(aclId);
+        if (!success) {
+            break;
+        }
+
+        GatewayAcl* acl = new GatewayAcl(aclId, this);
+        success = acl->readSnapshot(snapshot);
+        if (!success) {
+            delete acl;
+            break;
+        }
+        acls.insert(std::pair<qcc::String, GatewayAcl*>(aclId, acl));
+    }
+
+    if (!success) {
+        std::map<String, GatewayAcl*>::iterator it;
+        for (it = acls.begin(); it != acls.end(); it++) {
+            delete it->second;
+        }
+        return false;
+    }
+
+    m_Acls.insert(acls.begin(), acls.end());
+    m_AclsLoaded = true;
+    return true;
+}
+
 void GatewayConnectorApp::sigChildReceived()
 {
     m_ConnectionStatus = GW_CS_NOT_INITIALIZED;
@@ -441,7 +532,9 @@ AclResponseCode GatewayConnectorApp::createAcl(qcc::String* aclId, qcc::String c
         return GW_ACL_RC_METADATA_ERROR;
     }
 
-    QStatus status = metadataManager->updateMetadata(metadata);
+    //metadata and acl file share one sync barrier
+    GatewayPersistenceBatch batch(GatewayMgmt::getInstance()->getJournal());
+    QStatus status = metadataManager->updateMetadata(metadata, &batch);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not persist metadata"));
         return GW_ACL_RC_METADATA_ERROR;
@@ -455,13 +548,17 @@ AclResponseCode GatewayConnectorApp::createAcl(qcc::String* aclId, qcc::String c
         return GW_ACL_RC_REGISTER_ERROR;
     }
 
-    status = acl->writeToFile();
+    status = acl->writeToFile(&batch);
+    if (status == ER_OK) {
+        status = batch.commit();
+    }
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not persist acl"));
         acl->shutdown(bus);
         delete acl;
         return GW_ACL_RC_PERSISTENCE_ERROR;
     }
+    acl->setBodyPersisted();
 
     m_Acls.insert(std::pair<qcc::String, GatewayAcl*>(*aclId, acl));
 
@@ -523,13 +620,17 @@ AclResponseCode GatewayConnectorApp::deleteAcl(qcc::String const& aclId)
     GatewayAcl* acl = it->second;
     AclStatus aclStatus = acl->getAclStatus();
 
-    int rc = remove((GATEWAY_APPS_DIRECTORY + "/" + m_AppName + "/acls/" + aclId).c_str());
-    if (rc != 0) {
+    GatewayPersistenceBatch batch(GatewayMgmt::getInstance()->getJournal());
+    QStatus status = batch.stageRemoval(GATEWAY_APPS_DIRECTORY + "/" + m_AppName + "/acls/" + aclId);
+    if (status == ER_OK) {
+        status = batch.commit();
+    }
+    if (status != ER_OK) {
         QCC_DbgHLPrintf(("Could not remove acl successfully"));
         return GW_ACL_RC_PERSISTENCE_ERROR;
     }
 
-    QStatus status = acl->shutdown(bus);
+    status = acl->shutdown(bus);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not unregister acl"));
         //Not returning an error - we should be able to recover from this
@@ -540,15 +641,18 @@ AclResponseCode GatewayConnectorApp::deleteAcl(qcc::String const& aclId)
 
     if (aclStatus == GW_AS_ACTIVE) {
         //acl was active - update policies and let app know acls changed
-        status = updatePolicyManager();
-        if (status != ER_OK) {
-            QCC_LogError(status, ("Could not update policies successfully"));
+        GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+        if (!policyManager) {
+            QCC_DbgHLPrintf(("PolicyManager not defined"));
             return GW_ACL_RC_POLICYMANAGER_ERROR;
         }
 
-        status = m_AppBusObject->SendAclUpdatedSignal();
+        policyManager->beginTransaction();
+        status = updatePolicyManager();
         if (status != ER_OK) {
-            QCC_LogError(status, ("Sending AclUpdated Failed"));
+            QCC_LogError(status, ("Could not update policies successfully"));
+            policyManager->rollbackTransaction();
+            return GW_ACL_RC_POLICYMANAGER_ERROR;
         }
 
         if (m_OperationalStatus == GW_OS_RUNNING && !hasActiveAcl()) {
@@ -558,6 +662,17 @@ AclResponseCode GatewayConnectorApp::deleteAcl(qcc::String const& aclId)
                 QCC_DbgHLPrintf(("Could not stop the app %s", m_ConnectorId.c_str()));
             }
         }
+
+        status = policyManager->commitTransaction();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not commit the Policies of app %s", m_ConnectorId.c_str()));
+            return GW_ACL_RC_POLICYMANAGER_ERROR;
+        }
+
+        status = m_AppBusObject->SendAclUpdatedSignal();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Sending AclUpdated Failed"));
+        }
     }
 
     return GW_ACL_RC_SUCCESS;
@@ -576,6 +691,8 @@ QStatus GatewayConnectorApp::updatePolicyManager()
     for (it = m_Acls.begin(); it != m_Acls.end(); it++) {
         if (it->second->getAclStatus() == GW_AS_ACTIVE) {
             aclRules.push_back(it->second->getAclRules());
+            aclRules.back().setAclId(it->first);
+            aclRules.back().setRevision(it->second->getRevision());
         }
     }
 
@@ -18,17 +18,115 @@
 #include <alljoyn/gateway/GatewayConnectorAppManager.h>
 #include <alljoyn/gateway/GatewayMgmt.h>
 #include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayStats.h>
 #include "busObjects/AppMgmtBusObject.h"
 #include "GatewayConstants.h"
 #include <dirent.h>
+#include <string.h>
 #include <algorithm>
+#include <libxml/parser.h>
 
 namespace ajn {
 namespace gw {
 using namespace qcc;
 using namespace gwConsts;
 
-GatewayConnectorAppManager::GatewayConnectorAppManager() : m_AppMgmtBusObject(NULL)
+static qcc::String getConnectorId(qcc::String const& appName)
+{
+    std::string tmpConnId = appName.c_str();
+    tmpConnId.erase(std::remove(tmpConnId.begin(), tmpConnId.end(), '-'), tmpConnId.end());
+    return tmpConnId.c_str();
+}
+
+/**
+ * Record the files and directories the Apps and their Acls are loaded from,
+ * including the ones that could not be parsed
+ */
+static void addSnapshotFiles(GatewaySnapshot& snapshot)
+{
+    snapshot.addFile(GATEWAY_XML_XSD);
+    snapshot.addFile(GATEWAY_APPS_DIRECTORY);
+
+    DIR* dir = opendir(GATEWAY_APPS_DIRECTORY.c_str());
+    if (dir == NULL) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_DIR || strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        qcc::String appDirName = GATEWAY_APPS_DIRECTORY + "/" + entry->d_name;
+        qcc::String aclDirName = appDirName + "/acls";
+        snapshot.addFile(appDirName);
+        snapshot.addFile(appDirName + "/Manifest.xml");
+        snapshot.addFile(aclDirName);
+
+        DIR* aclDir = opendir(aclDirName.c_str());
+        if (aclDir == NULL) {
+            continue;
+        }
+        struct dirent* aclEntry;
+        while ((aclEntry = readdir(aclDir)) != NULL) {
+            if (aclEntry->d_type == DT_REG) {
+                snapshot.addFile(aclDirName + "/" + aclEntry->d_name);
+            }
+        }
+        closedir(aclDir);
+    }
+    closedir(dir);
+}
+
+/**
+ * Parses the Manifest and the Acls of one App per item
+ */
+class LoadConnectorAppsTask : public GatewayWorkerTask {
+
+  public:
+
+    LoadConnectorAppsTask(qcc::String const& appsDirectory, std::vector<qcc::String> const& appNames) :
+        m_AppsDirectory(appsDirectory), m_AppNames(appNames), m_Apps(appNames.size(), NULL)
+    {
+    }
+
+    void execute(size_t taskIndex, size_t workerIndex)
+    {
+        QCC_UNUSED(workerIndex);
+        qcc::String const& appName = m_AppNames[taskIndex];
+        qcc::String connectorId = getConnectorId(appName);
+
+        GatewayConnectorAppManifest manifest;
+        qcc::String manifestFileName = m_AppsDirectory + "/" + appName + "/Manifest.xml";
+        QStatus status = manifest.parseManifestFile(manifestFileName);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not parse the manifest file for app: %s", connectorId.c_str()));
+            return;
+        }
+
+        GatewayConnectorApp* gatewayApp = new GatewayConnectorApp(connectorId, appName, manifest);
+        status = gatewayApp->loadAcls(m_AppsDirectory);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not load the acls of app: %s", connectorId.c_str()));
+            delete gatewayApp;
+            return;
+        }
+        m_Apps[taskIndex] = gatewayApp;
+    }
+
+    std::vector<GatewayConnectorApp*> const& getApps() const
+    {
+        return m_Apps;
+    }
+
+  private:
+    qcc::String const& m_AppsDirectory;
+    std::vector<qcc::String> const& m_AppNames;
+    std::vector<GatewayConnectorApp*> m_Apps;      //NULL for the apps that could not be loaded
+};
+
+GatewayConnectorAppManager::GatewayConnectorAppManager() : m_AppMgmtBusObject(NULL), m_LoadThreads(0)
 {
 }
 
@@ -36,12 +134,34 @@ GatewayConnectorAppManager::~GatewayConnectorAppManager()
 {
 }
 
+void GatewayConnectorAppManager::setLoadThreads(uint32_t numThreads)
+{
+    m_LoadThreads = numThreads;
+}
+
 std::map<String, GatewayConnectorApp*> GatewayConnectorAppManager::getConnectorApps() const
 {
     return m_ConnectorApps;
 }
 
-QStatus GatewayConnectorAppManager::init(BusAttachment* bus)
+void GatewayConnectorAppManager::getAclCounts(size_t* numAcls, size_t* numActiveAcls) const
+{
+    *numAcls = 0;
+    *numActiveAcls = 0;
+    std::map<String, GatewayConnectorApp*>::const_iterator appIter;
+    for (appIter = m_ConnectorApps.begin(); appIter != m_ConnectorApps.end(); appIter++) {
+        const std::map<String, GatewayAcl*>& acls = appIter->second->getAcls();
+        std::map<String, GatewayAcl*>::const_iterator aclIter;
+        for (aclIter = acls.begin(); aclIter != acls.end(); aclIter++) {
+            (*numAcls)++;
+            if (aclIter->second->getAclStatus() == GW_AS_ACTIVE) {
+                (*numActiveAcls)++;
+            }
+        }
+    }
+}
+
+QStatus GatewayConnectorAppManager::init(BusAttachment* bus, GatewaySnapshot* snapshot)
 {
     QStatus status = ER_OK;
 
@@ -68,18 +188,48 @@ QStatus GatewayConnectorAppManager::init(BusAttachment* bus)
         return status;
     }
 
-    status = loadConnectorApps();
-    if (status != ER_OK) {
-        QCC_LogError(status, ("Could not load Installed Apps"));
-        return status;
+    if (snapshot && readSnapshot(*snapshot)) {
+        QCC_DbgPrintf(("Loaded %d Installed Apps from the snapshot", (int)m_ConnectorApps.size()));
+    } else {
+        status = loadConnectorApps();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not load Installed Apps"));
+            return status;
+        }
+    }
+
+    //stage the rules of all the apps and write them with a single reload
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (policyManager) {
+        policyManager->beginTransaction();
     }
 
     std::map<String, GatewayConnectorApp*>::iterator it;
     for (it = m_ConnectorApps.begin(); it != m_ConnectorApps.end(); it++) {
+        //a nested transaction per app, so an app that fails midway stages none of its rules
+        if (policyManager) {
+            policyManager->beginTransaction();
+        }
         status = it->second->init(bus);
         if (status != ER_OK) {
             QCC_LogError(status, ("Could not register app"));
-            return status;
+            if (policyManager) {
+                policyManager->rollbackTransaction();
+            }
+            break;
+        }
+        if (policyManager) {
+            policyManager->commitTransaction();
+        }
+    }
+
+    if (policyManager) {
+        QStatus commitStatus = policyManager->commitTransaction();
+        if (commitStatus != ER_OK) {
+            QCC_LogError(commitStatus, ("Could not commit the Policies of the apps"));
+            if (status == ER_OK) {
+                status = commitStatus;
+            }
         }
     }
 
@@ -126,6 +276,7 @@ QStatus GatewayConnectorAppManager::shutdown(BusAttachment* bus)
         pthread_join(shutdownThreads[i], NULL);
     }
 
+    policyManager->beginTransaction();
     for (it = m_ConnectorApps.begin(); it != m_ConnectorApps.end();) {
         GatewayConnectorApp* app = it->second;
 
@@ -144,18 +295,32 @@ QStatus GatewayConnectorAppManager::shutdown(BusAttachment* bus)
         delete app;
     }
 
+    QStatus status = policyManager->commitTransaction();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not commit the Policies"));
+        returnStatus = status;
+    }
+
     return returnStatus;
 }
 
 QStatus GatewayConnectorAppManager::loadConnectorApps()
+{
+    GatewayWorkerPool workerPool(m_LoadThreads);
+    return loadConnectorApps(GATEWAY_APPS_DIRECTORY, workerPool, m_ConnectorApps);
+}
+
+QStatus GatewayConnectorAppManager::loadConnectorApps(qcc::String const& appsDirectory, GatewayWorkerPool& workerPool,
+                                                      std::map<qcc::String, GatewayConnectorApp*>& connectorApps)
 {
     DIR* dir;
     struct dirent* entry;
-    if ((dir = opendir(GATEWAY_APPS_DIRECTORY.c_str())) == NULL) {
+    if ((dir = opendir(appsDirectory.c_str())) == NULL) {
         QCC_DbgHLPrintf(("Could not open gatewayApps directory"));
         return ER_FAIL;
     }
 
+    std::vector<qcc::String> appNames;
     while ((entry = readdir(dir)) != NULL) {
 
         qcc::String appName(entry->d_name);
@@ -168,25 +333,91 @@ QStatus GatewayConnectorAppManager::loadConnectorApps()
             continue;
         }
 
-        std::string tmpConnId = appName.c_str();
-        tmpConnId.erase(std::remove(tmpConnId.begin(), tmpConnId.end(), '-'), tmpConnId.end());
-        qcc::String connectorId = tmpConnId.c_str();
+        appNames.push_back(appName);
+    }
+    closedir(dir);
 
-        GatewayConnectorAppManifest manifest;
-        qcc::String manifestFileName = GATEWAY_APPS_DIRECTORY + "/" + appName + "/Manifest.xml";
-        QStatus status = manifest.parseManifestFile(manifestFileName);
-        if (status != ER_OK) {
-            QCC_LogError(status, ("Could not parse the manifest file for app: %s", connectorId.c_str()));
+    //the apps are merged in name order, so a connectorId shared by two app directories
+    //goes to the same one on every start whatever order readdir returns them in
+    std::sort(appNames.begin(), appNames.end());
+
+    //the parser is initialized once before it is used from several threads
+    xmlInitParser();
+    LoadConnectorAppsTask task(appsDirectory, appNames);
+    workerPool.run(task, appNames.size());
+
+    const std::vector<GatewayConnectorApp*>& apps = task.getApps();
+    for (size_t indx = 0; indx < apps.size(); indx++) {
+        if (!apps[indx]) {
             continue;
         }
+        if (!connectorApps.insert(std::pair<qcc::String, GatewayConnectorApp*>(apps[indx]->getConnectorId(), apps[indx])).second) {
+            QCC_DbgHLPrintf(("Ignoring app %s - connectorId %s is taken", appNames[indx].c_str(), apps[indx]->getConnectorId().c_str()));
+            delete apps[indx];
+        }
+    }
+
+    return ER_OK;
+}
+
+void GatewayConnectorAppManager::writeSnapshot(GatewaySnapshot& snapshot) const
+{
+    addSnapshotFiles(snapshot);
 
+    snapshot.putUInt32(m_ConnectorApps.size());
+    std::map<String, GatewayConnectorApp*>::const_iterator it;
+    for (it = m_ConnectorApps.begin(); it != m_ConnectorApps.end(); it++) {
+        snapshot.putString(it->second->getAppName());
+        it->second->getManifest().writeSnapshot(snapshot);
+        it->second->writeSnapshot(snapshot);
+    }
+}
+
+bool GatewayConnectorAppManager::readSnapshot(GatewaySnapshot& snapshot)
+{
+    uint32_t numApps = 0;
+    bool success = snapshot.getUInt32(numApps);
+
+    std::map<String, GatewayConnectorApp*> connectorApps;
+    for (uint32_t indx = 0; success && indx < numApps; indx++) {
+        qcc::String appName;
+        GatewayConnectorAppManifest manifest;
+        success = snapshot.getString(appName) && manifest.readSnapshot(snapshot);
+        if (!success) {
+            break;
+        }
 
+        qcc::String connectorId = getConnectorId(appName);
         GatewayConnectorApp* gatewayApp = new GatewayConnectorApp(connectorId, appName, manifest);
-        m_ConnectorApps.insert(std::pair<qcc::String, GatewayConnectorApp*>(connectorId, gatewayApp));
+        success = gatewayApp->readSnapshot(snapshot);
+        if (!success) {
+            delete gatewayApp;
+            break;
+        }
+        connectorApps.insert(std::pair<qcc::String, GatewayConnectorApp*>(connectorId, gatewayApp));
     }
-    closedir(dir);
 
-    return ER_OK;
+    std::map<String, GatewayConnectorApp*>::iterator it;
+    if (!success) {
+        QCC_DbgHLPrintf(("Could not read the Installed Apps from the snapshot - parsing the apps directory"));
+        for (it = connectorApps.begin(); it != connectorApps.end(); it++) {
+            delete it->second;
+        }
+        return false;
+    }
+
+    //the Acls were not parsed, so count their references to the remoted apps here.
+    //Acls whose rules were not loaded count them once they are parsed
+    for (it = connectorApps.begin(); it != connectorApps.end(); it++) {
+        const std::map<String, GatewayAcl*>& acls = it->second->getAcls();
+        std::map<String, GatewayAcl*>::const_iterator aclIter;
+        for (aclIter = acls.begin(); aclIter != acls.end(); aclIter++) {
+            aclIter->second->countReferences();
+        }
+    }
+
+    m_ConnectorApps.insert(connectorApps.begin(), connectorApps.end());
+    return true;
 }
 
 void GatewayConnectorAppManager::sigChildReceived(pid_t pid)
@@ -194,6 +425,7 @@ void GatewayConnectorAppManager::sigChildReceived(pid_t pid)
     std::map<String, GatewayConnectorApp*>::iterator it;
     for (it = m_ConnectorApps.begin(); it != m_ConnectorApps.end(); it++) {
         if (it->second->getProcessId() == pid) {
+            GatewayStats::getInstance()->increment(GW_STAT_CONNECTOR_APP_EXITS);
             it->second->sigChildReceived();
             break;
         }
@@ -16,9 +16,9 @@
 
 #include <alljoyn/gateway/GatewayConnectorAppManifest.h>
 #include <alljoyn/gateway/GatewayMgmt.h>
+#include <alljoyn/gateway/GatewaySchemaCache.h>
 #include <fstream>
 #include "GatewayConstants.h"
-#include <libxml/xmlschemas.h>
 
 namespace ajn {
 namespace gw {
@@ -102,38 +102,11 @@ QStatus GatewayConnectorAppManifest::parseManifestFile(qcc::String const& manife
         return ER_XML_MALFORMED;
     }
 
-    xmlSchemaParserCtxtPtr parserCtxt = xmlSchemaNewParserCtxt(GATEWAY_XML_XSD.c_str());
-    if (parserCtxt == NULL) {
-        QCC_DbgHLPrintf(("Could not create xmlSchemaParserCtxtPtr"));
+    //the schema is compiled once and shared by all the manifests
+    QStatus status = GatewaySchemaCache::getInstance()->validate(GATEWAY_XML_XSD, doc);
+    if (status != ER_OK) {
         xmlFreeDoc(doc);
-        return ER_FAIL;
-    }
-
-    xmlSchemaPtr schema = xmlSchemaParse(parserCtxt);
-    if (schema == NULL) {
-        QCC_DbgHLPrintf(("Could not create xmlSchemaPtr"));
-        xmlFreeDoc(doc);
-        xmlSchemaFreeParserCtxt(parserCtxt);
-        return ER_FAIL;
-    }
-
-    xmlSchemaValidCtxtPtr validCtxt = xmlSchemaNewValidCtxt(schema);
-    if (!validCtxt) {
-        QCC_DbgHLPrintf(("Could not create xmlSchemaValidCtxtPtr"));
-        xmlFreeDoc(doc);
-        xmlSchemaFreeParserCtxt(parserCtxt);
-        xmlSchemaFree(schema);
-        return ER_FAIL;
-    }
-
-    int result = xmlSchemaValidateDoc(validCtxt, doc);
-    if (result != 0) {
-        QCC_DbgHLPrintf(("Schema Validation failed. result is %i", result));
-        xmlFreeDoc(doc);
-        xmlSchemaFreeParserCtxt(parserCtxt);
-        xmlSchemaFree(schema);
-        xmlSchemaFreeValidCtxt(validCtxt);
-        return ER_BUS_BAD_XML;
+        return status;
     }
 
     xmlNode* root_element = xmlDocGetRootElement(doc);
@@ -164,9 +137,6 @@ QStatus GatewayConnectorAppManifest::parseManifestFile(qcc::String const& manife
     }
 
     xmlFreeDoc(doc);
-    xmlSchemaFreeParserCtxt(parserCtxt);
-    xmlSchemaFree(schema);
-    xmlSchemaFreeValidCtxt(validCtxt);
     return ER_OK;
 }
 
@@ -278,5 +248,77 @@ void GatewayConnectorAppManifest::parseExecutionInfo(xmlNode* currentKey)
     }
 }
 
+void GatewayConnectorAppManifest::writeSnapshot(GatewaySnapshot& snapshot) const
+{
+    snapshot.putString(m_ManifestData);
+    snapshot.putString(m_PackageName);
+    snapshot.putString(m_FriendlyName);
+    snapshot.putString(m_ExecutableName);
+    snapshot.putString(m_Version);
+    snapshot.putString(m_MinAjSdkVersion);
+    snapshot.putStrings(m_EnvironmentVariables);
+    snapshot.putStrings(m_AppArguments);
+    writeCapabilities(snapshot, m_ExposedServices);
+    writeCapabilities(snapshot, m_RemotedServices);
+}
+
+bool GatewayConnectorAppManifest::readSnapshot(GatewaySnapshot& snapshot)
+{
+    return snapshot.getString(m_ManifestData) && snapshot.getString(m_PackageName) && snapshot.getString(m_FriendlyName) &&
+           snapshot.getString(m_ExecutableName) && snapshot.getString(m_Version) && snapshot.getString(m_MinAjSdkVersion) &&
+           snapshot.getStrings(m_EnvironmentVariables) && snapshot.getStrings(m_AppArguments) &&
+           readCapabilities(snapshot, m_ExposedServices) && readCapabilities(snapshot, m_RemotedServices);
+}
+
+void GatewayConnectorAppManifest::writeCapabilities(GatewaySnapshot& snapshot, Capabilities const& capabilities)
+{
+    snapshot.putUInt32(capabilities.size());
+    for (size_t indx = 0; indx < capabilities.size(); indx++) {
+        const std::vector<GatewayConnectorAppCapability::InterfaceDesc>& interfaces = capabilities[indx].getInterfaces();
+        snapshot.putString(capabilities[indx].getObjectPath());
+        snapshot.putString(capabilities[indx].getObjectPathFriendlyName());
+        snapshot.putUInt8(capabilities[indx].getIsObjectPathPrefix());
+        snapshot.putUInt32(interfaces.size());
+        for (size_t ifaceIndx = 0; ifaceIndx < interfaces.size(); ifaceIndx++) {
+            snapshot.putString(interfaces[ifaceIndx].interfaceName);
+            snapshot.putString(interfaces[ifaceIndx].interfaceFriendlyName);
+            snapshot.putUInt8(interfaces[ifaceIndx].isSecured);
+        }
+    }
+}
+
+bool GatewayConnectorAppManifest::readCapabilities(GatewaySnapshot& snapshot, Capabilities& capabilities)
+{
+    uint32_t numCapabilities;
+    if (!snapshot.getUInt32(numCapabilities)) {
+        return false;
+    }
+
+    capabilities.clear();
+    for (uint32_t indx = 0; indx < numCapabilities; indx++) {
+        qcc::String objectPath, objectFriendly;
+        uint8_t isPrefix;
+        uint32_t numInterfaces;
+        if (!snapshot.getString(objectPath) || !snapshot.getString(objectFriendly) || !snapshot.getUInt8(isPrefix) ||
+            !snapshot.getUInt32(numInterfaces)) {
+            return false;
+        }
+
+        std::vector<GatewayConnectorAppCapability::InterfaceDesc> interfaces;
+        for (uint32_t ifaceIndx = 0; ifaceIndx < numInterfaces; ifaceIndx++) {
+            GatewayConnectorAppCapability::InterfaceDesc interface;
+            uint8_t isSecured;
+            if (!snapshot.getString(interface.interfaceName) || !snapshot.getString(interface.interfaceFriendlyName) ||
+                !snapshot.getUInt8(isSecured)) {
+                return false;
+            }
+            interface.isSecured = isSecured != 0;
+            interfaces.push_back(interface);
+        }
+        capabilities.push_back(GatewayConnectorAppCapability(objectPath, objectFriendly, isPrefix != 0, interfaces));
+    }
+    return true;
+}
+
 } /* namespace gw */
 } /* namespace ajn */
@@ -32,9 +32,22 @@ namespace gwConsts {
 static const uint16_t GATEWAY_PORT = 1020;
 static const uint16_t GATEWAY_MANAGEMENT_VERSION = 1;
 static const uint32_t GATEWAY_IFACE_TIMEOUT_INTERVAL = 5000;
+static const uint32_t GATEWAY_POLICY_COMMIT_WINDOW_MS = 200;
+static const uint32_t GATEWAY_POLICY_COMMIT_MAX_LATENCY_MS = 2000;
+static const uint32_t GATEWAY_POLICY_COMMIT_RETRY_MS = 1000;
+static const uint32_t GATEWAY_POLICY_COMMIT_MAX_RETRY_MS = 60000;
+static const uint32_t GATEWAY_MAX_ANNOUNCED_DEVICES = 0;
+static const uint32_t GATEWAY_ANNOUNCED_DEVICE_TTL_MS = 0;
+static const size_t GATEWAY_SYNCFS_MIN_FILES = 64;
+static const uint32_t GATEWAY_JOURNAL_COMPACTION_THRESHOLD = 1024 * 1024;
+static const uint32_t GATEWAY_JOURNAL_COMPACTION_INTERVAL_MS = 10000;
+static const uint32_t GATEWAY_MAX_INACTIVE_ACL_BODIES = 0;
+static const uint32_t GATEWAY_STARTUP_THREADS = 0;
 
 static const qcc::String GATEWAY_APPS_DIRECTORY = "/opt/alljoyn/apps";
 static const qcc::String GATEWAY_APPID_FILE_PATH = "/opt/alljoyn/gwagent/appId.txt";
+static const qcc::String GATEWAY_SNAPSHOT_FILE = "/opt/alljoyn/gwagent/gwagent.snapshot";
+static const qcc::String GATEWAY_JOURNAL_FILE = "/opt/alljoyn/gwagent/gwagent.journal";
 static const qcc::String GATEWAY_DEFAULT_MGMT_APP_CONF_PATH = "/opt/alljoyn/gwagent/gwApp-config.xml";
 
 static const qcc::String AJPARAM_EMPTY = "";
@@ -60,6 +73,10 @@ static const qcc::String AJPARAM_ACL_METADATA = "{ss}";
 static const qcc::String AJPARAM_ACL_METADATA_ARRAY = "a{ss}";
 static const qcc::String AJPARAM_ACLS_STRUCT = "(ssqo)";
 static const qcc::String AJPARAM_ACLS_STRUCT_ARRAY = "a(ssqo)";
+static const qcc::String AJPARAM_STATS_COUNTER = "{st}";
+static const qcc::String AJPARAM_STATS_COUNTER_ARRAY = "a{st}";
+static const qcc::String AJPARAM_STATS_HISTOGRAM = "{s(tttat)}";
+static const qcc::String AJPARAM_STATS_HISTOGRAM_ARRAY = "a{s(tttat)}";
 
 static const qcc::String AJ_GW_OBJECTPATH = "/gw";
 static const qcc::String AJ_GW_APP_WKN_PREFIX = "org.alljoyn.GWAgent.Connector.";
@@ -70,6 +87,7 @@ static const qcc::String AJ_GW_APP_INTERFACE = "org.alljoyn.gwagent.ctrl.App";
 static const qcc::String AJ_GW_APP_CONNECTOR_INTERFACE = "org.alljoyn.gwagent.connector.App";
 static const qcc::String AJ_GW_ACL_MGMT_INTERFACE = "org.alljoyn.gwagent.ctrl.AclMgmt";
 static const qcc::String AJ_GW_ACL_INTERFACE = "org.alljoyn.gwagent.ctrl.Acl";
+static const qcc::String AJ_GW_STATS_INTERFACE = "org.alljoyn.gwagent.Stats";
 
 static const qcc::String AJ_METHOD_GET_INSTALLED_APPS = "GetInstalledApps";
 static const qcc::String& AJ_GET_INSTALLED_APPS_PARAMS_IN = AJPARAM_EMPTY;
@@ -159,6 +177,16 @@ static const qcc::String AJ_UPDATE_CONNECTION_STATUS_PARAMS_IN = AJPARAM_UINT16;
 static const qcc::String& AJ_UPDATE_CONNECTION_STATUS_PARAMS_OUT = AJPARAM_EMPTY;
 static const qcc::String AJ_UPDATE_CONNECTION_STATUS_PARAM_NAMES = "connectionStatus";
 
+static const qcc::String AJ_METHOD_GET_STATS = "GetStats";
+static const qcc::String& AJ_GET_STATS_PARAMS_IN = AJPARAM_EMPTY;
+static const qcc::String AJ_GET_STATS_PARAMS_OUT = AJPARAM_STATS_COUNTER_ARRAY + AJPARAM_STATS_HISTOGRAM_ARRAY;
+static const qcc::String AJ_GET_STATS_PARAM_NAMES = "counters,latencies";
+
+static const qcc::String AJ_METHOD_RESET_STATS = "ResetStats";
+static const qcc::String& AJ_RESET_STATS_PARAMS_IN = AJPARAM_EMPTY;
+static const qcc::String& AJ_RESET_STATS_PARAMS_OUT = AJPARAM_EMPTY;
+static const qcc::String& AJ_RESET_STATS_PARAM_NAMES = AJPARAM_EMPTY;
+
 static const qcc::String AJ_SIGNAL_ACL_UPDATED = "MergedAclUpdated";
 static const qcc::String& AJ_ACL_UPDATED_PARAMS = AJPARAM_EMPTY;
 static const qcc::String& AJ_ACL_UPDATED_PARAM_NAMES = AJPARAM_EMPTY;
@@ -0,0 +1,445 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <alljoyn/gateway/GatewayJournal.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include <alljoyn/gateway/GatewayStats.h>
+#include "GatewayConstants.h"
+
+namespace ajn {
+namespace gw {
+using namespace qcc;
+
+static const uint32_t RECORD_MAGIC = 0x4c4a4741; // "AGJL"
+static const size_t RECORD_HEADER_SIZE = 4 + 4 + 8;
+
+static uint64_t getMonotonicMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static uint64_t checksum(const uint8_t* data, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t indx = 0; indx < length; indx++) {
+        hash ^= data[indx];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void append(std::vector<uint8_t>& buffer, const void* data, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + length);
+}
+
+static void appendString(std::vector<uint8_t>& buffer, String const& value)
+{
+    uint32_t length = value.size();
+    append(buffer, &length, sizeof(length));
+    append(buffer, value.data(), length);
+}
+
+static void encodeRecord(std::vector<GatewayJournalEntry> const& entries, std::vector<uint8_t>& buffer)
+{
+    std::vector<uint8_t> payload;
+    uint32_t numEntries = entries.size();
+    append(payload, &numEntries, sizeof(numEntries));
+    for (size_t indx = 0; indx < entries.size(); indx++) {
+        uint8_t remove = entries[indx].remove;
+        append(payload, &remove, sizeof(remove));
+        appendString(payload, entries[indx].fileName);
+        appendString(payload, entries[indx].data);
+    }
+
+    uint32_t magic = RECORD_MAGIC;
+    uint32_t payloadSize = payload.size();
+    uint64_t payloadChecksum = checksum(payload.data(), payload.size());
+    append(buffer, &magic, sizeof(magic));
+    append(buffer, &payloadSize, sizeof(payloadSize));
+    append(buffer, &payloadChecksum, sizeof(payloadChecksum));
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+}
+
+static bool readString(const uint8_t* data, size_t length, size_t* position, String& value)
+{
+    uint32_t valueLength;
+    if (length - *position < sizeof(valueLength)) {
+        return false;
+    }
+    memcpy(&valueLength, data + *position, sizeof(valueLength));
+    *position += sizeof(valueLength);
+    if (length - *position < valueLength) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(data + *position), valueLength);
+    *position += valueLength;
+    return true;
+}
+
+static QStatus writeAll(int fd, const uint8_t* data, size_t length)
+{
+    size_t written = 0;
+    while (written < length) {
+        ssize_t rc = write(fd, data + written, length - written);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ER_WRITE_ERROR;
+        }
+        written += rc;
+    }
+    return ER_OK;
+}
+
+GatewayJournal::GatewayJournal(String const& fileName, size_t compactionThreshold, uint32_t compactionIntervalMs) :
+    m_FileName(fileName), m_Fd(-1), m_Size(0), m_CompactionThreshold(compactionThreshold),
+    m_CompactionIntervalMs(compactionIntervalMs), m_LastAppendMs(0), m_LastSequence(0), m_WrittenSequence(0),
+    m_DurableSequence(0), m_Busy(false), m_Failed(false), m_Stopping(false), m_ThreadStarted(false)
+{
+    pthread_mutex_init(&m_Lock, NULL);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_Done, &attr);
+    pthread_cond_init(&m_CompactionNeeded, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+GatewayJournal::~GatewayJournal()
+{
+    shutdown();
+    pthread_cond_destroy(&m_CompactionNeeded);
+    pthread_cond_destroy(&m_Done);
+    pthread_mutex_destroy(&m_Lock);
+}
+
+QStatus GatewayJournal::init()
+{
+    QStatus status = ER_OK;
+
+    if (m_Fd >= 0) {
+        QCC_DbgPrintf(("Journal already open. Ignoring request"));
+        return ER_OK;
+    }
+
+    m_Fd = open(m_FileName.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    if (m_Fd < 0) {
+        QCC_LogError(ER_OS_ERROR, ("Could not open the journal %s: %d", m_FileName.c_str(), errno));
+        return ER_OS_ERROR;
+    }
+
+    //replay the records of the previous run into the files before anything loads them
+    struct stat st;
+    if (fstat(m_Fd, &st) == 0 && st.st_size > 0) {
+        std::vector<uint8_t> content(st.st_size);
+        ssize_t readSize = pread(m_Fd, content.data(), content.size(), 0);
+        if (readSize != (ssize_t)content.size()) {
+            QCC_LogError(ER_OS_ERROR, ("Could not read the journal %s: %d", m_FileName.c_str(), errno));
+            return ER_OS_ERROR;
+        }
+
+        size_t numRecords = decode(content.data(), content.size(), m_Latest);
+        QCC_DbgHLPrintf(("Replaying %d journal records into %d files", (int)numRecords, (int)m_Latest.size()));
+        QCC_UNUSED(numRecords);
+        m_Size = content.size();
+    }
+
+    status = compact();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not replay the journal"));
+        return status;
+    }
+
+    if (pthread_create(&m_CompactionThread, NULL, CompactionThreadWrapper, this) != 0) {
+        QCC_LogError(ER_OS_ERROR, ("Could not start the journal compaction thread"));
+        return ER_OS_ERROR;
+    }
+    m_ThreadStarted = true;
+    return status;
+}
+
+QStatus GatewayJournal::shutdown()
+{
+    pthread_mutex_lock(&m_Lock);
+    m_Stopping = true;
+    pthread_cond_signal(&m_CompactionNeeded);
+    pthread_mutex_unlock(&m_Lock);
+
+    if (m_ThreadStarted) {
+        pthread_join(m_CompactionThread, NULL);
+        m_ThreadStarted = false;
+    }
+
+    if (m_Fd < 0) {
+        return ER_OK;
+    }
+
+    QStatus status = compact();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not fold the journal into the files - it is replayed on the next start"));
+    }
+    close(m_Fd);
+    m_Fd = -1;
+    return status;
+}
+
+QStatus GatewayJournal::append(std::vector<GatewayJournalEntry> const& entries)
+{
+    QStatus status = ER_OK;
+
+    pthread_mutex_lock(&m_Lock);
+    if (m_Fd < 0 || m_Failed) {
+        pthread_mutex_unlock(&m_Lock);
+        QCC_DbgHLPrintf(("Journal is not writable"));
+        return ER_WRITE_ERROR;
+    }
+
+    encodeRecord(entries, m_PendingData);
+    m_PendingEntries.insert(m_PendingEntries.end(), entries.begin(), entries.end());
+    uint64_t sequence = ++m_LastSequence;
+    m_LastAppendMs = getMonotonicMs();
+    GatewayStats::getInstance()->increment(GW_STAT_JOURNAL_RECORDS);
+
+    //the first thread to find the journal idle writes the records of everyone waiting
+    while (m_WrittenSequence < sequence) {
+        if (m_Busy) {
+            pthread_cond_wait(&m_Done, &m_Lock);
+            continue;
+        }
+
+        m_Busy = true;
+        std::vector<uint8_t> data;
+        std::vector<GatewayJournalEntry> groupEntries;
+        data.swap(m_PendingData);
+        groupEntries.swap(m_PendingEntries);
+        uint64_t lastSequence = m_LastSequence;
+        pthread_mutex_unlock(&m_Lock);
+
+        QStatus writeStatus = writeAll(m_Fd, data.data(), data.size());
+        if (writeStatus == ER_OK && fdatasync(m_Fd) != 0) {
+            writeStatus = ER_WRITE_ERROR;
+        }
+        GatewayStats::getInstance()->increment(GW_STAT_JOURNAL_SYNCS);
+
+        pthread_mutex_lock(&m_Lock);
+        if (writeStatus == ER_OK) {
+            for (size_t indx = 0; indx < groupEntries.size(); indx++) {
+                m_Latest[groupEntries[indx].fileName] = groupEntries[indx];
+            }
+            m_DurableSequence = lastSequence;
+            m_Size += data.size();
+            if (m_Size >= m_CompactionThreshold) {
+                pthread_cond_signal(&m_CompactionNeeded);
+            }
+        } else {
+            QCC_LogError(writeStatus, ("Could not write the journal %s: %d", m_FileName.c_str(), errno));
+            m_Failed = true;
+            pthread_cond_signal(&m_CompactionNeeded);
+        }
+        m_WrittenSequence = lastSequence;
+        m_Busy = false;
+        pthread_cond_broadcast(&m_Done);
+    }
+
+    if (sequence > m_DurableSequence) {
+        status = ER_WRITE_ERROR;
+    }
+    pthread_mutex_unlock(&m_Lock);
+    return status;
+}
+
+QStatus GatewayJournal::compact()
+{
+    pthread_mutex_lock(&m_Lock);
+    while (m_Busy) {
+        pthread_cond_wait(&m_Done, &m_Lock);
+    }
+    if (m_Size == 0 && m_Latest.empty() && !m_Failed) {
+        pthread_mutex_unlock(&m_Lock);
+        return ER_OK;
+    }
+
+    //appends queue up behind the compaction and are written once the journal is truncated
+    m_Busy = true;
+    std::map<String, GatewayJournalEntry> latest = m_Latest;
+    pthread_mutex_unlock(&m_Lock);
+
+    QStatus status = fold(latest);
+    if (status == ER_OK && (ftruncate(m_Fd, 0) != 0 || fdatasync(m_Fd) != 0)) {
+        status = ER_WRITE_ERROR;
+        QCC_LogError(status, ("Could not truncate the journal %s: %d", m_FileName.c_str(), errno));
+    }
+
+    pthread_mutex_lock(&m_Lock);
+    if (status == ER_OK) {
+        //nothing was written meanwhile, the folded changes are all there is. A failed
+        //write was truncated away with them, so the journal can take records again
+        m_Latest.clear();
+        m_Size = 0;
+        m_Failed = false;
+        GatewayStats::getInstance()->increment(GW_STAT_JOURNAL_COMPACTIONS);
+    }
+    m_Busy = false;
+    pthread_cond_broadcast(&m_Done);
+    pthread_mutex_unlock(&m_Lock);
+    return status;
+}
+
+size_t GatewayJournal::getSize()
+{
+    pthread_mutex_lock(&m_Lock);
+    size_t size = m_Size;
+    pthread_mutex_unlock(&m_Lock);
+    return size;
+}
+
+bool GatewayJournal::getLatest(String const& fileName, GatewayJournalEntry& entry)
+{
+    pthread_mutex_lock(&m_Lock);
+    std::map<String, GatewayJournalEntry>::const_iterator iter = m_Latest.find(fileName);
+    bool found = iter != m_Latest.end();
+    if (found) {
+        entry = iter->second;
+    }
+    pthread_mutex_unlock(&m_Lock);
+    return found;
+}
+
+QStatus GatewayJournal::fold(std::map<String, GatewayJournalEntry> const& latest)
+{
+    GatewayPersistenceBatch batch;
+    std::map<String, GatewayJournalEntry>::const_iterator iter;
+    for (iter = latest.begin(); iter != latest.end(); iter++) {
+        QStatus status;
+        if (iter->second.remove) {
+            status = batch.stageRemoval(iter->first);
+        } else {
+            status = batch.stage(iter->first, iter->second.data.data(), iter->second.data.size());
+        }
+        if (status != ER_OK) {
+            return status;
+        }
+    }
+    return batch.commit();
+}
+
+size_t GatewayJournal::decode(const uint8_t* data, size_t length, std::map<String, GatewayJournalEntry>& latest)
+{
+    size_t numRecords = 0;
+    size_t position = 0;
+    while (length - position >= RECORD_HEADER_SIZE) {
+        uint32_t magic, payloadSize;
+        uint64_t payloadChecksum;
+        memcpy(&magic, data + position, sizeof(magic));
+        memcpy(&payloadSize, data + position + 4, sizeof(payloadSize));
+        memcpy(&payloadChecksum, data + position + 8, sizeof(payloadChecksum));
+        const uint8_t* payload = data + position + RECORD_HEADER_SIZE;
+
+        if (magic != RECORD_MAGIC || length - position - RECORD_HEADER_SIZE < payloadSize ||
+            checksum(payload, payloadSize) != payloadChecksum) {
+            QCC_DbgHLPrintf(("Journal ends with a torn record at offset %d", (int)position));
+            break;
+        }
+
+        uint32_t numEntries = 0;
+        size_t payloadPosition = sizeof(numEntries);
+        std::vector<GatewayJournalEntry> entries;
+        bool valid = payloadSize >= sizeof(numEntries);
+        if (valid) {
+            memcpy(&numEntries, payload, sizeof(numEntries));
+        }
+        for (uint32_t indx = 0; valid && indx < numEntries; indx++) {
+            GatewayJournalEntry entry;
+            valid = payloadPosition < payloadSize;
+            if (valid) {
+                entry.remove = payload[payloadPosition++] != 0;
+                valid = readString(payload, payloadSize, &payloadPosition, entry.fileName) &&
+                        readString(payload, payloadSize, &payloadPosition, entry.data);
+            }
+            entries.push_back(entry);
+        }
+        if (!valid) {
+            QCC_LogError(ER_FAIL, ("Journal record at offset %d is malformed", (int)position));
+            break;
+        }
+
+        //a record is applied whole or not at all
+        for (size_t indx = 0; indx < entries.size(); indx++) {
+            latest[entries[indx].fileName] = entries[indx];
+        }
+        position += RECORD_HEADER_SIZE + payloadSize;
+        numRecords++;
+    }
+    return numRecords;
+}
+
+void* GatewayJournal::CompactionThreadWrapper(void* arg)
+{
+    GatewayJournal* journal = static_cast<GatewayJournal*>(arg);
+    journal->CompactionThread();
+    return NULL;
+}
+
+void GatewayJournal::CompactionThread()
+{
+    pthread_mutex_lock(&m_Lock);
+    while (!m_Stopping) {
+        if (m_Size == 0 && !m_Failed) {
+            pthread_cond_wait(&m_CompactionNeeded, &m_Lock);
+            continue;
+        }
+
+        uint64_t deadline = m_LastAppendMs + m_CompactionIntervalMs;
+        if (m_Size < m_CompactionThreshold && getMonotonicMs() < deadline) {
+            struct timespec wakeup;
+            wakeup.tv_sec = deadline / 1000;
+            wakeup.tv_nsec = (deadline % 1000) * 1000000;
+            pthread_cond_timedwait(&m_CompactionNeeded, &m_Lock, &wakeup);
+            continue;
+        }
+
+        pthread_mutex_unlock(&m_Lock);
+        QStatus status = compact();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not compact the journal"));
+        }
+        pthread_mutex_lock(&m_Lock);
+        if (status != ER_OK && !m_Stopping) {
+            //retry after another interval instead of spinning
+            uint64_t retry = getMonotonicMs() + m_CompactionIntervalMs;
+            struct timespec wakeup;
+            wakeup.tv_sec = retry / 1000;
+            wakeup.tv_nsec = (retry % 1000) * 1000000;
+            pthread_cond_timedwait(&m_CompactionNeeded, &m_Lock, &wakeup);
+        }
+    }
+    pthread_mutex_unlock(&m_Lock);
+}
+
+} /* namespace gw */
+} /* namespace ajn */
@@ -15,9 +15,11 @@
  ******************************************************************************/
 
 #include <alljoyn/gateway/GatewayMetadataManager.h>
+#include <alljoyn/gateway/GatewayMgmt.h>
 #include "GatewayConstants.h"
+#include <alljoyn/gateway/GatewayStats.h>
+#include <alljoyn/gateway/GatewayXmlWriter.h>
 #include <libxml/tree.h>
-#include <libxml/xmlwriter.h>
 #include <libxml/parser.h>
 #include <fstream>
 
@@ -33,8 +35,16 @@ GatewayMetadataManager::~GatewayMetadataManager()
 {
 }
 
-QStatus GatewayMetadataManager::init()
+QStatus GatewayMetadataManager::init(GatewaySnapshot* snapshot)
 {
+    if (snapshot) {
+        if (readSnapshot(*snapshot)) {
+            return ER_OK;
+        }
+        QCC_DbgHLPrintf(("Could not read the Metadata from the snapshot - parsing the Metadata File"));
+        m_Metadata.clear();
+    }
+
     std::ifstream ifs((GATEWAY_APPS_DIRECTORY + "/Metadata.xml").c_str());
     if (ifs.fail()) {
         QCC_DbgHLPrintf(("Metadata File doesn't exist"));
@@ -115,10 +125,10 @@ QStatus GatewayMetadataManager::init()
     return ER_OK;
 }
 
-QStatus GatewayMetadataManager::cleanup()
+QStatus GatewayMetadataManager::cleanup(bool* updated)
 {
     bool metadataUpdated = false;
-    std::map<GatewayAppIdentifier, MetadataValues>::iterator iter;
+    std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash>::iterator iter;
     for (iter = m_Metadata.begin(); iter != m_Metadata.end();) {
         if (!iter->second.refCount) {
             m_Metadata.erase(iter++);
@@ -127,6 +137,9 @@ QStatus GatewayMetadataManager::cleanup()
             iter++;
         }
     }
+    if (updated) {
+        *updated = metadataUpdated;
+    }
     if (metadataUpdated) {
         return writeToFile();
     }
@@ -135,7 +148,42 @@ QStatus GatewayMetadataManager::cleanup()
     return ER_OK;
 }
 
-QStatus GatewayMetadataManager::updateMetadata(std::map<qcc::String, qcc::String> const& metadata)
+void GatewayMetadataManager::writeSnapshot(GatewaySnapshot& snapshot) const
+{
+    snapshot.addFile(GATEWAY_APPS_DIRECTORY + "/Metadata.xml");
+    snapshot.putUInt32(m_Metadata.size());
+    std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash>::const_iterator iter;
+    for (iter = m_Metadata.begin(); iter != m_Metadata.end(); iter++) {
+        snapshot.putString(iter->first.getAppId());
+        snapshot.putString(iter->first.getDeviceId());
+        snapshot.putString(iter->second.appName);
+        snapshot.putString(iter->second.deviceName);
+    }
+}
+
+bool GatewayMetadataManager::readSnapshot(GatewaySnapshot& snapshot)
+{
+    uint32_t numEntries;
+    if (!snapshot.getUInt32(numEntries)) {
+        return false;
+    }
+
+    for (uint32_t indx = 0; indx < numEntries; indx++) {
+        qcc::String appId, deviceId, appName, deviceName;
+        if (!snapshot.getString(appId) || !snapshot.getString(deviceId) || !snapshot.getString(appName) ||
+            !snapshot.getString(deviceName)) {
+            return false;
+        }
+        GatewayAppIdentifier key(appId, deviceId);
+        qcc::String appNameKey = deviceId + "_" + appId + "_APP_NAME";
+        qcc::String deviceNameKey = deviceId + "_" + appId + "_DEVICE_NAME";
+        MetadataValues value(appNameKey, deviceNameKey, appName, deviceName);
+        m_Metadata.insert(std::pair<GatewayAppIdentifier, MetadataValues>(key, value));
+    }
+    return true;
+}
+
+QStatus GatewayMetadataManager::updateMetadata(std::map<qcc::String, qcc::String> const& metadata, GatewayPersistenceBatch* batch)
 {
     bool metadataUpdated = false;
 
@@ -166,7 +214,7 @@ QStatus GatewayMetadataManager::updateMetadata(std::map<qcc::String, qcc::String
         qcc::String type = key.substr(typePos + 1);
 
         GatewayAppIdentifier appDeviceKey(appId, deviceId);
-        std::map<GatewayAppIdentifier, MetadataValues>::iterator it;
+        std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash>::iterator it;
         if ((it = m_Metadata.find(appDeviceKey)) != m_Metadata.end()) {
             if (type.compare("APP_NAME") == 0) {
                 if (!metadataUpdated && it->second.appName.compare(iter->second) != 0) {
@@ -201,7 +249,7 @@ QStatus GatewayMetadataManager::updateMetadata(std::map<qcc::String, qcc::String
         }
     }
     if (metadataUpdated) {
-        QStatus status = writeToFile();
+        QStatus status = writeToFile(batch);
         if (status != ER_OK) {
             QCC_LogError(status, ("Could not write to Metadata File"));
         }
@@ -214,7 +262,7 @@ QStatus GatewayMetadataManager::updateMetadata(std::map<qcc::String, qcc::String
 
 void GatewayMetadataManager::addMetadataValues(GatewayAppIdentifier const& key, std::map<qcc::String, qcc::String>* metadata)
 {
-    std::map<GatewayAppIdentifier, MetadataValues>::iterator iter;
+    std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash>::iterator iter;
     if ((iter = m_Metadata.find(key)) != m_Metadata.end()) {
         metadata->insert(std::pair<qcc::String, qcc::String>(iter->second.appNameKey, iter->second.appName));
         metadata->insert(std::pair<qcc::String, qcc::String>(iter->second.deviceNameKey, iter->second.deviceName));
@@ -223,84 +271,81 @@ void GatewayMetadataManager::addMetadataValues(GatewayAppIdentifier const& key,
 
 void GatewayMetadataManager::incRemoteAppRefCount(GatewayAppIdentifier const& key)
 {
-    std::map<GatewayAppIdentifier, MetadataValues>::iterator iter;
+    std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash>::iterator iter;
     if ((iter = m_Metadata.find(key)) != m_Metadata.end()) {
         iter->second.refCount++;
     }
 }
 
-QStatus GatewayMetadataManager::writeToFile()
+size_t GatewayMetadataManager::getNumMetadataEntries() const
 {
-    QStatus status = ER_FAIL;
-    std::map<GatewayAppIdentifier, MetadataValues>::iterator iter;
+    return m_Metadata.size();
+}
 
-    xmlDocPtr doc = xmlNewDoc((xmlChar*)XML_DEFAULT_VERSION);
-    if (doc == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml document tree"));
-        return status;
-    }
+QStatus GatewayMetadataManager::writeToFile(GatewayPersistenceBatch* batch)
+{
+    QStatus status = ER_FAIL;
+    std::unordered_map<GatewayAppIdentifier, MetadataValues, GatewayAppIdentifier::Hash>::iterator iter;
 
-    xmlTextWriterPtr writer = xmlNewTextWriterDoc(&doc, 0);
-    if (writer == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml writer\n"));
-        xmlFreeDoc(doc);
-        return status;
-    }
+    GatewayXmlWriter writer;
 
-    int rc = xmlTextWriterStartDocument(writer, "1.0", NULL, NULL);
+    int rc = writer.startDocument();
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteComment(writer, (xmlChar*)GATEWAY_XML_COMMENT.c_str());
+    rc = writer.writeComment(GATEWAY_XML_COMMENT.c_str());
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"Metadata");
+    rc = writer.startElement("Metadata");
     if (rc < 0) {
         goto exit;
     }
     for (iter = m_Metadata.begin(); iter != m_Metadata.end(); iter++) {
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"remotedApp");
+        rc = writer.startElement("remotedApp");
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"appId", (xmlChar*)iter->first.getAppId().c_str());
+        rc = writer.writeElement("appId", iter->first.getAppId().c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"deviceId", (xmlChar*)iter->first.getDeviceId().c_str());
+        rc = writer.writeElement("deviceId", iter->first.getDeviceId().c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"appName", (xmlChar*)iter->second.appName.c_str());
+        rc = writer.writeElement("appName", iter->second.appName.c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteElement(writer, (xmlChar*)"deviceName", (xmlChar*)iter->second.deviceName.c_str());
+        rc = writer.writeElement("deviceName", iter->second.deviceName.c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterEndElement(writer);         //close remoteApp tag
+        rc = writer.endElement();         //close remoteApp tag
         if (rc < 0) {
             goto exit;
         }
     }
-    rc = xmlTextWriterEndDocument(writer);     //closes all open tags
+    rc = writer.endDocument();     //closes all open tags
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlSaveFormatFile((GATEWAY_APPS_DIRECTORY + "/Metadata.xml").c_str(), doc, 1);
-    if (rc < 0) {
-        status = ER_WRITE_ERROR;
-        goto exit;
+    if (batch) {
+        status = batch->stage(GATEWAY_APPS_DIRECTORY + "/Metadata.xml", writer.getData(), writer.getSize());
+    } else {
+        GatewayPersistenceBatch fileBatch(GatewayMgmt::getInstance()->getJournal());
+        status = fileBatch.stage(GATEWAY_APPS_DIRECTORY + "/Metadata.xml", writer.getData(), writer.getSize());
+        if (status == ER_OK) {
+            status = fileBatch.commit();
+        }
+    }
+    if (status == ER_OK) {
+        GatewayStats::getInstance()->increment(GW_STAT_METADATA_WRITES);
     }
-    status = ER_OK;
 
 exit:
 
-    xmlFreeTextWriter(writer);
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
     return status;
 }
 
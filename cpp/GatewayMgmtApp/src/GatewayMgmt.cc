@@ -16,10 +16,14 @@
 
 #include <sys/wait.h>
 #include <alljoyn/gateway/GatewayMgmt.h>
+#include <alljoyn/gateway/GatewayAcl.h>
 #include <alljoyn/gateway/GatewayConnectorAppManager.h>
 #include <alljoyn/gateway/GatewayMetadataManager.h>
 #include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewaySchemaCache.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
 #include "GatewayConstants.h"
+#include <libxml/parser.h>
 
 namespace ajn {
 namespace gw {
@@ -40,8 +44,13 @@ GatewayMgmt* GatewayMgmt::getInstance()
 
 GatewayMgmt::GatewayMgmt() : m_Bus(NULL), m_BusListener(NULL),
     m_RouterPolicyManager(NULL), m_ConnectorAppManager(NULL), m_MetadataManager(NULL),
-    m_gatewayPolicyFile(""), m_appPolicyDirectory("")
+    m_gatewayPolicyFile(""), m_appPolicyDirectory(""),
+    m_PolicyCommitWindowMs(GATEWAY_POLICY_COMMIT_WINDOW_MS), m_PolicyCommitMaxLatencyMs(GATEWAY_POLICY_COMMIT_MAX_LATENCY_MS),
+    m_MaxAnnouncedDevices(GATEWAY_MAX_ANNOUNCED_DEVICES), m_AnnouncedDeviceTtlMs(GATEWAY_ANNOUNCED_DEVICE_TTL_MS),
+    m_AclPolicyFragments(false), m_AclsUnannounced(false), m_AclJournal(false),
+    m_Journal(NULL), m_StartupThreads(GATEWAY_STARTUP_THREADS), m_LazyAclBodies(false), m_MaxInactiveAclBodies(GATEWAY_MAX_INACTIVE_ACL_BODIES), m_SnapshotEnabled(false)
 {
+    pthread_mutex_init(&m_SnapshotLock, NULL);
 }
 
 GatewayMgmt::~GatewayMgmt()
@@ -51,6 +60,7 @@ GatewayMgmt::~GatewayMgmt()
     if (this == s_Instance) {
         s_Instance = NULL;
     }
+    pthread_mutex_destroy(&m_SnapshotLock);
 }
 
 uint16_t GatewayMgmt::getVersion()
@@ -124,14 +134,32 @@ QStatus GatewayMgmt::initGatewayMgmt(BusAttachment* bus)
         return status;
     }
 
+    if (m_AclJournal) {
+        //the journal of the previous run is folded into the files before they are loaded
+        m_Journal = new GatewayJournal(GATEWAY_JOURNAL_FILE, GATEWAY_JOURNAL_COMPACTION_THRESHOLD,
+                                       GATEWAY_JOURNAL_COMPACTION_INTERVAL_MS);
+        status = m_Journal->init();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not initialize the Journal"));
+            return status;
+        }
+    }
+
+    //a stale or corrupt snapshot is ignored and the xml files are parsed instead
+    GatewaySnapshot snapshot;
+    bool snapshotLoaded = m_SnapshotEnabled && snapshot.load(GATEWAY_SNAPSHOT_FILE) == ER_OK;
+
     m_MetadataManager = new GatewayMetadataManager();
-    status = m_MetadataManager->init();
+    status = m_MetadataManager->init(snapshotLoaded ? &snapshot : NULL);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not initialize the Metadata Manager"));
         return status;
     }
 
     m_RouterPolicyManager = new GatewayRouterPolicyManager();
+    m_RouterPolicyManager->setCommitWindow(m_PolicyCommitWindowMs, m_PolicyCommitMaxLatencyMs);
+    m_RouterPolicyManager->setAnnouncedDevicesLimit(m_MaxAnnouncedDevices, m_AnnouncedDeviceTtlMs);
+    m_RouterPolicyManager->setAclPolicyFragments(m_AclPolicyFragments);
     status = m_RouterPolicyManager->init(bus);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not initialize the Policy Manager"));
@@ -139,7 +167,8 @@ QStatus GatewayMgmt::initGatewayMgmt(BusAttachment* bus)
     }
 
     m_ConnectorAppManager = new GatewayConnectorAppManager();
-    status = m_ConnectorAppManager->init(bus);
+    m_ConnectorAppManager->setLoadThreads(m_StartupThreads);
+    status = m_ConnectorAppManager->init(bus, snapshotLoaded ? &snapshot : NULL);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not initialize the App Manager"));
         return status;
@@ -158,10 +187,20 @@ QStatus GatewayMgmt::initGatewayMgmt(BusAttachment* bus)
         return status;
     }
 
-    status = m_MetadataManager->cleanup();
-    if (status != ER_OK) {
-        QCC_LogError(status, ("Could not cleanup the MetadataManager"));
-        return status;
+    //the references of Acls whose rules were not parsed are unknown
+    bool metadataUpdated = false;
+    if (GatewayAcl::referencesCounted()) {
+        status = m_MetadataManager->cleanup(&metadataUpdated);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not cleanup the MetadataManager"));
+            return status;
+        }
+    } else {
+        QCC_DbgHLPrintf(("Not all acls are parsed - skipping the cleanup of the MetadataManager"));
+    }
+
+    if (!snapshotLoaded || !snapshot.isValid() || metadataUpdated) {
+        saveSnapshot();
     }
 
     QCC_DbgPrintf(("Initialized GatewayConnectorApp successfully"));
@@ -179,6 +218,17 @@ QStatus GatewayMgmt::shutdownGatewayMgmt()
 
     if (m_RouterPolicyManager) {
         m_RouterPolicyManager->setAutoCommit(false);
+        //reply to the method calls waiting for a policy commit while their BusObjects still exist
+        m_RouterPolicyManager->flushCommits();
+    }
+
+    //the snapshot records the state of the files, so the journal is folded into them first.
+    //A change after this only makes the snapshot stale, and the files are parsed on the next start
+    if (m_SnapshotEnabled) {
+        if (m_Journal && m_Journal->compact() != ER_OK) {
+            QCC_DbgHLPrintf(("Could not fold the journal before saving the snapshot"));
+        }
+        saveSnapshot();
     }
 
     if (m_ConnectorAppManager) {
@@ -209,6 +259,17 @@ QStatus GatewayMgmt::shutdownGatewayMgmt()
         m_RouterPolicyManager = NULL;
     }
 
+    if (m_Journal) {
+        QStatus status = m_Journal->shutdown();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Could not shutdown the Journal"));
+            returnStatus = status;
+        }
+
+        delete m_Journal;
+        m_Journal = NULL;
+    }
+
     if (m_MetadataManager) {
         delete m_MetadataManager;
         m_MetadataManager = NULL;
@@ -228,6 +289,7 @@ QStatus GatewayMgmt::shutdownGatewayMgmt()
         }
     }
 
+    GatewaySchemaCache::getInstance()->clear();
     xmlCleanupParser();
     m_Bus = NULL;
     return returnStatus;
@@ -268,6 +330,88 @@ void GatewayMgmt::setAppPolicyDir(const char* appPolicyDirectory)
     m_appPolicyDirectory = appPolicyDirectory;
 }
 
+void GatewayMgmt::setPolicyCommitWindow(uint32_t windowMs, uint32_t maxLatencyMs)
+{
+    m_PolicyCommitWindowMs = windowMs;
+    m_PolicyCommitMaxLatencyMs = maxLatencyMs;
+}
+
+void GatewayMgmt::setAnnouncedDevicesLimit(uint32_t maxDevices, uint32_t ttlMs)
+{
+    m_MaxAnnouncedDevices = maxDevices;
+    m_AnnouncedDeviceTtlMs = ttlMs;
+}
+
+void GatewayMgmt::setAclPolicyFragments(bool aclPolicyFragments)
+{
+    m_AclPolicyFragments = aclPolicyFragments;
+}
+
+void GatewayMgmt::setAclsUnannounced(bool aclsUnannounced)
+{
+    m_AclsUnannounced = aclsUnannounced;
+}
+
+bool GatewayMgmt::getAclsUnannounced() const
+{
+    return m_AclsUnannounced;
+}
+
+void GatewayMgmt::setAclJournal(bool aclJournal)
+{
+    m_AclJournal = aclJournal;
+}
+
+GatewayJournal* GatewayMgmt::getJournal() const
+{
+    return m_Journal;
+}
+
+void GatewayMgmt::setStartupThreads(uint32_t numThreads)
+{
+    m_StartupThreads = numThreads;
+}
+
+void GatewayMgmt::setLazyAclBodies(bool lazyAclBodies, uint32_t maxInactiveBodies)
+{
+    m_LazyAclBodies = lazyAclBodies;
+    m_MaxInactiveAclBodies = maxInactiveBodies;
+}
+
+bool GatewayMgmt::getLazyAclBodies() const
+{
+    return m_LazyAclBodies;
+}
+
+uint32_t GatewayMgmt::getMaxInactiveAclBodies() const
+{
+    return m_MaxInactiveAclBodies;
+}
+
+void GatewayMgmt::setSnapshotEnabled(bool snapshotEnabled)
+{
+    m_SnapshotEnabled = snapshotEnabled;
+}
+
+QStatus GatewayMgmt::saveSnapshot()
+{
+    if (!m_SnapshotEnabled || !m_MetadataManager || !m_ConnectorAppManager) {
+        return ER_OK;
+    }
+
+    pthread_mutex_lock(&m_SnapshotLock);
+    GatewaySnapshot snapshot;
+    m_MetadataManager->writeSnapshot(snapshot);
+    m_ConnectorAppManager->writeSnapshot(snapshot);
+    QStatus status = snapshot.save(GATEWAY_SNAPSHOT_FILE);
+    pthread_mutex_unlock(&m_SnapshotLock);
+
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not save the snapshot"));
+    }
+    return status;
+}
+
 
 } /* namespace gw */
 } /* namespace ajn */
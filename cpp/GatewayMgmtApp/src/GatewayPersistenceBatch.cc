@@ -0,0 +1,295 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <map>
+#include <set>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include "GatewayConstants.h"
+
+namespace ajn {
+namespace gw {
+using namespace qcc;
+using namespace gwConsts;
+
+static const char* const TEMP_FILE_INFIX = ".tmp-";
+
+GatewayPersistenceBatch::GatewayPersistenceBatch() : m_Journal(NULL)
+{
+    pthread_mutex_init(&m_StageLock, NULL);
+}
+
+GatewayPersistenceBatch::GatewayPersistenceBatch(GatewayJournal* journal) : m_Journal(journal)
+{
+    pthread_mutex_init(&m_StageLock, NULL);
+}
+
+GatewayPersistenceBatch::~GatewayPersistenceBatch()
+{
+    abort();
+    pthread_mutex_destroy(&m_StageLock);
+}
+
+bool GatewayPersistenceBatch::isTempFile(qcc::String const& entryName)
+{
+    return entryName.size() && entryName[0] == '.' && entryName.find(TEMP_FILE_INFIX) != qcc::String::npos;
+}
+
+bool GatewayPersistenceBatch::empty() const
+{
+    return m_StagedFiles.empty() && m_RemovedFiles.empty() && m_JournalEntries.empty();
+}
+
+std::vector<qcc::String> GatewayPersistenceBatch::getFileNames() const
+{
+    std::vector<qcc::String> fileNames;
+    for (size_t indx = 0; indx < m_StagedFiles.size(); indx++) {
+        fileNames.push_back(m_StagedFiles[indx].fileName);
+    }
+    fileNames.insert(fileNames.end(), m_RemovedFiles.begin(), m_RemovedFiles.end());
+    for (size_t indx = 0; indx < m_JournalEntries.size(); indx++) {
+        fileNames.push_back(m_JournalEntries[indx].fileName);
+    }
+    return fileNames;
+}
+
+QStatus GatewayPersistenceBatch::stage(qcc::String const& fileName, const void* data, size_t length)
+{
+    if (m_Journal) {
+        GatewayJournalEntry entry;
+        entry.fileName = fileName;
+        entry.data.assign((const char*)data, length);
+        entry.remove = false;
+        pthread_mutex_lock(&m_StageLock);
+        m_JournalEntries.push_back(entry);
+        pthread_mutex_unlock(&m_StageLock);
+        return ER_OK;
+    }
+
+    size_t slashPos = fileName.find_last_of('/');
+    qcc::String dirName = slashPos == qcc::String::npos ? "." : fileName.substr(0, slashPos);
+    qcc::String baseName = slashPos == qcc::String::npos ? fileName : fileName.substr(slashPos + 1);
+
+    //hidden name so directory scanners and includedir ignore half written files
+    qcc::String tempName = dirName + "/." + baseName + TEMP_FILE_INFIX + "XXXXXX";
+    std::vector<char> tempTemplate(tempName.c_str(), tempName.c_str() + tempName.size() + 1);
+    int fd = mkstemp(tempTemplate.data());
+    if (fd < 0) {
+        QCC_LogError(ER_WRITE_ERROR, ("Could not create a temporary file for %s: %d", fileName.c_str(), errno));
+        return ER_WRITE_ERROR;
+    }
+    tempName = tempTemplate.data();
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+    const char* buffer = (const char*)data;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t rc = write(fd, buffer + written, length - written);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            QCC_LogError(ER_WRITE_ERROR, ("Could not write the temporary file for %s: %d", fileName.c_str(), errno));
+            close(fd);
+            unlink(tempName.c_str());
+            return ER_WRITE_ERROR;
+        }
+        written += rc;
+    }
+
+    StagedFile stagedFile;
+    stagedFile.fileName = fileName;
+    stagedFile.tempName = tempName;
+    stagedFile.fd = fd;
+    pthread_mutex_lock(&m_StageLock);
+    m_StagedFiles.push_back(stagedFile);
+    pthread_mutex_unlock(&m_StageLock);
+    return ER_OK;
+}
+
+QStatus GatewayPersistenceBatch::stageRemoval(qcc::String const& fileName)
+{
+    pthread_mutex_lock(&m_StageLock);
+    if (m_Journal) {
+        GatewayJournalEntry entry;
+        entry.fileName = fileName;
+        entry.remove = true;
+        m_JournalEntries.push_back(entry);
+    } else {
+        m_RemovedFiles.push_back(fileName);
+    }
+    pthread_mutex_unlock(&m_StageLock);
+    return ER_OK;
+}
+
+static bool syncfsReportsErrors()
+{
+#if defined(__linux__)
+    //syncfs only returns writeback errors since Linux 5.8
+    struct utsname name;
+    int major = 0, minor = 0;
+    if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2) {
+        return false;
+    }
+    return major > 5 || (major == 5 && minor >= 8);
+#else
+    return false;
+#endif
+}
+
+QStatus GatewayPersistenceBatch::syncBarrier(std::vector<int> const& fds, bool dataOnly)
+{
+    QStatus status = ER_OK;
+#if defined(__linux__)
+    //syncfs flushes every file of the filesystem, unrelated writers included, so it
+    //only pays off for large batches, and only where it reports writeback errors
+    static const bool useSyncfs = syncfsReportsErrors();
+    if (useSyncfs && fds.size() >= GATEWAY_SYNCFS_MIN_FILES) {
+        std::set<dev_t> syncedDevices;
+        bool syncfsFailed = false;
+        for (size_t indx = 0; indx < fds.size(); indx++) {
+            struct stat fileStat;
+            if (fstat(fds[indx], &fileStat) != 0) {
+                syncfsFailed = true;
+                break;
+            }
+            if (!syncedDevices.insert(fileStat.st_dev).second) {
+                continue;
+            }
+            if (syncfs(fds[indx]) != 0) {
+                syncfsFailed = true;
+                break;
+            }
+        }
+        if (!syncfsFailed) {
+            return status;
+        }
+    }
+#endif
+    for (size_t indx = 0; indx < fds.size(); indx++) {
+        int rc = dataOnly ? fdatasync(fds[indx]) : fsync(fds[indx]);
+        if (rc != 0 && errno != EINVAL) {
+            QCC_LogError(ER_WRITE_ERROR, ("Could not sync file: %d", errno));
+            status = ER_WRITE_ERROR;
+        }
+    }
+    return status;
+}
+
+QStatus GatewayPersistenceBatch::commit()
+{
+    if (m_Journal) {
+        QStatus status = m_JournalEntries.empty() ? ER_OK : m_Journal->append(m_JournalEntries);
+        m_JournalEntries.clear();
+        return status;
+    }
+
+    if (m_StagedFiles.empty() && m_RemovedFiles.empty()) {
+        return ER_OK;
+    }
+
+    std::vector<int> fds;
+    for (size_t indx = 0; indx < m_StagedFiles.size(); indx++) {
+        fds.push_back(m_StagedFiles[indx].fd);
+    }
+    QStatus status = fds.empty() ? ER_OK : syncBarrier(fds, true);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not sync the staged files - discarding them"));
+        abort();
+        return status;
+    }
+
+    std::set<qcc::String> dirNames;
+    size_t renamed = 0;
+    for (; renamed < m_StagedFiles.size(); renamed++) {
+        StagedFile& stagedFile = m_StagedFiles[renamed];
+        close(stagedFile.fd);
+        stagedFile.fd = -1;
+        if (rename(stagedFile.tempName.c_str(), stagedFile.fileName.c_str()) != 0) {
+            status = ER_WRITE_ERROR;
+            QCC_LogError(status, ("Could not rename the temporary file onto %s: %d", stagedFile.fileName.c_str(), errno));
+            unlink(stagedFile.tempName.c_str());
+            break;
+        }
+        size_t slashPos = stagedFile.fileName.find_last_of('/');
+        dirNames.insert(slashPos == qcc::String::npos ? "." : stagedFile.fileName.substr(0, slashPos));
+    }
+    //renamed files and the failed one are gone - discard whatever was left staged
+    size_t processed = renamed < m_StagedFiles.size() ? renamed + 1 : renamed;
+    m_StagedFiles.erase(m_StagedFiles.begin(), m_StagedFiles.begin() + processed);
+
+    for (size_t indx = 0; status == ER_OK && indx < m_RemovedFiles.size(); indx++) {
+        qcc::String const& fileName = m_RemovedFiles[indx];
+        if (unlink(fileName.c_str()) != 0 && errno != ENOENT) {
+            status = ER_WRITE_ERROR;
+            QCC_LogError(status, ("Could not remove %s: %d", fileName.c_str(), errno));
+            break;
+        }
+        size_t slashPos = fileName.find_last_of('/');
+        dirNames.insert(slashPos == qcc::String::npos ? "." : fileName.substr(0, slashPos));
+    }
+    abort();
+
+    //second barrier makes the renames and removals durable
+    std::vector<int> dirFds;
+    std::set<qcc::String>::const_iterator dirIter;
+    for (dirIter = dirNames.begin(); dirIter != dirNames.end(); dirIter++) {
+        int dirFd = open(dirIter->c_str(), O_RDONLY | O_DIRECTORY);
+        if (dirFd >= 0) {
+            dirFds.push_back(dirFd);
+        }
+    }
+    QStatus syncStatus = syncBarrier(dirFds, false);
+    for (size_t indx = 0; indx < dirFds.size(); indx++) {
+        close(dirFds[indx]);
+    }
+    if (status == ER_OK) {
+        status = syncStatus;
+    }
+    return status;
+}
+
+void GatewayPersistenceBatch::abort()
+{
+    m_JournalEntries.clear();
+    m_RemovedFiles.clear();
+    for (size_t indx = 0; indx < m_StagedFiles.size(); indx++) {
+        if (m_StagedFiles[indx].fd >= 0) {
+            close(m_StagedFiles[indx].fd);
+        }
+        unlink(m_StagedFiles[indx].tempName.c_str());
+    }
+    m_StagedFiles.clear();
+}
+
+QStatus GatewayPersistenceBatch::writeFile(qcc::String const& fileName, const void* data, size_t length)
+{
+    GatewayPersistenceBatch batch;
+    QStatus status = batch.stage(fileName, data, length);
+    if (status != ER_OK) {
+        return status;
+    }
+    return batch.commit();
+}
+
+} /* namespace gw */
+} /* namespace ajn */
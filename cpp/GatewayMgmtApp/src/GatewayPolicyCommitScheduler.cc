@@ -0,0 +1,366 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <time.h>
+#include <alljoyn/gateway/GatewayPolicyCommitScheduler.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include "GatewayConstants.h"
+
+namespace ajn {
+namespace gw {
+using namespace qcc;
+using namespace gwConsts;
+
+static uint64_t getMonotonicMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+GatewayPolicyCommitScheduler::GatewayPolicyCommitScheduler(GatewayRouterPolicyManager* policyManager) :
+    m_PolicyManager(policyManager), m_IsRunning(false), m_IsStopping(false),
+    m_WindowMs(GATEWAY_POLICY_COMMIT_WINDOW_MS), m_MaxLatencyMs(GATEWAY_POLICY_COMMIT_MAX_LATENCY_MS),
+    m_DefaultPoliciesDirty(false), m_PendingChanges(0), m_FirstChangeMs(0), m_LastChangeMs(0),
+    m_IsCommitting(false), m_LastCommitStatus(ER_OK), m_RetryDelayMs(0), m_RetryAtMs(0),
+    m_RetryDefaultPolicies(false), m_RetryChanges(0),
+    m_FullCommitDefaultPolicies(false), m_FullCommitChanges(0), m_BatchesCommitted(0), m_ChangesCommitted(0), m_LastBatchChanges(0)
+{
+    pthread_mutex_init(&m_Lock, NULL);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_PendingChanged, &attr);
+    pthread_cond_init(&m_CommitDone, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+GatewayPolicyCommitScheduler::~GatewayPolicyCommitScheduler()
+{
+    stop();
+    pthread_cond_destroy(&m_CommitDone);
+    pthread_cond_destroy(&m_PendingChanged);
+    pthread_mutex_destroy(&m_Lock);
+}
+
+QStatus GatewayPolicyCommitScheduler::start()
+{
+    pthread_mutex_lock(&m_Lock);
+    if (m_IsRunning) {
+        pthread_mutex_unlock(&m_Lock);
+        return ER_OK;
+    }
+
+    m_IsStopping = false;
+    if (pthread_create(&m_Thread, NULL, CommitThreadWrapper, this) != 0) {
+        pthread_mutex_unlock(&m_Lock);
+        QCC_LogError(ER_OS_ERROR, ("Could not start the policy commit thread"));
+        return ER_OS_ERROR;
+    }
+    m_IsRunning = true;
+    pthread_mutex_unlock(&m_Lock);
+    return ER_OK;
+}
+
+void GatewayPolicyCommitScheduler::stop()
+{
+    pthread_mutex_lock(&m_Lock);
+    if (!m_IsRunning) {
+        pthread_mutex_unlock(&m_Lock);
+        return;
+    }
+    m_IsStopping = true;
+    pthread_cond_signal(&m_PendingChanged);
+    pthread_mutex_unlock(&m_Lock);
+
+    pthread_join(m_Thread, NULL);
+
+    pthread_mutex_lock(&m_Lock);
+    m_IsRunning = false;
+    pthread_mutex_unlock(&m_Lock);
+}
+
+bool GatewayPolicyCommitScheduler::isRunning() const
+{
+    pthread_mutex_lock(&m_Lock);
+    bool isRunning = m_IsRunning && !m_IsStopping;
+    pthread_mutex_unlock(&m_Lock);
+    return isRunning;
+}
+
+void GatewayPolicyCommitScheduler::setWindow(uint32_t windowMs, uint32_t maxLatencyMs)
+{
+    pthread_mutex_lock(&m_Lock);
+    m_WindowMs = windowMs;
+    m_MaxLatencyMs = maxLatencyMs < windowMs ? windowMs : maxLatencyMs;
+    pthread_cond_signal(&m_PendingChanged);
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayPolicyCommitScheduler::markConnectorDirty(qcc::String const& connectorId, bool defaultPoliciesChanged)
+{
+    pthread_mutex_lock(&m_Lock);
+    m_DirtyConnectors.insert(connectorId);
+    if (defaultPoliciesChanged) {
+        m_DefaultPoliciesDirty = true;
+    }
+    addPendingChange();
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayPolicyCommitScheduler::markDefaultPoliciesDirty()
+{
+    pthread_mutex_lock(&m_Lock);
+    m_DefaultPoliciesDirty = true;
+    addPendingChange();
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayPolicyCommitScheduler::notifyWhenCommitted(GatewayPolicyCommitListener* listener)
+{
+    if (!listener) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_Lock);
+    if (m_PendingChanges) {
+        m_PendingListeners.push_back(listener);
+        pthread_mutex_unlock(&m_Lock);
+        return;
+    }
+    if (m_IsCommitting) {
+        m_CommittingListeners.push_back(listener);
+        pthread_mutex_unlock(&m_Lock);
+        return;
+    }
+    QStatus status = m_LastCommitStatus;
+    pthread_mutex_unlock(&m_Lock);
+
+    //the changes were already committed
+    listener->policiesCommitted(status);
+    delete listener;
+}
+
+void GatewayPolicyCommitScheduler::flush()
+{
+    pthread_mutex_lock(&m_Lock);
+    while (m_IsCommitting) {
+        pthread_cond_wait(&m_CommitDone, &m_Lock);
+    }
+    if (m_PendingChanges || m_RetryChanges) {
+        commitPending();
+    }
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayPolicyCommitScheduler::startFullCommit()
+{
+    pthread_mutex_lock(&m_Lock);
+    while (m_IsCommitting) {
+        pthread_cond_wait(&m_CommitDone, &m_Lock);
+    }
+    m_FullCommitConnectors.clear();
+    m_FullCommitChanges = takePending(m_FullCommitConnectors, m_FullCommitDefaultPolicies);
+    if (m_FullCommitChanges) {
+        QCC_DbgPrintf(("Full commit supersedes %u pending policy changes", m_FullCommitChanges));
+    }
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayPolicyCommitScheduler::completeFullCommit(QStatus status)
+{
+    pthread_mutex_lock(&m_Lock);
+    if (status != ER_OK && m_FullCommitChanges) {
+        retryLater(m_FullCommitConnectors, m_FullCommitDefaultPolicies, m_FullCommitChanges);
+    } else if (status == ER_OK) {
+        m_RetryDelayMs = 0;
+        m_RetryAtMs = 0;
+    }
+    m_FullCommitConnectors.clear();
+    m_FullCommitChanges = 0;
+    finishCommit(status);
+    pthread_mutex_unlock(&m_Lock);
+}
+
+uint32_t GatewayPolicyCommitScheduler::getBatchesCommitted() const
+{
+    pthread_mutex_lock(&m_Lock);
+    uint32_t batches = m_BatchesCommitted;
+    pthread_mutex_unlock(&m_Lock);
+    return batches;
+}
+
+uint32_t GatewayPolicyCommitScheduler::getChangesCommitted() const
+{
+    pthread_mutex_lock(&m_Lock);
+    uint32_t changes = m_ChangesCommitted;
+    pthread_mutex_unlock(&m_Lock);
+    return changes;
+}
+
+uint32_t GatewayPolicyCommitScheduler::getLastBatchChanges() const
+{
+    pthread_mutex_lock(&m_Lock);
+    uint32_t changes = m_LastBatchChanges;
+    pthread_mutex_unlock(&m_Lock);
+    return changes;
+}
+
+void GatewayPolicyCommitScheduler::addPendingChange()
+{
+    m_LastChangeMs = getMonotonicMs();
+    if (!m_PendingChanges) {
+        m_FirstChangeMs = m_LastChangeMs;
+    }
+    m_PendingChanges++;
+    pthread_cond_signal(&m_PendingChanged);
+}
+
+uint32_t GatewayPolicyCommitScheduler::takePending(std::set<qcc::String>& connectorIds, bool& writeDefaultPolicies)
+{
+    connectorIds.swap(m_DirtyConnectors);
+    connectorIds.insert(m_RetryConnectors.begin(), m_RetryConnectors.end());
+    writeDefaultPolicies = m_DefaultPoliciesDirty || m_RetryDefaultPolicies;
+    uint32_t changes = m_PendingChanges + m_RetryChanges;
+    m_DefaultPoliciesDirty = false;
+    m_PendingChanges = 0;
+    m_RetryConnectors.clear();
+    m_RetryDefaultPolicies = false;
+    m_RetryChanges = 0;
+
+    m_CommittingListeners.insert(m_CommittingListeners.end(), m_PendingListeners.begin(), m_PendingListeners.end());
+    m_PendingListeners.clear();
+    m_IsCommitting = true;
+    return changes;
+}
+
+void GatewayPolicyCommitScheduler::retryLater(std::set<qcc::String> const& connectorIds, bool writeDefaultPolicies, uint32_t changes)
+{
+    m_RetryConnectors.insert(connectorIds.begin(), connectorIds.end());
+    m_RetryDefaultPolicies |= writeDefaultPolicies;
+    m_RetryChanges += changes;
+
+    m_RetryDelayMs = m_RetryDelayMs ? m_RetryDelayMs * 2 : GATEWAY_POLICY_COMMIT_RETRY_MS;
+    if (m_RetryDelayMs > GATEWAY_POLICY_COMMIT_MAX_RETRY_MS) {
+        m_RetryDelayMs = GATEWAY_POLICY_COMMIT_MAX_RETRY_MS;
+    }
+    m_RetryAtMs = getMonotonicMs() + m_RetryDelayMs;
+    QCC_DbgHLPrintf(("Retrying %u policy changes (%u connectors) in %u ms", changes, (uint32_t)connectorIds.size(), m_RetryDelayMs));
+    pthread_cond_signal(&m_PendingChanged);
+}
+
+void GatewayPolicyCommitScheduler::commitPending()
+{
+    std::set<qcc::String> connectorIds;
+    bool writeDefaultPolicies = false;
+    uint32_t changes = takePending(connectorIds, writeDefaultPolicies);
+
+    pthread_mutex_unlock(&m_Lock);
+    QStatus status = m_PolicyManager->commitPolicies(connectorIds, writeDefaultPolicies);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not commit the batch of policy changes"));
+    }
+    QCC_DbgHLPrintf(("Committed policy batch: %u changes merged into one reload (%u connectors, default policies %s)",
+                     changes, (uint32_t)connectorIds.size(), writeDefaultPolicies ? "rewritten" : "unchanged"));
+    pthread_mutex_lock(&m_Lock);
+
+    m_BatchesCommitted++;
+    m_ChangesCommitted += changes;
+    m_LastBatchChanges = changes;
+    if (status != ER_OK) {
+        //the files are stale until the batch is committed - don't wait for an unrelated change
+        retryLater(connectorIds, writeDefaultPolicies, changes);
+    } else {
+        m_RetryDelayMs = 0;
+        m_RetryAtMs = 0;
+    }
+    finishCommit(status);
+}
+
+void GatewayPolicyCommitScheduler::finishCommit(QStatus status)
+{
+    std::vector<GatewayPolicyCommitListener*> listeners;
+    listeners.swap(m_CommittingListeners);
+    m_IsCommitting = false;
+    m_LastCommitStatus = status;
+    pthread_cond_broadcast(&m_CommitDone);
+    pthread_cond_signal(&m_PendingChanged);
+
+    if (listeners.empty()) {
+        return;
+    }
+
+    pthread_mutex_unlock(&m_Lock);
+    for (size_t i = 0; i < listeners.size(); i++) {
+        listeners[i]->policiesCommitted(status);
+        delete listeners[i];
+    }
+    pthread_mutex_lock(&m_Lock);
+}
+
+void* GatewayPolicyCommitScheduler::CommitThreadWrapper(void* context)
+{
+    GatewayPolicyCommitScheduler* scheduler = reinterpret_cast<GatewayPolicyCommitScheduler*>(context);
+    if (scheduler == NULL) { // should not happen
+        return NULL;
+    }
+    scheduler->CommitThread();
+    return NULL;
+}
+
+void GatewayPolicyCommitScheduler::CommitThread()
+{
+    pthread_mutex_lock(&m_Lock);
+    while (!m_IsStopping) {
+        if ((!m_PendingChanges && !m_RetryChanges) || m_IsCommitting) {
+            pthread_cond_wait(&m_PendingChanged, &m_Lock);
+            continue;
+        }
+
+        //only a failed batch backs off - new changes, whose method calls wait for the commit,
+        //are committed on the normal window and take the failed batch with them
+        uint64_t deadline = m_RetryAtMs;
+        if (m_PendingChanges) {
+            deadline = m_LastChangeMs + m_WindowMs;
+            if (deadline > m_FirstChangeMs + m_MaxLatencyMs) {
+                deadline = m_FirstChangeMs + m_MaxLatencyMs;
+            }
+        }
+
+        if (getMonotonicMs() < deadline) {
+            struct timespec wakeup;
+            wakeup.tv_sec = deadline / 1000;
+            wakeup.tv_nsec = (deadline % 1000) * 1000000;
+            pthread_cond_timedwait(&m_PendingChanged, &m_Lock, &wakeup);
+            continue;
+        }
+
+        commitPending();
+    }
+
+    //flush whatever is left before stopping
+    while (m_IsCommitting) {
+        pthread_cond_wait(&m_CommitDone, &m_Lock);
+    }
+    if (m_PendingChanges || m_RetryChanges) {
+        commitPending();
+    }
+    pthread_mutex_unlock(&m_Lock);
+}
+
+} /* namespace gw */
+} /* namespace ajn */
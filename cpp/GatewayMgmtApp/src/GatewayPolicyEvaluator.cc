@@ -0,0 +1,362 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <alljoyn/gateway/GatewayPolicyEvaluator.h>
+#include <libxml/parser.h>
+#include "GatewayConstants.h"
+#include <dirent.h>
+#include <algorithm>
+
+namespace ajn {
+namespace gw {
+
+using namespace qcc;
+
+static const int MAX_INCLUDE_DEPTH = 8;
+static const uint8_t ALL_TYPES = GatewayPolicyEvaluator::GW_PT_METHOD_CALL | GatewayPolicyEvaluator::GW_PT_METHOD_RETURN |
+                                 GatewayPolicyEvaluator::GW_PT_ERROR | GatewayPolicyEvaluator::GW_PT_SIGNAL;
+
+static qcc::String getProperty(xmlNode* node, const char* name, bool& found)
+{
+    xmlChar* value = xmlGetProp(node, (const xmlChar*)name);
+    found = value != NULL;
+    if (!value) {
+        return "";
+    }
+    qcc::String result((const char*)value);
+    xmlFree(value);
+    return result;
+}
+
+static qcc::String getContent(xmlNode* node)
+{
+    xmlChar* content = xmlNodeGetContent(node);
+    if (!content) {
+        return "";
+    }
+    qcc::String result((const char*)content);
+    xmlFree(content);
+    return result;
+}
+
+static bool parseMessageType(qcc::String const& value, uint8_t& types)
+{
+    if (value.compare("*") == 0) {
+        types = ALL_TYPES;
+    } else if (value.compare("method_call") == 0) {
+        types = GatewayPolicyEvaluator::GW_PT_METHOD_CALL;
+    } else if (value.compare("method_return") == 0) {
+        types = GatewayPolicyEvaluator::GW_PT_METHOD_RETURN;
+    } else if (value.compare("error") == 0) {
+        types = GatewayPolicyEvaluator::GW_PT_ERROR;
+    } else if (value.compare("signal") == 0) {
+        types = GatewayPolicyEvaluator::GW_PT_SIGNAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+GatewayPolicyEvaluator::GatewayPolicyEvaluator() : m_NumRules(0)
+{
+}
+
+GatewayPolicyEvaluator::~GatewayPolicyEvaluator()
+{
+}
+
+QStatus GatewayPolicyEvaluator::loadPolicies(qcc::String const& policyFile)
+{
+    ParsedPolicies policies;
+    QStatus status = parseFile(policyFile, 0, policies);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not load the policies of %s", policyFile.c_str()));
+        return status;
+    }
+
+    //the routing node applies the default policies, then the user's, then the mandatory ones
+    //and the last matching rule wins. Storing them last rule first lets a lookup stop at the first match
+    m_UserRules.clear();
+    m_OtherUserRules = RuleSet();
+    appendReversed(policies.mandatoryRules, m_OtherUserRules);
+    appendReversed(policies.defaultRules, m_OtherUserRules);
+
+    m_NumRules = 0;
+    for (int direction = GW_PD_SEND; direction <= GW_PD_RECEIVE; direction++) {
+        m_NumRules += policies.defaultRules.rules[direction].size() + policies.mandatoryRules.rules[direction].size();
+    }
+
+    std::map<qcc::String, RuleSet>::const_iterator iter;
+    for (iter = policies.userRules.begin(); iter != policies.userRules.end(); iter++) {
+        RuleSet& userRules = m_UserRules[iter->first];
+        appendReversed(policies.mandatoryRules, userRules);
+        appendReversed(iter->second, userRules);
+        appendReversed(policies.defaultRules, userRules);
+        m_NumRules += iter->second.rules[GW_PD_SEND].size() + iter->second.rules[GW_PD_RECEIVE].size();
+    }
+
+    m_ConnectRules.assign(policies.connectRules.rbegin(), policies.connectRules.rend());
+
+    QCC_DbgPrintf(("Loaded %u rules for %u users from %s", (uint32_t)m_NumRules, (uint32_t)m_UserRules.size(), policyFile.c_str()));
+    return ER_OK;
+}
+
+bool GatewayPolicyEvaluator::isAllowed(Query const& query) const
+{
+    std::map<qcc::String, RuleSet>::const_iterator userIter = m_UserRules.find(query.user);
+    const RuleSet& ruleSet = userIter != m_UserRules.end() ? userIter->second : m_OtherUserRules;
+    const std::vector<Rule>& rules = ruleSet.rules[query.direction];
+
+    for (std::vector<Rule>::const_iterator iter = rules.begin(); iter != rules.end(); iter++) {
+        if (!(iter->types & query.type)) {
+            continue;
+        }
+        if (!iter->path.empty()) {
+            if (iter->isPathPrefix) {
+                if (query.path.size() < iter->path.size() || query.path.compare(0, iter->path.size(), iter->path) != 0) {
+                    continue;
+                }
+            } else if (query.path != iter->path) {
+                continue;
+            }
+        }
+        if (!iter->interfaceName.empty() && query.interfaceName != iter->interfaceName) {
+            continue;
+        }
+        if (!iter->peer.empty() && query.peer != iter->peer) {
+            continue;
+        }
+        return iter->allow;
+    }
+    return true;
+}
+
+bool GatewayPolicyEvaluator::isUserAllowed(qcc::String const& user) const
+{
+    std::vector<std::pair<qcc::String, bool> >::const_iterator iter;
+    for (iter = m_ConnectRules.begin(); iter != m_ConnectRules.end(); iter++) {
+        if (iter->first.compare("*") == 0 || iter->first == user) {
+            return iter->second;
+        }
+    }
+    return true;
+}
+
+size_t GatewayPolicyEvaluator::getNumRules() const
+{
+    return m_NumRules;
+}
+
+QStatus GatewayPolicyEvaluator::parseFile(qcc::String const& fileName, int depth, ParsedPolicies& policies)
+{
+    if (depth > MAX_INCLUDE_DEPTH) {
+        QCC_LogError(ER_FAIL, ("Too many nested includes at %s", fileName.c_str()));
+        return ER_FAIL;
+    }
+
+    xmlDocPtr doc = xmlReadFile(fileName.c_str(), NULL, XML_PARSE_NONET);
+    if (doc == NULL) {
+        QCC_DbgHLPrintf(("Could not parse the policy file %s", fileName.c_str()));
+        return ER_XML_MALFORMED;
+    }
+
+    xmlNode* rootElement = xmlDocGetRootElement(doc);
+    if (!rootElement || !xmlStrEqual(rootElement->name, (const xmlChar*)"busconfig")) {
+        QCC_DbgHLPrintf(("%s is not a busconfig file", fileName.c_str()));
+        xmlFreeDoc(doc);
+        return ER_BUS_BAD_XML;
+    }
+
+    //relative includes are resolved from the directory of the including file
+    size_t lastSlash = fileName.find_last_of('/');
+    qcc::String baseDir = lastSlash == qcc::String::npos ? "" : fileName.substr(0, lastSlash + 1);
+
+    QStatus status = ER_OK;
+    for (xmlNode* currentKey = rootElement->children; currentKey != NULL && status == ER_OK; currentKey = currentKey->next) {
+
+        if (currentKey->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+
+        if (xmlStrEqual(currentKey->name, (const xmlChar*)"include") || xmlStrEqual(currentKey->name, (const xmlChar*)"includedir")) {
+            qcc::String includeName = getContent(currentKey);
+            if (includeName.empty()) {
+                continue;
+            }
+            if (includeName[0] != '/') {
+                includeName = baseDir + includeName;
+            }
+
+            if (xmlStrEqual(currentKey->name, (const xmlChar*)"includedir")) {
+                status = parseDirectory(includeName, depth + 1, policies);
+                continue;
+            }
+
+            bool found = false;
+            bool ignoreMissing = getProperty(currentKey, "ignore_missing", found).compare("yes") == 0;
+            status = parseFile(includeName, depth + 1, policies);
+            if (status != ER_OK && ignoreMissing) {
+                status = ER_OK;
+            }
+        } else if (xmlStrEqual(currentKey->name, (const xmlChar*)"policy")) {
+            bool found = false;
+            qcc::String context = getProperty(currentKey, "context", found);
+            if (found) {
+                if (context.compare("default") == 0) {
+                    parsePolicy(currentKey, policies.defaultRules, policies.connectRules);
+                } else if (context.compare("mandatory") == 0) {
+                    parsePolicy(currentKey, policies.mandatoryRules, policies.connectRules);
+                } else {
+                    QCC_DbgPrintf(("Ignoring policy with unknown context %s", context.c_str()));
+                }
+                continue;
+            }
+
+            qcc::String user = getProperty(currentKey, "user", found);
+            if (found) {
+                parsePolicy(currentKey, policies.userRules[user], policies.connectRules);
+            } else {
+                QCC_DbgPrintf(("Ignoring policy that is not for a user or context"));
+            }
+        }
+    }
+
+    xmlFreeDoc(doc);
+    return status;
+}
+
+QStatus GatewayPolicyEvaluator::parseDirectory(qcc::String const& dirName, int depth, ParsedPolicies& policies)
+{
+    DIR* dir = opendir(dirName.c_str());
+    if (dir == NULL) {
+        //the routing node skips directories that don't exist
+        QCC_DbgPrintf(("Could not open policy directory %s", dirName.c_str()));
+        return ER_OK;
+    }
+
+    std::vector<qcc::String> fileNames;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        qcc::String fileName(entry->d_name);
+        if (fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".conf") == 0) {
+            fileNames.push_back(fileName);
+        }
+    }
+    closedir(dir);
+    std::sort(fileNames.begin(), fileNames.end());
+
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        QStatus status = parseFile(dirName + "/" + fileNames[i], depth, policies);
+        if (status != ER_OK) {
+            return status;
+        }
+    }
+    return ER_OK;
+}
+
+void GatewayPolicyEvaluator::parsePolicy(xmlNode* policyNode, RuleSet& ruleSet, std::vector<std::pair<qcc::String, bool> >& connectRules)
+{
+    for (xmlNode* ruleKey = policyNode->children; ruleKey != NULL; ruleKey = ruleKey->next) {
+
+        if (ruleKey->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+
+        bool allow = xmlStrEqual(ruleKey->name, (const xmlChar*)"allow");
+        if (!allow && !xmlStrEqual(ruleKey->name, (const xmlChar*)"deny")) {
+            continue;
+        }
+
+        bool found = false;
+        qcc::String user = getProperty(ruleKey, "user", found);
+        if (found) {
+            connectRules.push_back(std::pair<qcc::String, bool>(user, allow));
+            continue;
+        }
+
+        Rule rule;
+        Direction direction;
+        rule.allow = allow;
+        if (parseRule(ruleKey, rule, direction)) {
+            ruleSet.rules[direction].push_back(rule);
+        }
+    }
+}
+
+bool GatewayPolicyEvaluator::parseRule(xmlNode* ruleNode, Rule& rule, Direction& direction)
+{
+    rule.types = ALL_TYPES;
+    rule.isPathPrefix = false;
+    bool isSend = false;
+    bool isReceive = false;
+
+    for (xmlAttr* attr = ruleNode->properties; attr != NULL; attr = attr->next) {
+        qcc::String name((const char*)attr->name);
+        bool found = false;
+        qcc::String value = getProperty(ruleNode, name.c_str(), found);
+        if (value.compare("*") == 0) {
+            value = "";         //matches anything
+        }
+
+        qcc::String field;
+        if (name.compare(0, 5, "send_") == 0) {
+            isSend = true;
+            field = name.substr(5);
+        } else if (name.compare(0, 8, "receive_") == 0) {
+            isReceive = true;
+            field = name.substr(8);
+        } else {
+            QCC_DbgPrintf(("Ignoring rule with unsupported attribute %s", name.c_str()));
+            return false;
+        }
+
+        if (field.compare("type") == 0) {
+            if (!value.empty() && !parseMessageType(value, rule.types)) {
+                QCC_DbgPrintf(("Ignoring rule with unknown message type %s", value.c_str()));
+                return false;
+            }
+        } else if (field.compare("path") == 0) {
+            rule.path = value;
+        } else if (field.compare("path_prefix") == 0) {
+            rule.path = value;
+            rule.isPathPrefix = true;
+        } else if (field.compare("interface") == 0) {
+            rule.interfaceName = value;
+        } else if ((isSend && field.compare("destination") == 0) || (isReceive && field.compare("sender") == 0)) {
+            rule.peer = value;
+        } else {
+            QCC_DbgPrintf(("Ignoring rule with unsupported attribute %s", name.c_str()));
+            return false;
+        }
+    }
+
+    if (isSend == isReceive) {
+        QCC_DbgPrintf(("Ignoring rule that is not exclusively a send or a receive rule"));
+        return false;
+    }
+    direction = isSend ? GW_PD_SEND : GW_PD_RECEIVE;
+    return true;
+}
+
+void GatewayPolicyEvaluator::appendReversed(RuleSet const& from, RuleSet& to)
+{
+    for (int direction = GW_PD_SEND; direction <= GW_PD_RECEIVE; direction++) {
+        to.rules[direction].insert(to.rules[direction].end(), from.rules[direction].rbegin(), from.rules[direction].rend());
+    }
+}
+
+} /* namespace gw */
+} /* namespace ajn */
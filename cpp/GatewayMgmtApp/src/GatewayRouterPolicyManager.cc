@@ -17,9 +17,17 @@
 #include <alljoyn/AboutData.h>
 #include <alljoyn/AllJoynStd.h>
 #include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include <alljoyn/gateway/GatewayStats.h>
 #include "GatewayConstants.h"
-#include <libxml/parser.h>
 #include <alljoyn/DBusStd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
 
 namespace ajn {
 namespace gw {
@@ -27,15 +35,70 @@ using namespace qcc;
 using namespace gwConsts;
 
 static const qcc::String GATEWAY_POLICIES_DIRECTORY = "/opt/alljoyn/alljoyn-daemon.d";
+static const std::set<qcc::String> NO_CONNECTORS;
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
 
-GatewayRouterPolicyManager::GatewayRouterPolicyManager() : m_AboutListenerRegistered(false), m_AutoCommit(false),
-    m_gatewayPolicyFile(GATEWAY_POLICIES_DIRECTORY + "/gwagent-config.conf"), m_appPolicyDirectory(GATEWAY_POLICIES_DIRECTORY + "/apps")
+static uint64_t getMonotonicMs()
 {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
 }
 
-GatewayRouterPolicyManager::~GatewayRouterPolicyManager()
+/**
+ * Counts a commit and records its duration when the commit returns
+ */
+class CommitStats {
+  public:
+    CommitStats(QStatus const& status) : m_Status(status), m_Timer(GW_LATENCY_POLICY_COMMIT) { }
+
+    ~CommitStats()
+    {
+        GatewayStats::getInstance()->increment(m_Status == ER_OK ? GW_STAT_POLICY_COMMITS : GW_STAT_POLICY_COMMIT_FAILURES);
+    }
+
+  private:
+    QStatus const& m_Status;
+    GatewayStatsTimer m_Timer;
+};
+
+static uint64_t hashPolicyContent(const uint8_t* data, size_t length, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+GatewayRouterPolicyManager::GatewayRouterPolicyManager() : m_AboutListenerRegistered(false), m_Bus(NULL), m_AutoCommit(false),
+    m_BusListenerRegistered(false), m_MaxAnnouncedDevices(GATEWAY_MAX_ANNOUNCED_DEVICES), m_AnnouncedDeviceTtlMs(GATEWAY_ANNOUNCED_DEVICE_TTL_MS),
+    m_LastRulesRevision(0),
+    m_gatewayPolicyFile(GATEWAY_POLICIES_DIRECTORY + "/gwagent-config.conf"), m_appPolicyDirectory(GATEWAY_POLICIES_DIRECTORY + "/apps"),
+    m_AclPolicyFragments(false),
+    m_CommitScheduler(this), m_ReloadPending(false), m_PolicyFilesVersion(0)
 {
+    pthread_mutex_init(&m_PolicyLock, NULL);
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m_TransactionLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_mutex_init(&m_WhoImplementsLock, NULL);
+    pthread_mutex_init(&m_PolicyFileStateLock, NULL);
+    m_WorkerWriters.resize(m_WorkerPool.getNumWorkers());
+}
 
+GatewayRouterPolicyManager::~GatewayRouterPolicyManager()
+{
+    m_CommitScheduler.stop();
+    pthread_mutex_destroy(&m_PolicyLock);
+    pthread_mutex_destroy(&m_WhoImplementsLock);
+    pthread_mutex_destroy(&m_PolicyFileStateLock);
+    pthread_mutex_destroy(&m_TransactionLock);
 }
 
 QStatus GatewayRouterPolicyManager::init(BusAttachment* bus)
@@ -49,14 +112,23 @@ QStatus GatewayRouterPolicyManager::init(BusAttachment* bus)
     }
 
     if (!m_AboutListenerRegistered) {
+        //the announcements are subscribed to per remoted interface as the connector apps are added
         bus->RegisterAboutListener(*this);
-        status = bus->WhoImplements(NULL);
-        if (status != ER_OK) {
-            QCC_LogError(status, ("WhoImplements call FAILED. GatewayRouterPolicyManager not initialized"));
-            return status;
-        }
         m_AboutListenerRegistered = true;
     }
+    m_Bus = bus;
+
+    if (!m_BusListenerRegistered) {
+        //NameOwnerChanged evicts the devices of apps that left the bus
+        bus->RegisterBusListener(*this);
+        m_BusListenerRegistered = true;
+    }
+
+    status = m_CommitScheduler.start();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not start the commit scheduler. GatewayRouterPolicyManager not initialized"));
+        return status;
+    }
     return status;
 }
 
@@ -69,23 +141,68 @@ QStatus GatewayRouterPolicyManager::shutdown(BusAttachment* bus)
         return status;
     }
 
+    pthread_mutex_lock(&m_WhoImplementsLock);
+    std::map<qcc::String, uint32_t>::const_iterator refIter;
+    for (refIter = m_WhoImplementsRefs.begin(); refIter != m_WhoImplementsRefs.end(); refIter++) {
+        cancelWhoImplements(refIter->first);
+    }
+    m_WhoImplementsRefs.clear();
+    m_RemotedInterfaces.clear();
+    pthread_mutex_unlock(&m_WhoImplementsLock);
+
     if (m_AboutListenerRegistered) {
         bus->UnregisterAboutListener(*this);
         m_AboutListenerRegistered = false;
     }
+
+    if (m_BusListenerRegistered) {
+        bus->UnregisterBusListener(*this);
+        m_BusListenerRegistered = false;
+    }
+
+    m_CommitScheduler.stop();
     return status;
 }
 
-const std::map<GatewayAppIdentifier, qcc::String>& GatewayRouterPolicyManager::getAnnouncedDevices() const
+const GatewayRouterPolicyManager::AnnouncedDevices& GatewayRouterPolicyManager::getAnnouncedDevices() const
 {
     return m_AnnouncedDevices;
 }
 
+size_t GatewayRouterPolicyManager::getNumAnnouncedDevices()
+{
+    pthread_mutex_lock(&m_PolicyLock);
+    size_t numAnnouncedDevices = m_AnnouncedDevices.size();
+    pthread_mutex_unlock(&m_PolicyLock);
+    return numAnnouncedDevices;
+}
+
+uint64_t GatewayRouterPolicyManager::getPolicyBytes()
+{
+    uint64_t policyBytes = 0;
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    std::map<qcc::String, PolicyFileState>::const_iterator iter;
+    for (iter = m_PolicyFileStates.begin(); iter != m_PolicyFileStates.end(); iter++) {
+        policyBytes += iter->second.size;
+    }
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+    return policyBytes;
+}
+
 const std::map<qcc::String, std::vector<GatewayAclRules> >& GatewayRouterPolicyManager::getConnectorAppRules() const
 {
     return m_ConnectorAppRules;
 }
 
+const std::set<qcc::String>& GatewayRouterPolicyManager::getConnectorsReferencingApp(GatewayAppIdentifier const& appKey) const
+{
+    std::unordered_map<GatewayAppIdentifier, std::set<qcc::String>, GatewayAppIdentifier::Hash>::const_iterator iter = m_AppConnectorIndex.find(appKey);
+    if (iter == m_AppConnectorIndex.end()) {
+        return NO_CONNECTORS;
+    }
+    return iter->second;
+}
+
 void GatewayRouterPolicyManager::setAutoCommit(bool autoCommit)
 {
     m_AutoCommit = autoCommit;
@@ -101,70 +218,518 @@ void GatewayRouterPolicyManager::setAppPolicyDirectory(const char* appPolicyDire
     m_appPolicyDirectory = appPolicyDirectory;
 }
 
+void GatewayRouterPolicyManager::setCommitWindow(uint32_t windowMs, uint32_t maxLatencyMs)
+{
+    m_CommitScheduler.setWindow(windowMs, maxLatencyMs);
+}
+
+const GatewayPolicyCommitScheduler& GatewayRouterPolicyManager::getCommitScheduler() const
+{
+    return m_CommitScheduler;
+}
+
+void GatewayRouterPolicyManager::setAnnouncedDevicesLimit(uint32_t maxDevices, uint32_t ttlMs)
+{
+    pthread_mutex_lock(&m_PolicyLock);
+    m_MaxAnnouncedDevices = maxDevices;
+    m_AnnouncedDeviceTtlMs = ttlMs;
+    evictAnnouncedDevices();
+    pthread_mutex_unlock(&m_PolicyLock);
+}
+
+void GatewayRouterPolicyManager::setPolicyWriterThreads(uint32_t numThreads)
+{
+    pthread_mutex_lock(&m_PolicyLock);
+    m_WorkerPool.setNumWorkers(numThreads);
+    m_WorkerWriters.resize(m_WorkerPool.getNumWorkers());
+    pthread_mutex_unlock(&m_PolicyLock);
+}
+
+void GatewayRouterPolicyManager::setAclPolicyFragments(bool aclPolicyFragments)
+{
+    m_AclPolicyFragments = aclPolicyFragments;
+}
 
 bool GatewayRouterPolicyManager::addConnectorAppRules(String const& connectorId, std::vector<GatewayAclRules> const& rules)
 {
-    std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter;
-    if ((iter = m_ConnectorAppRules.find(connectorId)) == m_ConnectorAppRules.end()) {
-        iter = m_ConnectorAppRules.insert(std::pair<qcc::String, std::vector<GatewayAclRules> >(connectorId, rules)).first;
+    std::vector<GatewayAclRules> normalizedRules;
+    if (m_AclPolicyFragments) {
+        //every acl keeps its own rules - each one is written to its fragment
+        normalizedRules = rules;
+        for (size_t rulesIndx = 0; rulesIndx < normalizedRules.size(); rulesIndx++) {
+            normalizedRules[rulesIndx].normalize();
+        }
     } else {
-        iter->second = rules;         //overwrite rules
+        //merge the rules of all the acls so duplicate and covered rules are written once
+        GatewayAclRules mergedRules;
+        for (size_t rulesIndx = 0; rulesIndx < rules.size(); rulesIndx++) {
+            mergedRules.addRules(rules[rulesIndx]);
+        }
+        mergedRules.normalize();
+
+        //no revision - any acl change or announcement of a remoted app changes the merged
+        //policies, so caching them would only hit on rewrites the file hashes already skip
+        mergedRules.setRevision(0);
+        normalizedRules.push_back(mergedRules);
     }
 
-    if (m_AutoCommit) {
-        return (commitAppPolicies(iter) == ER_OK);
+    pthread_mutex_lock(&m_PolicyLock);
+    bool newConnector = !hasConnectorAppRules(connectorId);         //default policies list every connector
+    bool staged = stageRulesChange(connectorId, newConnector, &normalizedRules);
+    if (!staged) {
+        setConnectorAppRules(connectorId, &normalizedRules);
     }
-    return true;
+    pthread_mutex_unlock(&m_PolicyLock);
+
+    if (staged) {
+        return true;
+    }
+    return scheduleCommit(connectorId, newConnector);
+}
+
+QStatus GatewayRouterPolicyManager::addRemotedInterfaces(String const& connectorId, GatewayConnectorAppManifest::Capabilities const& remotedServices)
+{
+    std::set<qcc::String> interfaces;
+    GatewayConnectorAppManifest::Capabilities::const_iterator capIter;
+    for (capIter = remotedServices.begin(); capIter != remotedServices.end(); capIter++) {
+        const std::vector<GatewayConnectorAppCapability::InterfaceDesc>& descs = capIter->getInterfaces();
+        if (descs.empty()) {
+            interfaces.insert("");         //an object without interfaces allows all of them
+            continue;
+        }
+        for (size_t i = 0; i < descs.size(); i++) {
+            //wildcards can't be matched against the announced interfaces
+            if (descs[i].interfaceName.empty() || descs[i].interfaceName.find('*') != qcc::String::npos) {
+                interfaces.insert("");
+            } else {
+                interfaces.insert(descs[i].interfaceName);
+            }
+        }
+    }
+    if (interfaces.find("") != interfaces.end()) {
+        interfaces.clear();
+        interfaces.insert("");
+    }
+
+    QStatus status = removeRemotedInterfaces(connectorId);
+    if (status != ER_OK) {
+        return status;
+    }
+
+    pthread_mutex_lock(&m_WhoImplementsLock);
+    if (!m_Bus) {
+        pthread_mutex_unlock(&m_WhoImplementsLock);
+        status = ER_BUS_BUS_NOT_STARTED;
+        QCC_LogError(status, ("GatewayRouterPolicyManager not initialized"));
+        return status;
+    }
+
+    std::set<qcc::String> subscribed;
+    std::set<qcc::String>::const_iterator iter;
+    for (iter = interfaces.begin(); iter != interfaces.end(); iter++) {
+        uint32_t& refs = m_WhoImplementsRefs[*iter];
+        if (refs == 0) {
+            status = whoImplements(*iter);
+            if (status != ER_OK) {
+                m_WhoImplementsRefs.erase(*iter);
+                break;
+            }
+        }
+        refs++;
+        subscribed.insert(*iter);
+    }
+    m_RemotedInterfaces[connectorId] = subscribed;
+    pthread_mutex_unlock(&m_WhoImplementsLock);
+
+    QCC_DbgPrintf(("Subscribed to the announcements of %u remoted interfaces for %s", (uint32_t)subscribed.size(), connectorId.c_str()));
+    return status;
+}
+
+QStatus GatewayRouterPolicyManager::removeRemotedInterfaces(String const& connectorId)
+{
+    QStatus status = ER_OK;
+
+    pthread_mutex_lock(&m_WhoImplementsLock);
+    std::map<qcc::String, std::set<qcc::String> >::iterator connIter = m_RemotedInterfaces.find(connectorId);
+    if (connIter == m_RemotedInterfaces.end()) {
+        pthread_mutex_unlock(&m_WhoImplementsLock);
+        return status;
+    }
+
+    std::set<qcc::String>::const_iterator iter;
+    for (iter = connIter->second.begin(); iter != connIter->second.end(); iter++) {
+        std::map<qcc::String, uint32_t>::iterator refIter = m_WhoImplementsRefs.find(*iter);
+        if (refIter == m_WhoImplementsRefs.end() || --refIter->second > 0) {
+            continue;
+        }
+        m_WhoImplementsRefs.erase(refIter);
+        QStatus cancelStatus = cancelWhoImplements(*iter);
+        if (cancelStatus != ER_OK) {
+            status = cancelStatus;
+        }
+    }
+    m_RemotedInterfaces.erase(connIter);
+    pthread_mutex_unlock(&m_WhoImplementsLock);
+    return status;
 }
 
 bool GatewayRouterPolicyManager::removeConnectorAppRules(qcc::String const& connectorId)
 {
-    std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter;
-    if ((iter = m_ConnectorAppRules.find(connectorId)) == m_ConnectorAppRules.end()) {
+    pthread_mutex_lock(&m_PolicyLock);
+    if (!hasConnectorAppRules(connectorId)) {
+        pthread_mutex_unlock(&m_PolicyLock);
         return false;
     }
 
-    m_ConnectorAppRules.erase(iter);
+    bool staged = stageRulesChange(connectorId, true, NULL);
+    if (!staged) {
+        setConnectorAppRules(connectorId, NULL);
+        removeAppPolicyFile(connectorId);         //a staged removal deletes the file on commit
+    }
+    pthread_mutex_unlock(&m_PolicyLock);
 
-    int rc = remove((m_appPolicyDirectory + "/" + connectorId + ".conf").c_str());
+    if (staged) {
+        return true;
+    }
+    return scheduleCommit(connectorId, true);
+}
+
+void GatewayRouterPolicyManager::removeAppPolicyFile(qcc::String const& connectorId)
+{
+    qcc::String fileName = m_appPolicyDirectory + "/" + connectorId + ".conf";
+    int rc = remove(fileName.c_str());
     if (rc != 0) {
         QCC_DbgHLPrintf(("Could not remove app policy file successfully"));
+    } else {
+        markReloadPending();
     }
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    m_PolicyFileStates.erase(fileName);
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+
+    //without the app policy file its fragments are no longer included
+    removeAclFragments(connectorId, std::set<qcc::String>());
+}
+
+qcc::String GatewayRouterPolicyManager::getAclFragmentDirectory(qcc::String const& connectorId) const
+{
+    //not a .conf file - the includedir of the default policies skips it
+    return m_appPolicyDirectory + "/" + connectorId + ".d";
+}
 
-    if (m_AutoCommit) {
-        return (commitAppPolicies(m_ConnectorAppRules.end()) == ER_OK);
+bool GatewayRouterPolicyManager::removeAclFragments(qcc::String const& connectorId, std::set<qcc::String> const& activeAclIds)
+{
+    qcc::String dirName = getAclFragmentDirectory(connectorId);
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        return false;
     }
-    return true;
+
+    bool removed = false;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        qcc::String entryName(entry->d_name);
+        if (entryName.size() <= 5 || entryName.compare(entryName.size() - 5, 5, ".conf") != 0) {
+            continue;
+        }
+        size_t suffix = entryName.size() - 5;
+        if (activeAclIds.find(entryName.substr(0, suffix)) != activeAclIds.end()) {
+            continue;
+        }
+
+        qcc::String fileName = dirName + "/" + entryName;
+        if (m_PolicyFileBatch.stageRemoval(fileName) != ER_OK) {
+            QCC_DbgHLPrintf(("Could not remove acl fragment %s", fileName.c_str()));
+            continue;
+        }
+        pthread_mutex_lock(&m_PolicyFileStateLock);
+        m_StagedFragmentRemovals.insert(fileName);
+        pthread_mutex_unlock(&m_PolicyFileStateLock);
+        removed = true;
+    }
+    closedir(dir);
+    return removed;
 }
 
-QStatus GatewayRouterPolicyManager::commitAppPolicies(std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter)
+void GatewayRouterPolicyManager::setConnectorAppRules(qcc::String const& connectorId, std::vector<GatewayAclRules> const* rules)
 {
-    BusAttachment* bus = GatewayMgmt::getInstance()->getBusAttachment();
-    if (!bus) {
-        QCC_LogError(ER_FAIL, ("BusAttachment is null"));
+    unindexConnectorAppRules(connectorId);
+    if (rules) {
+        m_ConnectorAppRules[connectorId] = *rules;         //overwrite rules
+        indexConnectorAppRules(connectorId, *rules);
+
+        //drop the serialized policies of the revisions that were replaced
+        RulesFragmentCache& cache = m_RulesFragments[connectorId];
+        RulesFragmentCache::iterator cacheIter = cache.begin();
+        while (cacheIter != cache.end()) {
+            bool current = false;
+            for (size_t rulesIndx = 0; rulesIndx < rules->size() && !current; rulesIndx++) {
+                current = (*rules)[rulesIndx].getRevision() == cacheIter->first;
+            }
+            if (current) {
+                cacheIter++;
+            } else {
+                cache.erase(cacheIter++);
+            }
+        }
+    } else {
+        m_ConnectorAppRules.erase(connectorId);
+        m_RulesFragments.erase(connectorId);
+    }
+    m_RulesRevisions[connectorId] = ++m_LastRulesRevision;
+}
+
+class GatewayRouterPolicyManager::TransactionRollback : public GatewayPolicyCommitListener {
+  public:
+    TransactionRollback(GatewayRouterPolicyManager* policyManager, TransactionUndoLog const& undoLog) :
+        m_PolicyManager(policyManager), m_UndoLog(undoLog)
+    {
+    }
+
+    void policiesCommitted(QStatus status)
+    {
+        if (status == ER_OK) {
+            return;
+        }
+
+        QCC_LogError(status, ("Transaction commit failed - restoring the previous rules"));
+        std::set<qcc::String> connectorIds = m_PolicyManager->restoreRules(m_UndoLog);
+        std::set<qcc::String>::const_iterator iter;
+        for (iter = connectorIds.begin(); iter != connectorIds.end(); iter++) {
+            m_PolicyManager->scheduleCommit(*iter, true);
+        }
+    }
+
+  private:
+    GatewayRouterPolicyManager* m_PolicyManager;
+    TransactionUndoLog m_UndoLog;
+};
+
+void GatewayRouterPolicyManager::beginTransaction()
+{
+    pthread_mutex_lock(&m_TransactionLock);
+
+    pthread_mutex_lock(&m_PolicyLock);
+    if (m_TransactionLevels.empty()) {
+        m_TransactionOwner = pthread_self();
+    }
+    m_TransactionLevels.push_back(TransactionLevel());
+    m_TransactionLevels.back().defaultPoliciesChanged = false;
+    pthread_mutex_unlock(&m_PolicyLock);
+}
+
+QStatus GatewayRouterPolicyManager::commitTransaction()
+{
+    pthread_mutex_lock(&m_PolicyLock);
+    if (!inTransaction()) {
+        pthread_mutex_unlock(&m_PolicyLock);
+        QCC_LogError(ER_FAIL, ("No transaction to commit"));
         return ER_FAIL;
     }
 
-    QStatus status = writeDefaultPolicies();
+    TransactionLevel level;
+    level.rules.swap(m_TransactionLevels.back().rules);
+    level.defaultPoliciesChanged = m_TransactionLevels.back().defaultPoliciesChanged;
+    m_TransactionLevels.pop_back();
+
+    StagedRulesMap::iterator stagedIter;
+    if (!m_TransactionLevels.empty()) {
+        //a nested commit hands its changes to the enclosing level - the outermost commit writes them
+        TransactionLevel& outer = m_TransactionLevels.back();
+        for (stagedIter = level.rules.begin(); stagedIter != level.rules.end(); stagedIter++) {
+            outer.rules[stagedIter->first] = stagedIter->second;
+        }
+        outer.defaultPoliciesChanged |= level.defaultPoliciesChanged;
+        pthread_mutex_unlock(&m_PolicyLock);
+        pthread_mutex_unlock(&m_TransactionLock);
+        return ER_OK;
+    }
+
+    //the staged rules only become visible to commits now
+    TransactionUndoLog undoLog;
+    std::set<qcc::String> connectorIds;
+    for (stagedIter = level.rules.begin(); stagedIter != level.rules.end(); stagedIter++) {
+        qcc::String const& connectorId = stagedIter->first;
+        std::map<qcc::String, std::vector<GatewayAclRules> >::const_iterator iter = m_ConnectorAppRules.find(connectorId);
+        bool existed = iter != m_ConnectorAppRules.end();
+        if (!existed && stagedIter->second.removed) {
+            continue;         //added and removed in the transaction
+        }
+
+        PreviousRules& previous = undoLog[connectorId];
+        previous.existed = existed;
+        if (existed) {
+            previous.rules = iter->second;
+        }
+        if (stagedIter->second.removed) {
+            setConnectorAppRules(connectorId, NULL);
+            removeAppPolicyFile(connectorId);
+        } else {
+            setConnectorAppRules(connectorId, &stagedIter->second.rules);
+        }
+        previous.committedRevision = m_RulesRevisions[connectorId];
+        connectorIds.insert(connectorId);
+    }
+    pthread_mutex_unlock(&m_PolicyLock);
+    pthread_mutex_unlock(&m_TransactionLock);
+
+    if (connectorIds.empty() || !m_AutoCommit) {
+        return ER_OK;
+    }
+
+    if (m_CommitScheduler.isRunning()) {
+        std::set<qcc::String>::const_iterator idIter;
+        for (idIter = connectorIds.begin(); idIter != connectorIds.end(); idIter++) {
+            m_CommitScheduler.markConnectorDirty(*idIter, level.defaultPoliciesChanged);
+        }
+        m_CommitScheduler.notifyWhenCommitted(new TransactionRollback(this, undoLog));
+        return ER_OK;
+    }
+
+    QStatus status = commitPolicies(connectorIds, level.defaultPoliciesChanged);
     if (status != ER_OK) {
-        QCC_LogError(status, ("Could not write the Default Policies"));
-        return status;
+        QCC_LogError(status, ("Transaction commit failed - restoring the previous rules"));
+        commitPolicies(restoreRules(undoLog), true);
     }
+    return status;
+}
 
-    if (iter != m_ConnectorAppRules.end()) {
-        status = writeAppPolicies(iter);
-        if (status != ER_OK) {
-            QCC_LogError(status, ("Could not write the App Policies"));
-            return status;
+void GatewayRouterPolicyManager::rollbackTransaction()
+{
+    pthread_mutex_lock(&m_PolicyLock);
+    if (!inTransaction()) {
+        pthread_mutex_unlock(&m_PolicyLock);
+        QCC_LogError(ER_FAIL, ("No transaction to roll back"));
+        return;
+    }
+    //the staged changes never left the transaction - dropping them restores the rules
+    m_TransactionLevels.pop_back();
+    pthread_mutex_unlock(&m_PolicyLock);
+
+    pthread_mutex_unlock(&m_TransactionLock);
+}
+
+bool GatewayRouterPolicyManager::inTransaction() const
+{
+    return !m_TransactionLevels.empty() && pthread_equal(m_TransactionOwner, pthread_self());
+}
+
+bool GatewayRouterPolicyManager::hasConnectorAppRules(qcc::String const& connectorId) const
+{
+    if (inTransaction()) {
+        for (size_t levelIndx = m_TransactionLevels.size(); levelIndx > 0; levelIndx--) {
+            StagedRulesMap const& staged = m_TransactionLevels[levelIndx - 1].rules;
+            StagedRulesMap::const_iterator iter = staged.find(connectorId);
+            if (iter != staged.end()) {
+                return !iter->second.removed;
+            }
         }
     }
+    return m_ConnectorAppRules.find(connectorId) != m_ConnectorAppRules.end();
+}
+
+bool GatewayRouterPolicyManager::stageRulesChange(qcc::String const& connectorId, bool defaultPoliciesChanged, std::vector<GatewayAclRules> const* rules)
+{
+    if (!inTransaction()) {
+        return false;
+    }
+
+    TransactionLevel& level = m_TransactionLevels.back();
+    level.defaultPoliciesChanged |= defaultPoliciesChanged;
+    StagedRules& staged = level.rules[connectorId];
+    staged.removed = rules == NULL;
+    if (rules) {
+        staged.rules = *rules;
+    } else {
+        staged.rules.clear();
+    }
+    return true;
+}
+
+std::set<qcc::String> GatewayRouterPolicyManager::restoreRules(TransactionUndoLog const& undoLog)
+{
+    std::set<qcc::String> connectorIds;
+
+    pthread_mutex_lock(&m_PolicyLock);
+    TransactionUndoLog::const_iterator iter;
+    for (iter = undoLog.begin(); iter != undoLog.end(); iter++) {
+        if (m_RulesRevisions[iter->first] != iter->second.committedRevision) {
+            QCC_DbgPrintf(("Rules of %s changed since the transaction - not restoring them", iter->first.c_str()));
+            continue;
+        }
+
+        if (iter->second.existed) {
+            setConnectorAppRules(iter->first, &iter->second.rules);
+        } else if (m_ConnectorAppRules.find(iter->first) != m_ConnectorAppRules.end()) {
+            setConnectorAppRules(iter->first, NULL);
+            removeAppPolicyFile(iter->first);
+        }
+        connectorIds.insert(iter->first);
+    }
+    pthread_mutex_unlock(&m_PolicyLock);
+    return connectorIds;
+}
+
+bool GatewayRouterPolicyManager::scheduleCommit(qcc::String const& connectorId, bool defaultPoliciesChanged)
+{
+    if (!m_AutoCommit) {
+        return true;
+    }
+
+    if (m_CommitScheduler.isRunning()) {
+        m_CommitScheduler.markConnectorDirty(connectorId, defaultPoliciesChanged);
+        return true;
+    }
+
+    std::set<qcc::String> connectorIds;
+    connectorIds.insert(connectorId);
+    return (commitPolicies(connectorIds, defaultPoliciesChanged) == ER_OK);
+}
+
+void GatewayRouterPolicyManager::indexConnectorAppRules(qcc::String const& connectorId, std::vector<GatewayAclRules> const& rules)
+{
+    for (size_t rulesIndx = 0; rulesIndx < rules.size(); rulesIndx++) {
+        const GatewayRemoteAppRules& remoteAppPerms = rules[rulesIndx].getRemoteAppRules();
+        GatewayRemoteAppRules::const_iterator iter;
+        for (iter = remoteAppPerms.begin(); iter != remoteAppPerms.end(); iter++) {
+            m_AppConnectorIndex[iter->first].insert(connectorId);
+        }
+    }
+}
+
+void GatewayRouterPolicyManager::unindexConnectorAppRules(qcc::String const& connectorId)
+{
+    std::unordered_map<GatewayAppIdentifier, std::set<qcc::String>, GatewayAppIdentifier::Hash>::iterator iter = m_AppConnectorIndex.begin();
+    while (iter != m_AppConnectorIndex.end()) {
+        iter->second.erase(connectorId);
+        if (iter->second.empty()) {
+            m_AppConnectorIndex.erase(iter++);
+        } else {
+            iter++;
+        }
+    }
+}
+
+QStatus GatewayRouterPolicyManager::reloadConfig()
+{
+    GatewayStatsTimer timer(GW_LATENCY_POLICY_RELOAD);
+    GatewayStats* stats = GatewayStats::getInstance();
+    stats->increment(GW_STAT_POLICY_RELOADS);
+
+    BusAttachment* bus = GatewayMgmt::getInstance()->getBusAttachment();
+    if (!bus) {
+        QCC_LogError(ER_FAIL, ("BusAttachment is null"));
+        stats->increment(GW_STAT_POLICY_RELOAD_FAILURES);
+        return ER_FAIL;
+    }
 
     bus->EnableConcurrentCallbacks();
     Message reply(*bus);
     const ProxyBusObject& alljoynObj = bus->GetAllJoynProxyObj();
-    status = alljoynObj.MethodCall(org::alljoyn::Bus::InterfaceName, "ReloadConfig", NULL, 0, reply);
+    QStatus status = alljoynObj.MethodCall(org::alljoyn::Bus::InterfaceName, "ReloadConfig", NULL, 0, reply);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not reload the config"));
+        stats->increment(GW_STAT_POLICY_RELOAD_FAILURES);
         return status;
     }
 
@@ -172,6 +737,7 @@ QStatus GatewayRouterPolicyManager::commitAppPolicies(std::map<qcc::String, std:
     reply->GetArgs(AJPARAM_BOOL.c_str(), &success);
     if (!success) {
         QCC_DbgHLPrintf(("Could not reload the config"));
+        stats->increment(GW_STAT_POLICY_RELOAD_FAILURES);
         return ER_INIT_FAILED;
     }
 
@@ -180,81 +746,222 @@ QStatus GatewayRouterPolicyManager::commitAppPolicies(std::map<qcc::String, std:
     return status;
 }
 
+QStatus GatewayRouterPolicyManager::commitPolicies(std::set<qcc::String> const& connectorIds, bool includeDefaultPolicies)
+{
+    QStatus status = ER_OK;
+    CommitStats commitStats(status);
+    bool changed = false;
+
+    pthread_mutex_lock(&m_PolicyLock);
+    if (includeDefaultPolicies) {
+        status = writeDefaultPolicies(changed);
+        if (status != ER_OK) {
+            discardPolicyFiles();
+            pthread_mutex_unlock(&m_PolicyLock);
+            QCC_LogError(status, ("Could not write the Default Policies"));
+            return status;
+        }
+    }
+
+    std::vector<std::map<qcc::String, std::vector<GatewayAclRules> >::iterator> apps;
+    std::set<qcc::String>::const_iterator idIter;
+    for (idIter = connectorIds.begin(); idIter != connectorIds.end(); idIter++) {
+        std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter = m_ConnectorAppRules.find(*idIter);
+        if (iter == m_ConnectorAppRules.end()) {
+            continue;         //connector was removed - its file is already gone
+        }
+        apps.push_back(iter);
+    }
+    bool appsChanged = false;
+    status = writeAppPolicies(apps, appsChanged);
+    if (status != ER_OK) {
+        discardPolicyFiles();
+        pthread_mutex_unlock(&m_PolicyLock);
+        QCC_LogError(status, ("Could not write the App Policies"));
+        return status;
+    }
+    changed |= appsChanged;
+
+    status = persistPolicyFiles();
+    if (status != ER_OK) {
+        pthread_mutex_unlock(&m_PolicyLock);
+        QCC_LogError(status, ("Could not persist the Policies"));
+        return status;
+    }
+    //a reload that failed before is retried even if the files are unchanged now
+    changed |= m_ReloadPending;
+    uint64_t version = m_PolicyFilesVersion;
+    pthread_mutex_unlock(&m_PolicyLock);
+
+    if (!changed) {
+        QCC_DbgPrintf(("Policy files unchanged - not reloading the config"));
+        return status;
+    }
+    status = reloadConfig();
+    if (status == ER_OK) {
+        clearReloadPending(version);
+    }
+    return status;
+}
+
 QStatus GatewayRouterPolicyManager::commit()
 {
-    BusAttachment* bus = GatewayMgmt::getInstance()->getBusAttachment();
-    if (!bus) {
-        QCC_LogError(ER_FAIL, ("BusAttachment is null"));
-        return ER_FAIL;
+    //everything is rewritten so the pending batch is redundant
+    m_CommitScheduler.startFullCommit();
+    QStatus status = commitAllPolicies();
+    m_CommitScheduler.completeFullCommit(status);
+    return status;
+}
+
+void GatewayRouterPolicyManager::notifyWhenCommitted(GatewayPolicyCommitListener* listener)
+{
+    m_CommitScheduler.notifyWhenCommitted(listener);
+}
+
+void GatewayRouterPolicyManager::flushCommits()
+{
+    m_CommitScheduler.flush();
+}
+
+class GatewayRouterPolicyManager::BusObjectRelease : public GatewayPolicyCommitListener {
+  public:
+    BusObjectRelease(BusObject* busObject) : m_BusObject(busObject)
+    {
+    }
+
+    void policiesCommitted(QStatus status)
+    {
+        QCC_UNUSED(status);
+        delete m_BusObject;
     }
 
-    QStatus status = writeDefaultPolicies();
+  private:
+    BusObject* m_BusObject;
+};
+
+void GatewayRouterPolicyManager::deleteWhenCommitted(BusObject* busObject)
+{
+    //the replies of the pending commit were registered first, so they are sent before the delete
+    m_CommitScheduler.notifyWhenCommitted(new BusObjectRelease(busObject));
+}
+
+QStatus GatewayRouterPolicyManager::commitAllPolicies()
+{
+    QStatus status = ER_OK;
+    CommitStats commitStats(status);
+
+    pthread_mutex_lock(&m_PolicyLock);
+
+    bool changed = false;
+    status = writeDefaultPolicies(changed);
     if (status != ER_OK) {
+        discardPolicyFiles();
+        pthread_mutex_unlock(&m_PolicyLock);
         QCC_LogError(status, ("Could not write the Default Policies"));
         return status;
     }
 
+    std::vector<std::map<qcc::String, std::vector<GatewayAclRules> >::iterator> apps;
     std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter;
     for (iter = m_ConnectorAppRules.begin(); iter != m_ConnectorAppRules.end(); iter++) {
-        status = writeAppPolicies(iter);
-        if (status != ER_OK) {
-            QCC_LogError(status, ("Could not write the App Policies"));
-            return status;
-        }
+        apps.push_back(iter);
     }
-
-
-    bus->EnableConcurrentCallbacks();
-    Message reply(*bus);
-    const ProxyBusObject& alljoynObj = bus->GetAllJoynProxyObj();
-    status = alljoynObj.MethodCall(org::alljoyn::Bus::InterfaceName, "ReloadConfig", NULL, 0, reply);
+    bool appsChanged = false;
+    status = writeAppPolicies(apps, appsChanged);
     if (status != ER_OK) {
-        QCC_LogError(status, ("Could not reload the config"));
+        discardPolicyFiles();
+        pthread_mutex_unlock(&m_PolicyLock);
+        QCC_LogError(status, ("Could not write the App Policies"));
         return status;
     }
+    changed |= appsChanged;
 
-    bool success = false;
-    reply->GetArgs(AJPARAM_BOOL.c_str(), &success);
-    if (!success) {
-        QCC_DbgHLPrintf(("Could not reload the config"));
-        return ER_INIT_FAILED;
+    status = persistPolicyFiles();
+    if (status != ER_OK) {
+        pthread_mutex_unlock(&m_PolicyLock);
+        QCC_LogError(status, ("Could not persist the Policies"));
+        return status;
     }
+    //a reload that failed before is retried even if the files are unchanged now
+    changed |= m_ReloadPending;
+    uint64_t version = m_PolicyFilesVersion;
+    pthread_mutex_unlock(&m_PolicyLock);
 
-    QCC_DbgPrintf(("Reloaded config successfully"));
-
+    if (!changed) {
+        QCC_DbgPrintf(("Policy files unchanged - not reloading the config"));
+        return status;
+    }
+    status = reloadConfig();
+    if (status == ER_OK) {
+        clearReloadPending(version);
+    }
     return status;
 }
 
-QStatus GatewayRouterPolicyManager::writeAppPolicies(std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter)
-{
-    QStatus status = ER_FAIL;
-    xmlDocPtr doc = xmlNewDoc((xmlChar*)XML_DEFAULT_VERSION);
-    if (doc == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml document tree"));
-        return status;
+class GatewayRouterPolicyManager::AppPoliciesTask : public GatewayWorkerTask {
+  public:
+    AppPoliciesTask(GatewayRouterPolicyManager* policyManager,
+                    std::vector<std::map<qcc::String, std::vector<GatewayAclRules> >::iterator> const& apps) :
+        m_PolicyManager(policyManager), m_Apps(apps), m_Statuses(apps.size(), ER_OK), m_Changed(apps.size(), false)
+    {
     }
 
-    xmlTextWriterPtr writer = xmlNewTextWriterDoc(&doc, 0);
-    if (writer == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml writer\n"));
-        xmlFreeDoc(doc);
+    void execute(size_t taskIndex, size_t workerIndex)
+    {
+        bool changed = false;
+        m_Statuses[taskIndex] = m_PolicyManager->writeAppPolicies(m_Apps[taskIndex], m_PolicyManager->m_WorkerWriters[workerIndex], changed);
+        m_Changed[taskIndex] = changed;
+    }
+
+    QStatus getStatus(bool& changed) const
+    {
+        QStatus status = ER_OK;
+        for (size_t i = 0; i < m_Statuses.size(); i++) {
+            changed |= m_Changed[i] != 0;
+            if (m_Statuses[i] != ER_OK) {
+                status = m_Statuses[i];
+            }
+        }
         return status;
     }
 
-    int rc = xmlTextWriterStartDocument(writer, "1.0", NULL, NULL);
+  private:
+    GatewayRouterPolicyManager* m_PolicyManager;
+    std::vector<std::map<qcc::String, std::vector<GatewayAclRules> >::iterator> const& m_Apps;
+    std::vector<QStatus> m_Statuses;
+    std::vector<char> m_Changed;         //not vector<bool> - its elements are written from several workers
+};
+
+QStatus GatewayRouterPolicyManager::writeAppPolicies(std::vector<std::map<qcc::String, std::vector<GatewayAclRules> >::iterator> const& apps, bool& changed)
+{
+    //each connector's file is independent - generate and stage them in parallel, the caller reloads once
+    AppPoliciesTask task(this, apps);
+    m_WorkerPool.run(task, apps.size());
+    return task.getStatus(changed);
+}
+
+QStatus GatewayRouterPolicyManager::writeAppPolicies(std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter, GatewayXmlWriter& writer, bool& changed)
+{
+    QStatus status = ER_FAIL;
+    std::set<qcc::String> aclIds;
+    std::map<qcc::String, RulesFragmentCache>::iterator cacheIter = m_RulesFragments.find(iter->first);
+    RulesFragmentCache* cache = cacheIter != m_RulesFragments.end() ? &cacheIter->second : NULL;
+    writer.reset();
+
+    int rc = writer.startDocument();
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"busconfig");
+    rc = writer.startElement("busconfig");
     if (rc < 0) {
         goto exit;
     }
 
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"policy");
+    rc = writer.startElement("policy");
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"user", (xmlChar*)iter->first.c_str());
+    rc = writer.writeAttribute("user", iter->first.c_str());
     if (rc < 0) {
         goto exit;
     }
@@ -262,329 +969,565 @@ QStatus GatewayRouterPolicyManager::writeAppPolicies(std::map<qcc::String, std::
     if (rc < 0) {
         goto exit;
     }
-    rc = writeAclUserPolicies(writer, iter->second);
+    for (size_t rulesIndx = 0; rulesIndx < iter->second.size(); rulesIndx++) {
+        GatewayAclRules const& rules = iter->second[rulesIndx];
+        if (m_AclPolicyFragments && !rules.getAclId().empty()) {
+            aclIds.insert(rules.getAclId());
+            continue;         //written to its own fragment
+        }
+        rc = writeAclUserPolicies(writer, rules, cache);
+        if (rc < 0) {
+            goto exit;
+        }
+    }
+    if (!aclIds.empty()) {
+        //included after the base rules so the acls override them
+        rc = writer.endElement();
+        if (rc < 0) {
+            goto exit;
+        }
+        rc = writer.writeElement("includedir", getAclFragmentDirectory(iter->first).c_str());
+        if (rc < 0) {
+            goto exit;
+        }
+    }
+    rc = writer.endDocument(); //closes all open tags
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterEndDocument(writer); //closes all open tags
-    if (rc < 0) {
+    status = savePolicyFile(m_appPolicyDirectory + "/" + iter->first + ".conf", writer, changed);
+    if (status != ER_OK) {
         goto exit;
     }
-    rc = xmlSaveFormatFile((m_appPolicyDirectory + "/" + iter->first + ".conf").c_str(), doc, 1);
-    if (rc < 0) {
-        status = ER_WRITE_ERROR;
+
+    if (!aclIds.empty() && mkdir(getAclFragmentDirectory(iter->first).c_str(), 0755) != 0 && errno != EEXIST) {
+        QCC_LogError(ER_OS_ERROR, ("Could not create the acl fragment directory for %s", iter->first.c_str()));
+        status = ER_OS_ERROR;
         goto exit;
     }
-    status = ER_OK;
+    for (size_t rulesIndx = 0; rulesIndx < iter->second.size(); rulesIndx++) {
+        GatewayAclRules const& rules = iter->second[rulesIndx];
+        if (aclIds.find(rules.getAclId()) == aclIds.end()) {
+            continue;
+        }
+        bool fragmentChanged = false;
+        status = writeAclFragment(iter->first, rules, writer, fragmentChanged);
+        if (status != ER_OK) {
+            goto exit;
+        }
+        changed |= fragmentChanged;
+    }
+    changed |= removeAclFragments(iter->first, aclIds);
 
 exit:
 
-    xmlFreeTextWriter(writer);
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
     return status;
 }
 
-QStatus GatewayRouterPolicyManager::writeDefaultPolicies()
+QStatus GatewayRouterPolicyManager::writeAclFragment(qcc::String const& connectorId, GatewayAclRules const& rules, GatewayXmlWriter& writer, bool& changed)
 {
     QStatus status = ER_FAIL;
+    std::map<qcc::String, RulesFragmentCache>::iterator cacheIter = m_RulesFragments.find(connectorId);
+    RulesFragmentCache* cache = cacheIter != m_RulesFragments.end() ? &cacheIter->second : NULL;
+    writer.reset();
 
-    xmlDocPtr doc = xmlNewDoc((xmlChar*)XML_DEFAULT_VERSION);
-    if (doc == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml document tree"));
-        return status;
+    int rc = writer.startDocument();
+    if (rc < 0) {
+        goto exit;
     }
-    xmlTextWriterPtr writer = xmlNewTextWriterDoc(&doc, 0);
-    if (writer == NULL) {
-        QCC_DbgHLPrintf(("Error creating the xml writer\n"));
-        xmlFreeDoc(doc);
-        return status;
+    rc = writer.startElement("busconfig");
+    if (rc < 0) {
+        goto exit;
+    }
+    rc = writer.startElement("policy");
+    if (rc < 0) {
+        goto exit;
     }
+    rc = writer.writeAttribute("user", connectorId.c_str());
+    if (rc < 0) {
+        goto exit;
+    }
+    rc = writeAclUserPolicies(writer, rules, cache);
+    if (rc < 0) {
+        goto exit;
+    }
+    rc = writer.endDocument(); //closes all open tags
+    if (rc < 0) {
+        goto exit;
+    }
+    status = savePolicyFile(getAclFragmentDirectory(connectorId) + "/" + rules.getAclId() + ".conf", writer, changed);
+
+exit:
+
+    return status;
+}
+
+QStatus GatewayRouterPolicyManager::writeDefaultPolicies(bool& changed)
+{
+    QStatus status = ER_FAIL;
+    GatewayXmlWriter& writer = m_XmlWriter;
+    writer.reset();
     std::map<qcc::String, std::vector<GatewayAclRules> >::iterator iter;
 
-    int rc = xmlTextWriterStartDocument(writer, "1.0", NULL, NULL);
+    int rc = writer.startDocument();
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"busconfig");
+    rc = writer.startElement("busconfig");
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteElement(writer, (xmlChar*)"includedir", (xmlChar*)(m_appPolicyDirectory).c_str());
+    rc = writer.writeElement("includedir", (m_appPolicyDirectory).c_str());
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"policy");
+    rc = writer.startElement("policy");
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"context", (xmlChar*)"default");
+    rc = writer.writeAttribute("context", "default");
     if (rc < 0) {
         goto exit;
     }
     for (iter = m_ConnectorAppRules.begin(); iter != m_ConnectorAppRules.end(); iter++) {
 
-        rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+        rc = writer.startElement("allow");
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"user", (xmlChar*)iter->first.c_str());
+        rc = writer.writeAttribute("user", iter->first.c_str());
         if (rc < 0) {
             goto exit;
         }
-        rc = xmlTextWriterEndElement(writer);
+        rc = writer.endElement();
         if (rc < 0) {
             goto exit;
         }
     }
-    rc = xmlTextWriterEndDocument(writer); //closes all open tags
+    rc = writer.endDocument(); //closes all open tags
     if (rc < 0) {
         goto exit;
     }
-    rc = xmlSaveFormatFile(m_gatewayPolicyFile.c_str(), doc, 1);
-    if (rc < 0) {
-        status = ER_WRITE_ERROR;
-        goto exit;
-    }
-    status = ER_OK;
+    status = savePolicyFile(m_gatewayPolicyFile, writer, changed);
 
 exit:
 
-    xmlFreeTextWriter(writer);
-    xmlFreeDoc(doc);
-    xmlCleanupParser();
     return status;
 }
 
-int GatewayRouterPolicyManager::writeDefaultUserPolicies(xmlTextWriterPtr writer, qcc::String const& userName)
+bool GatewayRouterPolicyManager::getPolicyFileState(qcc::String const& fileName, PolicyFileState& state)
+{
+    //called from the workers writing app policies - the file I/O is done without the lock
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) {
+        pthread_mutex_lock(&m_PolicyFileStateLock);
+        m_PolicyFileStates.erase(fileName);
+        pthread_mutex_unlock(&m_PolicyFileStateLock);
+        return false;
+    }
+
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    std::map<qcc::String, PolicyFileState>::iterator iter = m_PolicyFileStates.find(fileName);
+    if (iter != m_PolicyFileStates.end() && iter->second.size == fileStat.st_size && iter->second.mtime == fileStat.st_mtime) {
+        state = iter->second;
+        pthread_mutex_unlock(&m_PolicyFileStateLock);
+        return true;
+    }
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+
+    //unknown or modified behind our back - hash what is on disk
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (!file) {
+        pthread_mutex_lock(&m_PolicyFileStateLock);
+        m_PolicyFileStates.erase(fileName);
+        pthread_mutex_unlock(&m_PolicyFileStateLock);
+        return false;
+    }
+    uint64_t hash = FNV_OFFSET_BASIS;
+    uint8_t buffer[4096];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        hash = hashPolicyContent(buffer, bytesRead, hash);
+    }
+    fclose(file);
+
+    state.hash = hash;
+    state.size = fileStat.st_size;
+    state.mtime = fileStat.st_mtime;
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    m_PolicyFileStates[fileName] = state;
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+    return true;
+}
+
+QStatus GatewayRouterPolicyManager::savePolicyFile(qcc::String const& fileName, GatewayXmlWriter const& writer, bool& changed)
+{
+    changed = false;
+
+    uint64_t hash = hashPolicyContent((const uint8_t*)writer.getData(), writer.getSize());
+    PolicyFileState state;
+    if (getPolicyFileState(fileName, state) && state.hash == hash && (size_t)state.size == writer.getSize()) {
+        QCC_DbgPrintf(("Policy file %s unchanged - not rewriting it", fileName.c_str()));
+        GatewayStats::getInstance()->increment(GW_STAT_POLICY_FILES_UNCHANGED);
+        return ER_OK;
+    }
+
+    QStatus status = m_PolicyFileBatch.stage(fileName, writer.getData(), writer.getSize());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not write the policy file %s", fileName.c_str()));
+        return status;
+    }
+
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    m_StagedPolicyHashes[fileName] = hash;
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+    GatewayStats* stats = GatewayStats::getInstance();
+    stats->increment(GW_STAT_POLICY_FILES_WRITTEN);
+    stats->increment(GW_STAT_POLICY_BYTES_WRITTEN, writer.getSize());
+    changed = true;
+    return status;
+}
+
+QStatus GatewayRouterPolicyManager::persistPolicyFiles()
+{
+    //even a failed commit may have replaced some of the files
+    if (!m_PolicyFileBatch.empty()) {
+        markReloadPending();
+    }
+    QStatus status = m_PolicyFileBatch.commit();
+
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    std::map<qcc::String, uint64_t>::const_iterator iter;
+    for (iter = m_StagedPolicyHashes.begin(); iter != m_StagedPolicyHashes.end(); iter++) {
+        struct stat fileStat;
+        if (status != ER_OK || stat(iter->first.c_str(), &fileStat) != 0) {
+            m_PolicyFileStates.erase(iter->first);         //unknown state - rehash next time
+            continue;
+        }
+        PolicyFileState& state = m_PolicyFileStates[iter->first];
+        state.hash = iter->second;
+        state.size = fileStat.st_size;
+        state.mtime = fileStat.st_mtime;
+    }
+    m_StagedPolicyHashes.clear();
+
+    std::set<qcc::String>::const_iterator removalIter;
+    for (removalIter = m_StagedFragmentRemovals.begin(); removalIter != m_StagedFragmentRemovals.end(); removalIter++) {
+        m_PolicyFileStates.erase(*removalIter);
+        if (status == ER_OK) {
+            //fails while the directory still holds the fragments of active Acls
+            rmdir(removalIter->substr(0, removalIter->find_last_of('/')).c_str());
+        }
+    }
+    m_StagedFragmentRemovals.clear();
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+    return status;
+}
+
+void GatewayRouterPolicyManager::markReloadPending()
+{
+    m_ReloadPending = true;
+    m_PolicyFilesVersion++;
+}
+
+void GatewayRouterPolicyManager::clearReloadPending(uint64_t version)
+{
+    pthread_mutex_lock(&m_PolicyLock);
+    if (m_PolicyFilesVersion == version) {
+        m_ReloadPending = false;         //nothing was persisted since the files that were reloaded
+    }
+    pthread_mutex_unlock(&m_PolicyLock);
+}
+
+void GatewayRouterPolicyManager::discardPolicyFiles()
+{
+    m_PolicyFileBatch.abort();
+    pthread_mutex_lock(&m_PolicyFileStateLock);
+    m_StagedPolicyHashes.clear();
+    m_StagedFragmentRemovals.clear();
+    pthread_mutex_unlock(&m_PolicyFileStateLock);
+}
+
+int GatewayRouterPolicyManager::writeDefaultUserPolicies(GatewayXmlWriter& writer, qcc::String const& userName)
 {
     int rc = 0;
 
     //deny send_type = *
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"deny");
+    rc = writer.startElement("deny");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"*");
+    rc = writer.writeAttribute("send_type", "*");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
     //deny receive_type = *
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"deny");
+    rc = writer.startElement("deny");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"*");
+    rc = writer.writeAttribute("receive_type", "*");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
     //allow communication with gwMgmtApp
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_destination", (xmlChar*)GW_WELLKNOWN_NAME);
+    rc = writer.writeAttribute("send_destination", GW_WELLKNOWN_NAME);
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path", (xmlChar*)(AJ_GW_OBJECTPATH + "/" + userName).c_str());
+    rc = writer.writeAttribute("send_path", (AJ_GW_OBJECTPATH + "/" + userName).c_str());
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"method_call");
+    rc = writer.writeAttribute("send_type", "method_call");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
 
     //allow default Dbus interface
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_destination", (xmlChar*)org::freedesktop::DBus::WellKnownName);
+    rc = writer.writeAttribute("send_destination", org::freedesktop::DBus::WellKnownName);
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_sender", (xmlChar*)org::freedesktop::DBus::WellKnownName);
+    rc = writer.writeAttribute("receive_sender", org::freedesktop::DBus::WellKnownName);
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
     //allow about communication
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path", (xmlChar*)"/About");
+    rc = writer.writeAttribute("send_path", "/About");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"signal");
+    rc = writer.writeAttribute("send_type", "signal");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
 
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_interface",  (xmlChar*)"org.freedesktop.DBus.Properties");
+    rc = writer.writeAttribute("send_interface", "org.freedesktop.DBus.Properties");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
 
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_interface",  (xmlChar*)"org.freedesktop.DBus.Properties");
+    rc = writer.writeAttribute("receive_interface", "org.freedesktop.DBus.Properties");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
 
 
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path",  (xmlChar*)"/org/alljoyn/Bus/Peer");
+    rc = writer.writeAttribute("send_path", "/org/alljoyn/Bus/Peer");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
 
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path",  (xmlChar*)"/org/alljoyn/Bus/Peer");
+    rc = writer.writeAttribute("receive_path", "/org/alljoyn/Bus/Peer");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
 
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"method_return");
+    rc = writer.writeAttribute("send_type", "method_return");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"error");
+    rc = writer.writeAttribute("send_type", "error");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path", (xmlChar*)"/About");
+    rc = writer.writeAttribute("receive_path", "/About");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"method_call");
+    rc = writer.writeAttribute("receive_type", "method_call");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
     //allow Device Icon communication
-    rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+    rc = writer.startElement("allow");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path", (xmlChar*)"/About/DeviceIcon");
+    rc = writer.writeAttribute("receive_path", "/About/DeviceIcon");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"method_call");
+    rc = writer.writeAttribute("receive_type", "method_call");
     if (rc < 0) {
         return rc;
     }
-    rc = xmlTextWriterEndElement(writer);
+    rc = writer.endElement();
     if (rc < 0) {
         return rc;
     }
     return rc;
 }
 
-int GatewayRouterPolicyManager::writeAclUserPolicies(xmlTextWriterPtr writer, std::vector<GatewayAclRules> const& rules)
+int GatewayRouterPolicyManager::writeAclUserPolicies(GatewayXmlWriter& writer, std::vector<GatewayAclRules> const& rules)
 {
     int rc = 0;
     for (size_t policyIndx = 0; policyIndx < rules.size(); policyIndx++) {
-        writeExposedServices(writer, rules[policyIndx].getExposedServicesRules());
+        rc = writeAclUserPolicies(writer, rules[policyIndx]);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return rc;
+}
 
-        const GatewayRemoteAppRules& remoteAppPerms = rules[policyIndx].getRemoteAppRules();
-        GatewayRemoteAppRules::const_iterator iter;
-        for (iter = remoteAppPerms.begin(); iter != remoteAppPerms.end(); iter++) {
+int GatewayRouterPolicyManager::writeAclUserPolicies(GatewayXmlWriter& writer, GatewayAclRules const& rules, RulesFragmentCache* cache)
+{
+    if (!cache || !rules.getRevision()) {
+        return writeAclUserPolicies(writer, rules);
+    }
 
-            std::map<GatewayAppIdentifier, qcc::String>::const_iterator announceIter;
-            if ((announceIter = m_AnnouncedDevices.find(iter->first)) == m_AnnouncedDevices.end()) {
-                continue;
-            }
-            writeRemotedApps(writer, iter->second, announceIter->second);
+    //the policies of remoted apps name the bus they were announced on
+    std::vector<qcc::String> busNames;
+    const GatewayRemoteAppRules& remoteAppPerms = rules.getRemoteAppRules();
+    GatewayRemoteAppRules::const_iterator iter;
+    for (iter = remoteAppPerms.begin(); iter != remoteAppPerms.end(); iter++) {
+        AnnouncedDevices::const_iterator announceIter = m_AnnouncedDevices.find(iter->first);
+        busNames.push_back(announceIter != m_AnnouncedDevices.end() ? announceIter->second : qcc::String());
+    }
+
+    RulesFragmentCache::iterator cacheIter = cache->find(rules.getRevision());
+    if (cacheIter != cache->end() && cacheIter->second.busNames == busNames) {
+        return writer.writeRaw(cacheIter->second.data.data(), cacheIter->second.data.size());
+    }
+
+    bool startTagOpen = writer.isStartTagOpen();
+    size_t start = writer.getSize();
+    int rc = writeAclUserPolicies(writer, rules);
+    if (rc < 0) {
+        return rc;
+    }
+
+    RulesFragment& fragment = (*cache)[rules.getRevision()];
+    fragment.busNames.swap(busNames);
+    fragment.data.assign(writer.getData() + start, writer.getSize() - start);
+    if (startTagOpen && !fragment.data.empty()) {
+        fragment.data.erase(0, 2);         //the ">\n" closing the start tag is written again by writeRaw
+    }
+    return rc;
+}
+
+int GatewayRouterPolicyManager::writeAclUserPolicies(GatewayXmlWriter& writer, GatewayAclRules const& rules)
+{
+    int rc = writeExposedServices(writer, rules.getExposedServicesRules());
+    if (rc < 0) {
+        return rc;
+    }
+
+    const GatewayRemoteAppRules& remoteAppPerms = rules.getRemoteAppRules();
+    GatewayRemoteAppRules::const_iterator iter;
+    for (iter = remoteAppPerms.begin(); iter != remoteAppPerms.end(); iter++) {
+
+        AnnouncedDevices::const_iterator announceIter;
+        if ((announceIter = m_AnnouncedDevices.find(iter->first)) == m_AnnouncedDevices.end()) {
+            continue;
+        }
+        rc = writeRemotedApps(writer, iter->second, announceIter->second);
+        if (rc < 0) {
+            return rc;
         }
     }
     return rc;
 }
 
-int GatewayRouterPolicyManager::writeExposedServices(xmlTextWriterPtr writer, const GatewayRuleObjectDescriptions& objects)
+int GatewayRouterPolicyManager::writeExposedServices(GatewayXmlWriter& writer, const GatewayRuleObjectDescriptions& objects)
 {
     int rc = 0;
     for (size_t objectsIndx = 0; objectsIndx < objects.size(); objectsIndx++) {
@@ -593,96 +1536,96 @@ int GatewayRouterPolicyManager::writeExposedServices(xmlTextWriterPtr writer, co
         const std::vector<qcc::String>& interfaces = objects[objectsIndx].getInterfaces();
         if (!interfaces.size() && objectPath.compare("*") != 0) {
             //receive_type = method_call
-            rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+            rc = writer.startElement("allow");
             if (rc < 0) {
                 return rc;
             }
             if (isPrefix) {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path_prefix", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("receive_path_prefix", objectPath.c_str());
             } else {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("receive_path", objectPath.c_str());
             }
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"method_call");
+            rc = writer.writeAttribute("receive_type", "method_call");
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterEndElement(writer);
+            rc = writer.endElement();
             if (rc < 0) {
                 return rc;
             }
             //send_type=signal
-            rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+            rc = writer.startElement("allow");
             if (rc < 0) {
                 return rc;
             }
             if (isPrefix) {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path_prefix", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("send_path_prefix", objectPath.c_str());
             } else {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("send_path", objectPath.c_str());
             }
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"signal");
+            rc = writer.writeAttribute("send_type", "signal");
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterEndElement(writer);
+            rc = writer.endElement();
             if (rc < 0) {
                 return rc;
             }
         } else {
             for (size_t interfaceIndx = 0; interfaceIndx < interfaces.size(); interfaceIndx++) {
                 //receive_type = method_call
-                rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+                rc = writer.startElement("allow");
                 if (rc < 0) {
                     return rc;
                 }
                 if (isPrefix) {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path_prefix", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("receive_path_prefix", objectPath.c_str());
                 } else {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("receive_path", objectPath.c_str());
                 }
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_interface", (xmlChar*)interfaces[interfaceIndx].c_str());
+                rc = writer.writeAttribute("receive_interface", interfaces[interfaceIndx].c_str());
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"method_call");
+                rc = writer.writeAttribute("receive_type", "method_call");
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterEndElement(writer);
+                rc = writer.endElement();
                 if (rc < 0) {
                     return rc;
                 }
                 //send_type=signal
-                rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+                rc = writer.startElement("allow");
                 if (rc < 0) {
                     return rc;
                 }
                 if (isPrefix) {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path_prefix", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("send_path_prefix", objectPath.c_str());
                 } else {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("send_path", objectPath.c_str());
                 }
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_interface", (xmlChar*)interfaces[interfaceIndx].c_str());
+                rc = writer.writeAttribute("send_interface", interfaces[interfaceIndx].c_str());
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"signal");
+                rc = writer.writeAttribute("send_type", "signal");
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterEndElement(writer);
+                rc = writer.endElement();
                 if (rc < 0) {
                     return rc;
                 }
@@ -692,7 +1635,7 @@ int GatewayRouterPolicyManager::writeExposedServices(xmlTextWriterPtr writer, co
     return rc;
 }
 
-int GatewayRouterPolicyManager::writeRemotedApps(xmlTextWriterPtr writer, const GatewayRuleObjectDescriptions& objects, qcc::String const& uniqueName)
+int GatewayRouterPolicyManager::writeRemotedApps(GatewayXmlWriter& writer, const GatewayRuleObjectDescriptions& objects, qcc::String const& uniqueName)
 {
     int rc = 0;
     for (size_t objectsIndx = 0; objectsIndx < objects.size(); objectsIndx++) {
@@ -701,112 +1644,112 @@ int GatewayRouterPolicyManager::writeRemotedApps(xmlTextWriterPtr writer, const
         const std::vector<qcc::String>& interfaces = objects[objectsIndx].getInterfaces();
         if (!interfaces.size() && objectPath.compare("*") != 0) {
             //send_type = method_call
-            rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+            rc = writer.startElement("allow");
             if (rc < 0) {
                 return rc;
             }
             if (isPrefix) {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path_prefix", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("send_path_prefix", objectPath.c_str());
             } else {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("send_path", objectPath.c_str());
             }
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_destination", (xmlChar*)uniqueName.c_str());
+            rc = writer.writeAttribute("send_destination", uniqueName.c_str());
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"method_call");
+            rc = writer.writeAttribute("send_type", "method_call");
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterEndElement(writer);
+            rc = writer.endElement();
             if (rc < 0) {
                 return rc;
             }
             //receive_type=signal
-            rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+            rc = writer.startElement("allow");
             if (rc < 0) {
                 return rc;
             }
             if (isPrefix) {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path_prefix", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("receive_path_prefix", objectPath.c_str());
             } else {
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path", (xmlChar*)objectPath.c_str());
+                rc = writer.writeAttribute("receive_path", objectPath.c_str());
             }
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_sender", (xmlChar*)uniqueName.c_str());
+            rc = writer.writeAttribute("receive_sender", uniqueName.c_str());
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"signal");
+            rc = writer.writeAttribute("receive_type", "signal");
             if (rc < 0) {
                 return rc;
             }
-            rc = xmlTextWriterEndElement(writer);
+            rc = writer.endElement();
             if (rc < 0) {
                 return rc;
             }
         } else {
             for (size_t interfaceIndx = 0; interfaceIndx < interfaces.size(); interfaceIndx++) {
                 //receive_type = method_call
-                rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+                rc = writer.startElement("allow");
                 if (rc < 0) {
                     return rc;
                 }
                 if (isPrefix) {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path_prefix", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("send_path_prefix", objectPath.c_str());
                 } else {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_path", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("send_path", objectPath.c_str());
                 }
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_interface", (xmlChar*)interfaces[interfaceIndx].c_str());
+                rc = writer.writeAttribute("send_interface", interfaces[interfaceIndx].c_str());
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_destination", (xmlChar*)uniqueName.c_str());
+                rc = writer.writeAttribute("send_destination", uniqueName.c_str());
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"send_type", (xmlChar*)"method_call");
+                rc = writer.writeAttribute("send_type", "method_call");
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterEndElement(writer);
+                rc = writer.endElement();
                 if (rc < 0) {
                     return rc;
                 }
                 //send_type=signal
-                rc = xmlTextWriterStartElement(writer, (xmlChar*)"allow");
+                rc = writer.startElement("allow");
                 if (rc < 0) {
                     return rc;
                 }
                 if (isPrefix) {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path_prefix", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("receive_path_prefix", objectPath.c_str());
                 } else {
-                    rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_path", (xmlChar*)objectPath.c_str());
+                    rc = writer.writeAttribute("receive_path", objectPath.c_str());
                 }
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_interface", (xmlChar*)interfaces[interfaceIndx].c_str());
+                rc = writer.writeAttribute("receive_interface", interfaces[interfaceIndx].c_str());
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_sender", (xmlChar*)uniqueName.c_str());
+                rc = writer.writeAttribute("receive_sender", uniqueName.c_str());
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterWriteAttribute(writer, (xmlChar*)"receive_type", (xmlChar*)"signal");
+                rc = writer.writeAttribute("receive_type", "signal");
                 if (rc < 0) {
                     return rc;
                 }
-                rc = xmlTextWriterEndElement(writer);
+                rc = writer.endElement();
                 if (rc < 0) {
                     return rc;
                 }
@@ -824,37 +1767,235 @@ void GatewayRouterPolicyManager::Announced(const char* busName, uint16_t version
 
     QCC_DbgTrace(("Received Announcement from %s", busName));
 
-    char* deviceId;
-    uint8_t* appIdBuffer = NULL;
-    size_t numElements = 0;
+    const uint8_t* appId = NULL;
+    size_t appIdLen = 0;
+    const char* deviceId = NULL;
+    if (!busName || !GatewayAppIdentifier::extractFromAboutData(aboutDataArg, &appId, &appIdLen, &deviceId)) {
+        QCC_DbgHLPrintf(("Announcement missing appId or deviceId - ignoring the announcement"));
+        return;
+    }
+    GatewayStats* stats = GatewayStats::getInstance();
+    stats->increment(GW_STAT_ANNOUNCEMENTS);
+
+    uint64_t announcementHash = hashPolicyContent(appId, appIdLen);
+    announcementHash = hashPolicyContent((const uint8_t*)deviceId, strlen(deviceId) + 1, announcementHash);
+    announcementHash = hashPolicyContent((const uint8_t*)busName, strlen(busName) + 1, announcementHash);
+
+    //most announcements repeat the last one - recognize them without allocating
+    pthread_mutex_lock(&m_PolicyLock);
+    std::unordered_map<uint64_t, GatewayAppIdentifier>::iterator hashIter = m_AnnouncementHashes.find(announcementHash);
+    if (hashIter != m_AnnouncementHashes.end() && hashIter->second.matches(appId, appIdLen, deviceId)) {
+        AnnouncedDevices::const_iterator announceIter = m_AnnouncedDevices.find(hashIter->second);
+        if (announceIter != m_AnnouncedDevices.end() && strcmp(announceIter->second.c_str(), busName) == 0) {
+            touchAnnouncedDevice(hashIter->second, announcementHash);
+            evictAnnouncedDevices();
+            pthread_mutex_unlock(&m_PolicyLock);
+            stats->increment(GW_STAT_ANNOUNCEMENTS_UNCHANGED);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&m_PolicyLock);
 
-    AboutData aboutData;
-    aboutData.CreatefromMsgArg(aboutDataArg);
+    GatewayAppIdentifier key((uint8_t*)appId, appIdLen, deviceId);
 
-    aboutData.GetDeviceId(&deviceId);
-    String deviceIdValue(deviceId);
+    pthread_mutex_lock(&m_PolicyLock);
+    bool busNameChanged = addAnnouncedDevice(key, busName, announcementHash);
+    evictAnnouncedDevices();
+    if (!busNameChanged) {         //busName didn't change in announce
+        pthread_mutex_unlock(&m_PolicyLock);
+        return;
+    }
 
-    aboutData.GetAppId(&appIdBuffer, &numElements);
+    //the busName is kept for later activations, but only connectors whose rules reference this app need rewriting
+    std::set<qcc::String> connectorIds = getConnectorsReferencingApp(key);
+    pthread_mutex_unlock(&m_PolicyLock);
 
-    if (!numElements || !deviceIdValue.length()) {
-        QCC_DbgHLPrintf(("Announcement missing appId or deviceId - ignoring the announcement"));
+    if (connectorIds.empty()) {
+        QCC_DbgPrintf(("Announcement from %s is not referenced by any Acl - not updating the config", busName));
         return;
     }
+    scheduleCommit(connectorIds);
+}
+
+void GatewayRouterPolicyManager::NameOwnerChanged(const char* busName, const char* previousOwner, const char* newOwner)
+{
+    QCC_UNUSED(previousOwner);
+
+    if (!busName || newOwner) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_PolicyLock);
+    std::map<qcc::String, std::set<GatewayAppIdentifier> >::iterator nameIter = m_BusNameDevices.find(busName);
+    if (nameIter == m_BusNameDevices.end()) {
+        pthread_mutex_unlock(&m_PolicyLock);
+        return;
+    }
+
+    //the set is erased with the last device, so iterate over a copy
+    std::set<GatewayAppIdentifier> devices = nameIter->second;
+    std::set<qcc::String> connectorIds;
+    std::set<GatewayAppIdentifier>::const_iterator iter;
+    for (iter = devices.begin(); iter != devices.end(); iter++) {
+        const std::set<qcc::String>& referencingIds = getConnectorsReferencingApp(*iter);
+        connectorIds.insert(referencingIds.begin(), referencingIds.end());
+        removeAnnouncedDevice(*iter);
+    }
+    pthread_mutex_unlock(&m_PolicyLock);
 
-    GatewayAppIdentifier key(appIdBuffer, numElements, deviceIdValue);
-    std::map<GatewayAppIdentifier, qcc::String>::iterator iter;
-    iter = m_AnnouncedDevices.find(key);
+    QCC_DbgPrintf(("%s left the bus - evicted %u announced devices", busName, (uint32_t)devices.size()));
+    GatewayStats::getInstance()->increment(GW_STAT_ANNOUNCED_DEVICES_EVICTED, devices.size());
+    if (connectorIds.empty()) {
+        return;
+    }
+    scheduleCommit(connectorIds);         //drop the stale busName from the policies
+}
+
+QStatus GatewayRouterPolicyManager::whoImplements(qcc::String const& interfaceName)
+{
+    QStatus status = interfaceName.empty() ? m_Bus->WhoImplements(NULL) : m_Bus->WhoImplements(interfaceName.c_str());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("WhoImplements call FAILED for interface '%s'", interfaceName.c_str()));
+    }
+    return status;
+}
+
+QStatus GatewayRouterPolicyManager::cancelWhoImplements(qcc::String const& interfaceName)
+{
+    QStatus status = interfaceName.empty() ? m_Bus->CancelWhoImplements(NULL) : m_Bus->CancelWhoImplements(interfaceName.c_str());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("CancelWhoImplements call FAILED for interface '%s'", interfaceName.c_str()));
+    }
+    return status;
+}
+
+void GatewayRouterPolicyManager::scheduleCommit(std::set<qcc::String> const& connectorIds)
+{
+    if (!m_AutoCommit) {
+        return;
+    }
+
+    if (m_CommitScheduler.isRunning()) {
+        std::set<qcc::String>::const_iterator idIter;
+        for (idIter = connectorIds.begin(); idIter != connectorIds.end(); idIter++) {
+            m_CommitScheduler.markConnectorDirty(*idIter, false);
+        }
+        return;
+    }
+    commitPolicies(connectorIds, false);         //update config files of affected connectors
+}
+
+void GatewayRouterPolicyManager::touchAnnouncedDevice(GatewayAppIdentifier const& key, uint64_t announcementHash)
+{
+    uint64_t now = getMonotonicMs();
+    std::unordered_map<GatewayAppIdentifier, AnnouncedDeviceState, GatewayAppIdentifier::Hash>::iterator stateIter = m_AnnouncedDeviceStates.find(key);
+    if (stateIter == m_AnnouncedDeviceStates.end()) {
+        AnnouncedDeviceState state;
+        state.lastAnnouncedMs = now;
+        state.lruPosition = m_AnnouncedDevicesLru.insert(m_AnnouncedDevicesLru.begin(), key);
+        state.announcementHash = announcementHash;
+        m_AnnouncedDeviceStates.insert(std::pair<GatewayAppIdentifier, AnnouncedDeviceState>(key, state));
+    } else {
+        stateIter->second.lastAnnouncedMs = now;
+        m_AnnouncedDevicesLru.splice(m_AnnouncedDevicesLru.begin(), m_AnnouncedDevicesLru, stateIter->second.lruPosition);
+        if (stateIter->second.announcementHash == announcementHash) {
+            return;
+        }
+        std::unordered_map<uint64_t, GatewayAppIdentifier>::iterator hashIter = m_AnnouncementHashes.find(stateIter->second.announcementHash);
+        if (hashIter != m_AnnouncementHashes.end() && hashIter->second == key) {
+            m_AnnouncementHashes.erase(hashIter);
+        }
+        stateIter->second.announcementHash = announcementHash;
+    }
+    //on a collision the hash keeps its first device - the other one takes the slow path
+    m_AnnouncementHashes.insert(std::pair<uint64_t, GatewayAppIdentifier>(announcementHash, key));
+}
+
+bool GatewayRouterPolicyManager::addAnnouncedDevice(GatewayAppIdentifier const& key, qcc::String const& busName, uint64_t announcementHash)
+{
+    touchAnnouncedDevice(key, announcementHash);
+
+    AnnouncedDevices::iterator iter = m_AnnouncedDevices.find(key);
     if (iter == m_AnnouncedDevices.end()) {
         m_AnnouncedDevices.insert(std::pair<GatewayAppIdentifier, qcc::String>(key, busName));
+    } else if (iter->second.compare(busName) == 0) {
+        return false;
     } else {
-        if (iter->second.compare(busName) == 0) {         //busName didn't change in announce
-            return;
+        std::map<qcc::String, std::set<GatewayAppIdentifier> >::iterator nameIter = m_BusNameDevices.find(iter->second);
+        if (nameIter != m_BusNameDevices.end()) {
+            nameIter->second.erase(key);
+            if (nameIter->second.empty()) {
+                m_BusNameDevices.erase(nameIter);
+            }
         }
         iter->second = busName;
     }
+    m_BusNameDevices[busName].insert(key);
+    return true;
+}
+
+void GatewayRouterPolicyManager::removeAnnouncedDevice(GatewayAppIdentifier const& key)
+{
+    std::unordered_map<GatewayAppIdentifier, AnnouncedDeviceState, GatewayAppIdentifier::Hash>::iterator stateIter = m_AnnouncedDeviceStates.find(key);
+    if (stateIter != m_AnnouncedDeviceStates.end()) {
+        std::unordered_map<uint64_t, GatewayAppIdentifier>::iterator hashIter = m_AnnouncementHashes.find(stateIter->second.announcementHash);
+        if (hashIter != m_AnnouncementHashes.end() && hashIter->second == key) {
+            m_AnnouncementHashes.erase(hashIter);
+        }
+        m_AnnouncedDevicesLru.erase(stateIter->second.lruPosition);
+        m_AnnouncedDeviceStates.erase(stateIter);
+    }
+
+    AnnouncedDevices::iterator iter = m_AnnouncedDevices.find(key);
+    if (iter == m_AnnouncedDevices.end()) {
+        return;
+    }
+    std::map<qcc::String, std::set<GatewayAppIdentifier> >::iterator nameIter = m_BusNameDevices.find(iter->second);
+    if (nameIter != m_BusNameDevices.end()) {
+        nameIter->second.erase(key);
+        if (nameIter->second.empty()) {
+            m_BusNameDevices.erase(nameIter);
+        }
+    }
+    m_AnnouncedDevices.erase(iter);
+}
+
+void GatewayRouterPolicyManager::evictAnnouncedDevices()
+{
+    if (!m_MaxAnnouncedDevices && !m_AnnouncedDeviceTtlMs) {
+        return;
+    }
+
+    //devices referenced by an active acl are pinned and don't count against the limit
+    size_t unpinned = m_AnnouncedDevicesLru.size();
+    std::unordered_map<GatewayAppIdentifier, std::set<qcc::String>, GatewayAppIdentifier::Hash>::const_iterator indexIter;
+    for (indexIter = m_AppConnectorIndex.begin(); indexIter != m_AppConnectorIndex.end(); indexIter++) {
+        if (m_AnnouncedDeviceStates.find(indexIter->first) != m_AnnouncedDeviceStates.end()) {
+            unpinned--;
+        }
+    }
+
+    //walk from the least recently announced device
+    uint64_t now = getMonotonicMs();
+    std::list<GatewayAppIdentifier>::iterator lruIter = m_AnnouncedDevicesLru.end();
+    while (lruIter != m_AnnouncedDevicesLru.begin()) {
+        --lruIter;
+        if (m_AppConnectorIndex.find(*lruIter) != m_AppConnectorIndex.end()) {
+            continue;
+        }
+
+        AnnouncedDeviceState const& state = m_AnnouncedDeviceStates[*lruIter];
+        bool expired = m_AnnouncedDeviceTtlMs && now - state.lastAnnouncedMs >= m_AnnouncedDeviceTtlMs;
+        bool overLimit = m_MaxAnnouncedDevices && unpinned > m_MaxAnnouncedDevices;
+        if (!expired && !overLimit) {
+            break;         //every device left was announced more recently
+        }
 
-    if (m_AutoCommit) {
-        commit();         //update config file
+        GatewayAppIdentifier key = *lruIter++;
+        QCC_DbgPrintf(("Evicting announced device %s", key.getDeviceId().c_str()));
+        removeAnnouncedDevice(key);
+        unpinned--;
+        GatewayStats::getInstance()->increment(GW_STAT_ANNOUNCED_DEVICES_EVICTED);
     }
 }
 
@@ -0,0 +1,191 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <alljoyn/gateway/GatewaySchemaCache.h>
+#include <alljoyn/gateway/GatewayStats.h>
+#include "GatewayConstants.h"
+#include <sys/stat.h>
+
+namespace ajn {
+namespace gw {
+using namespace qcc;
+
+GatewaySchemaCache GatewaySchemaCache::s_Instance;
+
+GatewaySchemaCache::GatewaySchemaCache()
+{
+    pthread_mutex_init(&m_Lock, NULL);
+    pthread_key_create(&m_ThreadContexts, freeThreadContexts);
+}
+
+GatewaySchemaCache::~GatewaySchemaCache()
+{
+    clear();
+    pthread_key_delete(m_ThreadContexts);
+    pthread_mutex_destroy(&m_Lock);
+}
+
+GatewaySchemaCache* GatewaySchemaCache::getInstance()
+{
+    return &s_Instance;
+}
+
+QStatus GatewaySchemaCache::validate(qcc::String const& schemaFileName, xmlDocPtr doc)
+{
+    ThreadContexts* contexts = (ThreadContexts*)pthread_getspecific(m_ThreadContexts);
+    if (!contexts) {
+        contexts = new ThreadContexts();
+        pthread_setspecific(m_ThreadContexts, contexts);
+    }
+
+    Schema* schema = acquire(schemaFileName);
+    if (!schema) {
+        return ER_FAIL;
+    }
+
+    ThreadContext& context = (*contexts)[schemaFileName];
+    if (context.schema == schema) {
+        //the context holds a reference already
+        release(schema);
+    } else {
+        //first validation of this thread, or the schema was recompiled since
+        if (context.schema) {
+            xmlSchemaFreeValidCtxt(context.validCtxt);
+            release(context.schema);
+        }
+        context.schema = schema;
+        context.validCtxt = xmlSchemaNewValidCtxt(schema->schema);
+        if (!context.validCtxt) {
+            QCC_DbgHLPrintf(("Could not create xmlSchemaValidCtxtPtr"));
+            contexts->erase(schemaFileName);
+            release(schema);
+            return ER_FAIL;
+        }
+    }
+
+    int result = xmlSchemaValidateDoc(context.validCtxt, doc);
+    if (result != 0) {
+        QCC_DbgHLPrintf(("Schema Validation failed. result is %i", result));
+        return ER_BUS_BAD_XML;
+    }
+    return ER_OK;
+}
+
+void GatewaySchemaCache::clear()
+{
+    ThreadContexts* contexts = (ThreadContexts*)pthread_getspecific(m_ThreadContexts);
+    if (contexts) {
+        pthread_setspecific(m_ThreadContexts, NULL);
+        freeThreadContexts(contexts);
+    }
+
+    std::map<String, Schema*> schemas;
+    pthread_mutex_lock(&m_Lock);
+    schemas.swap(m_Schemas);
+    pthread_mutex_unlock(&m_Lock);
+
+    std::map<String, Schema*>::iterator iter;
+    for (iter = schemas.begin(); iter != schemas.end(); iter++) {
+        release(iter->second);
+    }
+}
+
+GatewaySchemaCache::Schema* GatewaySchemaCache::acquire(qcc::String const& fileName)
+{
+    //stat before compiling - a change made meanwhile shows up as a newer file next time
+    struct stat st;
+    if (stat(fileName.c_str(), &st) != 0) {
+        QCC_DbgHLPrintf(("Could not stat schema %s", fileName.c_str()));
+        return NULL;
+    }
+    uint64_t mtimeNs = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+
+    pthread_mutex_lock(&m_Lock);
+    std::map<String, Schema*>::iterator iter = m_Schemas.find(fileName);
+    Schema* schema = NULL;
+    if (iter != m_Schemas.end() && iter->second->mtimeNs == mtimeNs && iter->second->size == st.st_size &&
+        iter->second->inode == st.st_ino) {
+        schema = iter->second;
+        schema->refCount++;
+        pthread_mutex_unlock(&m_Lock);
+        return schema;
+    }
+
+    //compiled under the lock, so threads starting together compile it once
+    xmlSchemaParserCtxtPtr parserCtxt = xmlSchemaNewParserCtxt(fileName.c_str());
+    if (parserCtxt == NULL) {
+        pthread_mutex_unlock(&m_Lock);
+        QCC_DbgHLPrintf(("Could not create xmlSchemaParserCtxtPtr"));
+        return NULL;
+    }
+
+    xmlSchemaPtr compiled = xmlSchemaParse(parserCtxt);
+    xmlSchemaFreeParserCtxt(parserCtxt);
+    if (compiled == NULL) {
+        pthread_mutex_unlock(&m_Lock);
+        QCC_DbgHLPrintf(("Could not create xmlSchemaPtr"));
+        return NULL;
+    }
+    GatewayStats::getInstance()->increment(GW_STAT_SCHEMA_COMPILES);
+
+    schema = new Schema();
+    schema->schema = compiled;
+    schema->mtimeNs = mtimeNs;
+    schema->size = st.st_size;
+    schema->inode = st.st_ino;
+    schema->refCount = 2;       //the cache and the caller
+
+    Schema* previous = NULL;
+    if (iter != m_Schemas.end()) {
+        previous = iter->second;
+        iter->second = schema;
+    } else {
+        m_Schemas.insert(std::pair<String, Schema*>(fileName, schema));
+    }
+    pthread_mutex_unlock(&m_Lock);
+
+    //the previous schema lives on until the threads validating with it moved on
+    if (previous) {
+        release(previous);
+    }
+    return schema;
+}
+
+void GatewaySchemaCache::release(Schema* schema)
+{
+    pthread_mutex_lock(&m_Lock);
+    bool unused = --schema->refCount == 0;
+    pthread_mutex_unlock(&m_Lock);
+
+    if (unused) {
+        xmlSchemaFree(schema->schema);
+        delete schema;
+    }
+}
+
+void GatewaySchemaCache::freeThreadContexts(void* contexts)
+{
+    ThreadContexts* threadContexts = (ThreadContexts*)contexts;
+    ThreadContexts::iterator iter;
+    for (iter = threadContexts->begin(); iter != threadContexts->end(); iter++) {
+        xmlSchemaFreeValidCtxt(iter->second.validCtxt);
+        s_Instance.release(iter->second.schema);
+    }
+    delete threadContexts;
+}
+
+} /* namespace gw */
+} /* namespace ajn */
@@ -0,0 +1,345 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <alljoyn/gateway/GatewaySnapshot.h>
+#include <alljoyn/gateway/GatewayPersistenceBatch.h>
+#include "GatewayConstants.h"
+
+namespace ajn {
+namespace gw {
+using namespace qcc;
+
+static const uint32_t SNAPSHOT_MAGIC = 0x53574741; // "AGWS"
+static const size_t SNAPSHOT_HEADER_SIZE = 4 + 4 + 8 + 8;
+
+static uint64_t checksum(const uint8_t* data, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t indx = 0; indx < length; indx++) {
+        hash ^= data[indx];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void append(std::vector<uint8_t>& buffer, const void* data, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + length);
+}
+
+static void appendString(std::vector<uint8_t>& buffer, String const& value)
+{
+    uint32_t length = value.size();
+    append(buffer, &length, sizeof(length));
+    append(buffer, value.data(), length);
+}
+
+/**
+ * State of a file as recorded in the snapshot. Any difference means the file changed
+ */
+struct FileState {
+    uint64_t mtimeNs;
+    uint64_t size;
+    uint64_t inode;
+    uint8_t exists;
+};
+
+static FileState getFileState(String const& fileName)
+{
+    FileState fileState;
+    memset(&fileState, 0, sizeof(fileState));
+
+    struct stat st;
+    if (stat(fileName.c_str(), &st) == 0) {
+        fileState.exists = 1;
+        fileState.mtimeNs = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+        fileState.size = st.st_size;
+        fileState.inode = st.st_ino;
+    }
+    return fileState;
+}
+
+GatewaySnapshot::GatewaySnapshot() : m_NumFiles(0), m_ReadPosition(0), m_Invalid(false)
+{
+}
+
+GatewaySnapshot::~GatewaySnapshot()
+{
+}
+
+void GatewaySnapshot::addFile(String const& fileName)
+{
+    FileState fileState = getFileState(fileName);
+    appendString(m_Files, fileName);
+    append(m_Files, &fileState.exists, sizeof(fileState.exists));
+    append(m_Files, &fileState.mtimeNs, sizeof(fileState.mtimeNs));
+    append(m_Files, &fileState.size, sizeof(fileState.size));
+    append(m_Files, &fileState.inode, sizeof(fileState.inode));
+    m_NumFiles++;
+}
+
+void GatewaySnapshot::putUInt8(uint8_t value)
+{
+    append(m_Data, &value, sizeof(value));
+}
+
+void GatewaySnapshot::putUInt32(uint32_t value)
+{
+    append(m_Data, &value, sizeof(value));
+}
+
+void GatewaySnapshot::putUInt64(uint64_t value)
+{
+    append(m_Data, &value, sizeof(value));
+}
+
+void GatewaySnapshot::putString(String const& value)
+{
+    appendString(m_Data, value);
+}
+
+void GatewaySnapshot::putStrings(std::vector<String> const& values)
+{
+    putUInt32(values.size());
+    for (size_t indx = 0; indx < values.size(); indx++) {
+        putString(values[indx]);
+    }
+}
+
+void GatewaySnapshot::putStringMap(std::map<String, String> const& values)
+{
+    putUInt32(values.size());
+    std::map<String, String>::const_iterator iter;
+    for (iter = values.begin(); iter != values.end(); iter++) {
+        putString(iter->first);
+        putString(iter->second);
+    }
+}
+
+QStatus GatewaySnapshot::save(String const& fileName)
+{
+    std::vector<uint8_t> payload;
+    payload.reserve(sizeof(m_NumFiles) + m_Files.size() + m_Data.size());
+    append(payload, &m_NumFiles, sizeof(m_NumFiles));
+    payload.insert(payload.end(), m_Files.begin(), m_Files.end());
+    payload.insert(payload.end(), m_Data.begin(), m_Data.end());
+
+    uint32_t magic = SNAPSHOT_MAGIC;
+    uint32_t version = VERSION;
+    uint64_t payloadSize = payload.size();
+    uint64_t payloadChecksum = checksum(payload.data(), payload.size());
+
+    std::vector<uint8_t> buffer;
+    buffer.reserve(SNAPSHOT_HEADER_SIZE + payload.size());
+    append(buffer, &magic, sizeof(magic));
+    append(buffer, &version, sizeof(version));
+    append(buffer, &payloadSize, sizeof(payloadSize));
+    append(buffer, &payloadChecksum, sizeof(payloadChecksum));
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+
+    QStatus status = GatewayPersistenceBatch::writeFile(fileName, buffer.data(), buffer.size());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not write snapshot file %s", fileName.c_str()));
+    }
+    return status;
+}
+
+QStatus GatewaySnapshot::load(String const& fileName)
+{
+    QStatus status = ER_FAIL;
+    uint8_t header[SNAPSHOT_HEADER_SIZE];
+    uint32_t magic, version;
+    uint64_t payloadSize, payloadChecksum;
+    struct stat st;
+    size_t readSize = 0;
+
+    m_Data.clear();
+    m_ReadPosition = 0;
+    m_Invalid = false;
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        QCC_DbgPrintf(("No snapshot file %s", fileName.c_str()));
+        return ER_FAIL;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < SNAPSHOT_HEADER_SIZE) {
+        QCC_DbgHLPrintf(("Snapshot file %s is truncated", fileName.c_str()));
+        goto exit;
+    }
+
+    // The whole snapshot is read at once; the header is split off afterwards
+    m_Data.resize(st.st_size);
+    while (readSize < m_Data.size()) {
+        ssize_t ret = read(fd, m_Data.data() + readSize, m_Data.size() - readSize);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            QCC_LogError(ER_OS_ERROR, ("Could not read snapshot file %s: %s", fileName.c_str(), strerror(errno)));
+            goto exit;
+        }
+        readSize += ret;
+    }
+
+    memcpy(header, m_Data.data(), SNAPSHOT_HEADER_SIZE);
+    memcpy(&magic, header, sizeof(magic));
+    memcpy(&version, header + 4, sizeof(version));
+    memcpy(&payloadSize, header + 8, sizeof(payloadSize));
+    memcpy(&payloadChecksum, header + 16, sizeof(payloadChecksum));
+
+    if (magic != SNAPSHOT_MAGIC || version != VERSION) {
+        QCC_DbgHLPrintf(("Snapshot file %s has an unsupported format", fileName.c_str()));
+        goto exit;
+    }
+
+    if (payloadSize != m_Data.size() - SNAPSHOT_HEADER_SIZE ||
+        checksum(m_Data.data() + SNAPSHOT_HEADER_SIZE, payloadSize) != payloadChecksum) {
+        QCC_LogError(ER_FAIL, ("Snapshot file %s is corrupt", fileName.c_str()));
+        goto exit;
+    }
+
+    m_ReadPosition = SNAPSHOT_HEADER_SIZE;
+    if (!checkFiles()) {
+        QCC_DbgHLPrintf(("Snapshot file %s is stale", fileName.c_str()));
+        goto exit;
+    }
+
+    status = ER_OK;
+
+exit:
+    close(fd);
+    if (status != ER_OK) {
+        m_Data.clear();
+        m_ReadPosition = 0;
+        m_Invalid = true;
+    }
+    return status;
+}
+
+bool GatewaySnapshot::checkFiles()
+{
+    uint32_t numFiles = 0;
+    if (!getUInt32(numFiles)) {
+        return false;
+    }
+
+    for (uint32_t indx = 0; indx < numFiles; indx++) {
+        String fileName;
+        FileState recorded;
+        if (!getString(fileName) || !getUInt8(recorded.exists) || !getUInt64(recorded.mtimeNs) ||
+            !getUInt64(recorded.size) || !getUInt64(recorded.inode)) {
+            return false;
+        }
+
+        FileState current = getFileState(fileName);
+        if (current.exists != recorded.exists || current.mtimeNs != recorded.mtimeNs ||
+            current.size != recorded.size || current.inode != recorded.inode) {
+            QCC_DbgPrintf(("File %s changed since the snapshot was taken", fileName.c_str()));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GatewaySnapshot::getBytes(void* data, size_t length)
+{
+    if (m_Invalid || m_Data.size() - m_ReadPosition < length) {
+        m_Invalid = true;
+        return false;
+    }
+    memcpy(data, m_Data.data() + m_ReadPosition, length);
+    m_ReadPosition += length;
+    return true;
+}
+
+bool GatewaySnapshot::getUInt8(uint8_t& value)
+{
+    return getBytes(&value, sizeof(value));
+}
+
+bool GatewaySnapshot::getUInt32(uint32_t& value)
+{
+    return getBytes(&value, sizeof(value));
+}
+
+bool GatewaySnapshot::getUInt64(uint64_t& value)
+{
+    return getBytes(&value, sizeof(value));
+}
+
+bool GatewaySnapshot::getString(String& value)
+{
+    uint32_t length;
+    if (!getUInt32(length)) {
+        return false;
+    }
+    if (m_Invalid || m_Data.size() - m_ReadPosition < length) {
+        m_Invalid = true;
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(m_Data.data() + m_ReadPosition), length);
+    m_ReadPosition += length;
+    return true;
+}
+
+bool GatewaySnapshot::getStrings(std::vector<String>& values)
+{
+    uint32_t count;
+    if (!getUInt32(count)) {
+        return false;
+    }
+    values.clear();
+    for (uint32_t indx = 0; indx < count; indx++) {
+        String value;
+        if (!getString(value)) {
+            return false;
+        }
+        values.push_back(value);
+    }
+    return true;
+}
+
+bool GatewaySnapshot::getStringMap(std::map<String, String>& values)
+{
+    uint32_t count;
+    if (!getUInt32(count)) {
+        return false;
+    }
+    values.clear();
+    for (uint32_t indx = 0; indx < count; indx++) {
+        String key, value;
+        if (!getString(key) || !getString(value)) {
+            return false;
+        }
+        values[key] = value;
+    }
+    return true;
+}
+
+bool GatewaySnapshot::isValid() const
+{
+    return !m_Invalid;
+}
+
+} /* namespace gw */
+} /* namespace ajn */
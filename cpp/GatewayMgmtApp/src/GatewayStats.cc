@@ -0,0 +1,142 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <alljoyn/gateway/GatewayStats.h>
+#include "GatewayConstants.h"
+#include <string.h>
+#include <time.h>
+
+namespace ajn {
+namespace gw {
+
+static const char* const COUNTER_NAMES[GW_STAT_NUM_COUNTERS] = {
+    "PolicyCommits",
+    "PolicyCommitFailures",
+    "PolicyReloads",
+    "PolicyReloadFailures",
+    "PolicyFilesWritten",
+    "PolicyFilesUnchanged",
+    "PolicyBytesWritten",
+    "Announcements",
+    "AnnouncementsUnchanged",
+    "AnnouncedDevicesEvicted",
+    "ConnectorAppExits",
+    "MetadataWrites",
+    "JournalRecords",
+    "JournalSyncs",
+    "JournalCompactions",
+    "AclBodyLoads",
+    "AclBodyEvictions",
+    "SchemaCompiles"
+};
+
+static const char* const HISTOGRAM_NAMES[GW_LATENCY_NUM_HISTOGRAMS] = {
+    "PolicyCommit",
+    "PolicyReload",
+    "MethodCall"
+};
+
+GatewayStats GatewayStats::s_Instance;
+
+GatewayStats::GatewayStats()
+{
+    pthread_mutex_init(&m_Lock, NULL);
+    memset(m_Counters, 0, sizeof(m_Counters));
+    memset(m_Histograms, 0, sizeof(m_Histograms));
+    m_ResetTimeUs = getMonotonicUs();
+}
+
+GatewayStats::~GatewayStats()
+{
+    pthread_mutex_destroy(&m_Lock);
+}
+
+GatewayStats* GatewayStats::getInstance()
+{
+    return &s_Instance;
+}
+
+uint64_t GatewayStats::getMonotonicUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+const char* GatewayStats::getCounterName(GatewayStatsCounter counter)
+{
+    return counter < GW_STAT_NUM_COUNTERS ? COUNTER_NAMES[counter] : "";
+}
+
+const char* GatewayStats::getHistogramName(GatewayStatsHistogram histogram)
+{
+    return histogram < GW_LATENCY_NUM_HISTOGRAMS ? HISTOGRAM_NAMES[histogram] : "";
+}
+
+void GatewayStats::increment(GatewayStatsCounter counter, uint64_t delta)
+{
+    if (counter >= GW_STAT_NUM_COUNTERS) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_Lock);
+    m_Counters[counter] += delta;
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayStats::recordLatency(GatewayStatsHistogram histogram, uint64_t latencyUs)
+{
+    if (histogram >= GW_LATENCY_NUM_HISTOGRAMS) {
+        return;
+    }
+
+    size_t bucket = 0;
+    while (bucket < NUM_BUCKETS - 1 && latencyUs >= ((uint64_t)1 << bucket)) {
+        bucket++;
+    }
+
+    pthread_mutex_lock(&m_Lock);
+    Histogram& entry = m_Histograms[histogram];
+    entry.count++;
+    entry.sumUs += latencyUs;
+    if (latencyUs > entry.maxUs) {
+        entry.maxUs = latencyUs;
+    }
+    entry.buckets[bucket]++;
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayStats::getSnapshot(uint64_t* counters, Histogram* histograms, uint64_t* elapsedMs)
+{
+    pthread_mutex_lock(&m_Lock);
+    memcpy(counters, m_Counters, sizeof(m_Counters));
+    memcpy(histograms, m_Histograms, sizeof(m_Histograms));
+    *elapsedMs = (getMonotonicUs() - m_ResetTimeUs) / 1000;
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayStats::reset()
+{
+    pthread_mutex_lock(&m_Lock);
+    memset(m_Counters, 0, sizeof(m_Counters));
+    memset(m_Histograms, 0, sizeof(m_Histograms));
+    m_ResetTimeUs = getMonotonicUs();
+    pthread_mutex_unlock(&m_Lock);
+    QCC_DbgPrintf(("Gateway statistics were reset"));
+}
+
+} /* namespace gw */
+} /* namespace ajn */
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <alljoyn/gateway/GatewayWorkerPool.h>
+#include "GatewayConstants.h"
+#include <unistd.h>
+
+namespace ajn {
+namespace gw {
+
+static size_t getNumCores()
+{
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return numCores > 0 ? (size_t)numCores : 1;
+}
+
+GatewayWorkerPool::GatewayWorkerPool(size_t numWorkers) : m_NumWorkers(numWorkers ? numWorkers : getNumCores()), m_Task(NULL),
+    m_NumTasks(0), m_NextTask(0), m_Generation(0), m_BusyThreads(0), m_IsStopping(false)
+{
+    pthread_mutex_init(&m_RunLock, NULL);
+    pthread_mutex_init(&m_Lock, NULL);
+    pthread_cond_init(&m_WorkAvailable, NULL);
+    pthread_cond_init(&m_WorkDone, NULL);
+}
+
+GatewayWorkerPool::~GatewayWorkerPool()
+{
+    pthread_mutex_lock(&m_RunLock);
+    stopThreads();
+    pthread_mutex_unlock(&m_RunLock);
+
+    pthread_cond_destroy(&m_WorkDone);
+    pthread_cond_destroy(&m_WorkAvailable);
+    pthread_mutex_destroy(&m_Lock);
+    pthread_mutex_destroy(&m_RunLock);
+}
+
+size_t GatewayWorkerPool::getNumWorkers() const
+{
+    return m_NumWorkers;
+}
+
+void GatewayWorkerPool::setNumWorkers(size_t numWorkers)
+{
+    pthread_mutex_lock(&m_RunLock);
+    stopThreads();
+    m_NumWorkers = numWorkers ? numWorkers : getNumCores();
+    pthread_mutex_unlock(&m_RunLock);
+}
+
+void GatewayWorkerPool::stopThreads()
+{
+    pthread_mutex_lock(&m_Lock);
+    m_IsStopping = true;
+    pthread_cond_broadcast(&m_WorkAvailable);
+    pthread_mutex_unlock(&m_Lock);
+
+    for (size_t i = 0; i < m_Threads.size(); i++) {
+        pthread_join(m_Threads[i].thread, NULL);
+    }
+
+    pthread_mutex_lock(&m_Lock);
+    m_Threads.clear();
+    m_Generation = 0;         //new threads start waiting for the first run again
+    m_IsStopping = false;
+    pthread_mutex_unlock(&m_Lock);
+}
+
+void GatewayWorkerPool::run(GatewayWorkerTask& task, size_t numTasks)
+{
+    pthread_mutex_lock(&m_RunLock);
+    if (m_NumWorkers <= 1 || numTasks <= 1) {
+        for (size_t i = 0; i < numTasks; i++) {
+            task.execute(i, 0);
+        }
+        pthread_mutex_unlock(&m_RunLock);
+        return;
+    }
+
+    pthread_mutex_lock(&m_Lock);
+    if (m_Threads.empty()) {
+        //reserved up front - the threads keep a pointer to their entry
+        m_Threads.reserve(m_NumWorkers - 1);
+        for (size_t i = 1; i < m_NumWorkers; i++) {
+            WorkerThread worker;
+            worker.pool = this;
+            worker.index = i;
+            m_Threads.push_back(worker);
+            if (pthread_create(&m_Threads.back().thread, NULL, WorkerThreadWrapper, &m_Threads.back()) != 0) {
+                QCC_LogError(ER_OS_ERROR, ("Could not start worker thread %u", (uint32_t)i));
+                m_Threads.pop_back();
+                break;
+            }
+        }
+    }
+    m_Task = &task;
+    m_NumTasks = numTasks;
+    m_NextTask = 0;
+    m_BusyThreads = m_Threads.size();
+    m_Generation++;
+    pthread_cond_broadcast(&m_WorkAvailable);
+    pthread_mutex_unlock(&m_Lock);
+
+    executeTasks(0);
+
+    pthread_mutex_lock(&m_Lock);
+    while (m_BusyThreads > 0) {
+        pthread_cond_wait(&m_WorkDone, &m_Lock);
+    }
+    m_Task = NULL;
+    pthread_mutex_unlock(&m_Lock);
+    pthread_mutex_unlock(&m_RunLock);
+}
+
+void GatewayWorkerPool::executeTasks(size_t workerIndex)
+{
+    while (true) {
+        pthread_mutex_lock(&m_Lock);
+        if (m_NextTask >= m_NumTasks) {
+            pthread_mutex_unlock(&m_Lock);
+            return;
+        }
+        size_t taskIndex = m_NextTask++;
+        GatewayWorkerTask* task = m_Task;
+        pthread_mutex_unlock(&m_Lock);
+
+        task->execute(taskIndex, workerIndex);
+    }
+}
+
+void* GatewayWorkerPool::WorkerThreadWrapper(void* context)
+{
+    WorkerThread* worker = reinterpret_cast<WorkerThread*>(context);
+    worker->pool->WorkerThreadLoop(worker->index);
+    return NULL;
+}
+
+void GatewayWorkerPool::WorkerThreadLoop(size_t workerIndex)
+{
+    //threads are started before the first run is published
+    uint64_t generation = 0;
+
+    pthread_mutex_lock(&m_Lock);
+    while (true) {
+        while (!m_IsStopping && m_Generation == generation) {
+            pthread_cond_wait(&m_WorkAvailable, &m_Lock);
+        }
+        if (m_IsStopping) {
+            break;
+        }
+        generation = m_Generation;
+        pthread_mutex_unlock(&m_Lock);
+
+        executeTasks(workerIndex);
+
+        pthread_mutex_lock(&m_Lock);
+        if (--m_BusyThreads == 0) {
+            pthread_cond_signal(&m_WorkDone);
+        }
+    }
+    pthread_mutex_unlock(&m_Lock);
+}
+
+} /* namespace gw */
+} /* namespace ajn */
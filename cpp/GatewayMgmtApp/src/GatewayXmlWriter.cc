@@ -0,0 +1,297 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <string.h>
+#include <alljoyn/gateway/GatewayXmlWriter.h>
+
+namespace ajn {
+namespace gw {
+
+static const char XML_DECLARATION[] = "<?xml version=\"1.0\"?>\n";
+static const char INDENT[] = "  ";
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static bool isXmlText(const char* text)
+{
+    //XML 1.0 has no way to represent the C0 controls other than tab, newline and carriage return
+    for (const unsigned char* current = (const unsigned char*)text; *current; current++) {
+        if (*current < 0x20 && *current != '\t' && *current != '\n' && *current != '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+GatewayXmlWriter::GatewayXmlWriter(size_t initialCapacity)
+{
+    m_Buffer.reserve(initialCapacity);
+}
+
+GatewayXmlWriter::~GatewayXmlWriter()
+{
+}
+
+void GatewayXmlWriter::reset()
+{
+    m_Buffer.clear();
+    m_OpenElements.clear();
+    m_Names.clear();
+}
+
+int GatewayXmlWriter::startDocument()
+{
+    if (m_Buffer.size()) {
+        return -1;
+    }
+    m_Buffer.append(XML_DECLARATION, sizeof(XML_DECLARATION) - 1);
+    return 0;
+}
+
+int GatewayXmlWriter::writeComment(const char* comment)
+{
+    if (!comment) {
+        return -1;
+    }
+    closeStartTag();
+    writeIndent();
+    m_Buffer.append("<!--", 4);
+    m_Buffer.append(comment);
+    m_Buffer.append("-->\n", 4);
+    return 0;
+}
+
+int GatewayXmlWriter::startElement(const char* name)
+{
+    if (!name || !*name) {
+        return -1;
+    }
+    closeStartTag();
+    writeIndent();
+
+    OpenElement element;
+    element.nameOffset = m_Names.size();
+    element.nameLength = strlen(name);
+    element.startTagOpen = true;
+    m_Names.append(name, element.nameLength);
+    m_OpenElements.push_back(element);
+
+    m_Buffer.push_back('<');
+    m_Buffer.append(name, element.nameLength);
+    return 0;
+}
+
+int GatewayXmlWriter::writeAttribute(const char* name, const char* value)
+{
+    if (!name || !value || m_OpenElements.empty() || !m_OpenElements.back().startTagOpen || !isXmlText(value)) {
+        return -1;
+    }
+    m_Buffer.push_back(' ');
+    m_Buffer.append(name);
+    m_Buffer.append("=\"", 2);
+    writeEscaped(value, true);
+    m_Buffer.push_back('"');
+    return 0;
+}
+
+int GatewayXmlWriter::writeElement(const char* name, const char* content)
+{
+    if (!content || !isXmlText(content)) {
+        return -1;
+    }
+    int rc = startElement(name);
+    if (rc < 0) {
+        return rc;
+    }
+    if (!*content) {
+        return endElement();         //empty elements are written as <name/>
+    }
+
+    OpenElement& element = m_OpenElements.back();
+    m_Buffer.push_back('>');
+    writeEscaped(content, false);
+    m_Buffer.append("</", 2);
+    m_Buffer.append(name, element.nameLength);
+    m_Buffer.append(">\n", 2);
+
+    m_Names.resize(element.nameOffset);
+    m_OpenElements.pop_back();
+    return 0;
+}
+
+int GatewayXmlWriter::endElement()
+{
+    if (m_OpenElements.empty()) {
+        return -1;
+    }
+
+    OpenElement element = m_OpenElements.back();
+    m_OpenElements.pop_back();
+    if (element.startTagOpen) {
+        m_Buffer.append("/>\n", 3);
+    } else {
+        writeIndent();
+        m_Buffer.append("</", 2);
+        m_Buffer.append(m_Names, element.nameOffset, element.nameLength);
+        m_Buffer.append(">\n", 2);
+    }
+    m_Names.resize(element.nameOffset);
+    return 0;
+}
+
+int GatewayXmlWriter::endDocument()
+{
+    while (!m_OpenElements.empty()) {
+        int rc = endElement();
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+int GatewayXmlWriter::writeRaw(const char* data, size_t length)
+{
+    if (!data && length) {
+        return -1;
+    }
+    if (!length) {
+        return 0;         //an empty start tag stays open so it can still be written as <name/>
+    }
+    closeStartTag();
+    m_Buffer.append(data, length);
+    return 0;
+}
+
+bool GatewayXmlWriter::isStartTagOpen() const
+{
+    return !m_OpenElements.empty() && m_OpenElements.back().startTagOpen;
+}
+
+const char* GatewayXmlWriter::getData() const
+{
+    return m_Buffer.data();
+}
+
+size_t GatewayXmlWriter::getSize() const
+{
+    return m_Buffer.size();
+}
+
+void GatewayXmlWriter::closeStartTag()
+{
+    if (!m_OpenElements.empty() && m_OpenElements.back().startTagOpen) {
+        m_Buffer.append(">\n", 2);
+        m_OpenElements.back().startTagOpen = false;
+    }
+}
+
+void GatewayXmlWriter::writeIndent()
+{
+    for (size_t depth = 0; depth < m_OpenElements.size(); depth++) {
+        m_Buffer.append(INDENT, sizeof(INDENT) - 1);
+    }
+}
+
+void GatewayXmlWriter::writeEscaped(const char* text, bool inAttribute)
+{
+    const unsigned char* current = (const unsigned char*)text;
+    const unsigned char* runStart = current;
+
+    while (*current) {
+        unsigned char c = *current;
+        const char* entity = NULL;
+        switch (c) {
+        case '&':
+            entity = "&amp;";
+            break;
+
+        case '<':
+            entity = "&lt;";
+            break;
+
+        case '>':
+            entity = "&gt;";
+            break;
+
+        case '"':
+            entity = inAttribute ? "&quot;" : NULL;
+            break;
+
+        case '\t':
+            entity = inAttribute ? "&#9;" : NULL;
+            break;
+
+        case '\n':
+            entity = inAttribute ? "&#10;" : NULL;
+            break;
+
+        case '\r':
+            entity = inAttribute ? "&#13;" : "&#xD;";
+            break;
+
+        default:
+            break;
+        }
+
+        if (entity) {
+            m_Buffer.append((const char*)runStart, current - runStart);
+            m_Buffer.append(entity);
+            current++;
+            runStart = current;
+            continue;
+        }
+
+        if (c < 0x80) {
+            current++;
+            continue;
+        }
+
+        //non ascii characters are written as character references, like libxml2 does without an encoding
+        m_Buffer.append((const char*)runStart, current - runStart);
+        uint32_t codePoint = c;
+        size_t extraBytes = 0;
+        if ((c & 0xE0) == 0xC0) {
+            codePoint = c & 0x1F;
+            extraBytes = 1;
+        } else if ((c & 0xF0) == 0xE0) {
+            codePoint = c & 0x0F;
+            extraBytes = 2;
+        } else if ((c & 0xF8) == 0xF0) {
+            codePoint = c & 0x07;
+            extraBytes = 3;
+        }
+        current++;
+        for (size_t indx = 0; indx < extraBytes && (*current & 0xC0) == 0x80; indx++) {
+            codePoint = (codePoint << 6) | (*current & 0x3F);
+            current++;
+        }
+
+        char reference[16];
+        size_t length = sizeof(reference);
+        reference[--length] = ';';
+        do {
+            reference[--length] = HEX_DIGITS[codePoint & 0xF];
+            codePoint >>= 4;
+        } while (codePoint);
+        m_Buffer.append("&#x", 3);
+        m_Buffer.append(reference + length, sizeof(reference) - length);
+        runStart = current;
+    }
+    m_Buffer.append((const char*)runStart, current - runStart);
+}
+
+} /* namespace gw */
+} /* namespace ajn */
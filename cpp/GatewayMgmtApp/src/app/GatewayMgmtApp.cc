@@ -23,6 +23,7 @@
 #include <alljoyn/gateway/common/AJInitializer.h>
 #include <alljoyn/gateway/common/SrpKeyXListener.h>
 #include <alljoyn/services_common/GuidUtil.h>
+#include <qcc/StringUtil.h>
 #include <string.h>
 #include <signal.h>
 #include <fstream>
@@ -226,6 +227,17 @@ qcc::String policyFileOption = "--gwagent-policy-file=";
 qcc::String appsPolicyDirOption = "--apps-policy-dir=";
 qcc::String routingNodeConfigFileOption = "--config-file=";
 qcc::String gwMgmtAppConfigPathOption = "--gwagent-config-file=";
+qcc::String policyCommitWindowOption = "--policy-commit-window-ms=";
+qcc::String policyCommitMaxLatencyOption = "--policy-commit-max-latency-ms=";
+qcc::String maxAnnouncedDevicesOption = "--max-announced-devices=";
+qcc::String announcedDeviceTtlOption = "--announced-device-ttl-ms=";
+qcc::String aclPolicyFragmentsOption = "--acl-policy-fragments";
+qcc::String unannouncedAclsOption = "--unannounced-acls";
+qcc::String snapshotOption = "--snapshot";
+qcc::String aclJournalOption = "--acl-journal";
+qcc::String lazyAclBodiesOption = "--lazy-acl-bodies";
+qcc::String startupThreadsOption = "--startup-threads=";
+qcc::String maxInactiveAclBodiesOption = "--max-inactive-acl-bodies=";
 
 int main(int argc, char** argv)
 {
@@ -248,6 +260,12 @@ start:
     // Initialize GatewayMgmtAppConfig object
     appConfig = new GatewayMgmtAppConfig;
     qcc::String gwMgmtAppConfig = gwConsts::GATEWAY_DEFAULT_MGMT_APP_CONF_PATH;
+    uint32_t policyCommitWindowMs = gwConsts::GATEWAY_POLICY_COMMIT_WINDOW_MS;
+    uint32_t policyCommitMaxLatencyMs = gwConsts::GATEWAY_POLICY_COMMIT_MAX_LATENCY_MS;
+    uint32_t maxAnnouncedDevices = gwConsts::GATEWAY_MAX_ANNOUNCED_DEVICES;
+    uint32_t announcedDeviceTtlMs = gwConsts::GATEWAY_ANNOUNCED_DEVICE_TTL_MS;
+    bool lazyAclBodies = false;
+    uint32_t maxInactiveAclBodies = gwConsts::GATEWAY_MAX_INACTIVE_ACL_BODIES;
     for (int i = 1; i < argc; i++) {
         qcc::String arg(argv[i]);
         if (arg.compare(0, policyFileOption.size(), policyFileOption) == 0) {
@@ -264,7 +282,55 @@ start:
             gwMgmtAppConfig = arg.substr(gwMgmtAppConfigPathOption.size());
             QCC_DbgPrintf(("Setting gwMgmtAppConfig to: %s", gwMgmtAppConfig.c_str()));
         }
+        if (arg.compare(0, policyCommitWindowOption.size(), policyCommitWindowOption) == 0) {
+            policyCommitWindowMs = qcc::StringToU32(arg.substr(policyCommitWindowOption.size()), 10, policyCommitWindowMs);
+            QCC_DbgPrintf(("Setting policyCommitWindow to: %u ms", policyCommitWindowMs));
+        }
+        if (arg.compare(0, policyCommitMaxLatencyOption.size(), policyCommitMaxLatencyOption) == 0) {
+            policyCommitMaxLatencyMs = qcc::StringToU32(arg.substr(policyCommitMaxLatencyOption.size()), 10, policyCommitMaxLatencyMs);
+            QCC_DbgPrintf(("Setting policyCommitMaxLatency to: %u ms", policyCommitMaxLatencyMs));
+        }
+        if (arg.compare(0, maxAnnouncedDevicesOption.size(), maxAnnouncedDevicesOption) == 0) {
+            maxAnnouncedDevices = qcc::StringToU32(arg.substr(maxAnnouncedDevicesOption.size()), 10, maxAnnouncedDevices);
+            QCC_DbgPrintf(("Setting maxAnnouncedDevices to: %u", maxAnnouncedDevices));
+        }
+        if (arg.compare(0, announcedDeviceTtlOption.size(), announcedDeviceTtlOption) == 0) {
+            announcedDeviceTtlMs = qcc::StringToU32(arg.substr(announcedDeviceTtlOption.size()), 10, announcedDeviceTtlMs);
+            QCC_DbgPrintf(("Setting announcedDeviceTtl to: %u ms", announcedDeviceTtlMs));
+        }
+        if (arg.compare(aclPolicyFragmentsOption) == 0) {
+            QCC_DbgPrintf(("Writing a policy fragment per acl"));
+            gatewayMgmt->setAclPolicyFragments(true);
+        }
+        if (arg.compare(unannouncedAclsOption) == 0) {
+            QCC_DbgPrintf(("Not announcing the acls"));
+            gatewayMgmt->setAclsUnannounced(true);
+        }
+        if (arg.compare(snapshotOption) == 0) {
+            QCC_DbgPrintf(("Using the startup snapshot"));
+            gatewayMgmt->setSnapshotEnabled(true);
+        }
+        if (arg.compare(aclJournalOption) == 0) {
+            QCC_DbgPrintf(("Journaling the acl and metadata changes"));
+            gatewayMgmt->setAclJournal(true);
+        }
+        if (arg.compare(0, startupThreadsOption.size(), startupThreadsOption) == 0) {
+            uint32_t startupThreads = qcc::StringToU32(arg.substr(startupThreadsOption.size()), 10, gwConsts::GATEWAY_STARTUP_THREADS);
+            QCC_DbgPrintf(("Setting startupThreads to: %u", startupThreads));
+            gatewayMgmt->setStartupThreads(startupThreads);
+        }
+        if (arg.compare(lazyAclBodiesOption) == 0) {
+            QCC_DbgPrintf(("Parsing the acl rules on first access"));
+            lazyAclBodies = true;
+        }
+        if (arg.compare(0, maxInactiveAclBodiesOption.size(), maxInactiveAclBodiesOption) == 0) {
+            maxInactiveAclBodies = qcc::StringToU32(arg.substr(maxInactiveAclBodiesOption.size()), 10, maxInactiveAclBodies);
+            QCC_DbgPrintf(("Setting maxInactiveAclBodies to: %u", maxInactiveAclBodies));
+        }
     }
+    gatewayMgmt->setPolicyCommitWindow(policyCommitWindowMs, policyCommitMaxLatencyMs);
+    gatewayMgmt->setAnnouncedDevicesLimit(maxAnnouncedDevices, announcedDeviceTtlMs);
+    gatewayMgmt->setLazyAclBodies(lazyAclBodies, maxInactiveAclBodies);
 
     appConfig->loadFromFile(gwMgmtAppConfig);
 
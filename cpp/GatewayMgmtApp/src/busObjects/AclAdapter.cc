@@ -231,7 +231,9 @@ QStatus AclAdapter::marshalAcl(GatewayAcl* acl, ajn::MsgArg* msgArg)
         return status;
     }
 
-    const GatewayRuleObjectDescriptions& exposedServices = acl->getAclRules().getExposedServicesRules();
+    //copies, the rules of an inactive acl may be evicted meanwhile
+    const GatewayAclRules aclRules = acl->getAclRules();
+    const GatewayRuleObjectDescriptions& exposedServices = aclRules.getExposedServicesRules();
     MsgArg* exposedServicesArray = new MsgArg[exposedServices.size()];
     size_t exposedServicesIndx = 0;
 
@@ -248,7 +250,7 @@ QStatus AclAdapter::marshalAcl(GatewayAcl* acl, ajn::MsgArg* msgArg)
     }
     msgArg[indx++].SetOwnershipFlags(MsgArg::OwnsArgs, true);
 
-    const GatewayRemoteAppRules& remoteAppPerm = acl->getAclRules().getRemoteAppRules();
+    const GatewayRemoteAppRules& remoteAppPerm = aclRules.getRemoteAppRules();
     GatewayRemoteAppRules::const_iterator it;
 
     MsgArg* remoteAppPermsArray = new MsgArg[remoteAppPerm.size()];
@@ -303,7 +305,7 @@ QStatus AclAdapter::marshalAcl(GatewayAcl* acl, ajn::MsgArg* msgArg)
     }
     msgArg[indx++].SetOwnershipFlags(MsgArg::OwnsArgs, true);
 
-    const std::map<qcc::String, qcc::String>& customMetadata = acl->getCustomMetadata();
+    const std::map<qcc::String, qcc::String> customMetadata = acl->getCustomMetadata();
     MsgArg* customMetadataArray = new MsgArg[customMetadata.size()];
     size_t customMetadataIndx = 0;
 
@@ -326,69 +328,55 @@ QStatus AclAdapter::marshalAcl(GatewayAcl* acl, ajn::MsgArg* msgArg)
 QStatus AclAdapter::marshalMergedAcl(std::map<qcc::String, GatewayAcl*> const& acls, ajn::MsgArg* msgArg)
 {
     QStatus status = ER_OK;
-    size_t exposedServicesSize = 0;
-    size_t remotedAppsSize = 0;
+    GatewayAclRules mergedRules;
     std::map<qcc::String, GatewayAcl*>::const_iterator it;
     for (it = acls.begin(); it != acls.end(); it++) {
 
         if (it->second->getAclStatus() != GW_AS_ACTIVE) {
             continue;
         }
-        exposedServicesSize += it->second->getAclRules().getExposedServicesRules().size();
-        remotedAppsSize += it->second->getAclRules().getRemoteAppRules().size();
+        mergedRules.addRules(it->second->getAclRules());
     }
+    mergedRules.normalize();
 
-    MsgArg* exposedServicesArray = new MsgArg[exposedServicesSize];
+    const GatewayRuleObjectDescriptions& exposedServices = mergedRules.getExposedServicesRules();
+    const GatewayRemoteAppRules& remoteAppRules = mergedRules.getRemoteAppRules();
+
+    MsgArg* exposedServicesArray = new MsgArg[exposedServices.size()];
     size_t exposedServicesIndx = 0;
-    MsgArg* remoteAppPermsArray = new MsgArg[remotedAppsSize];
+    MsgArg* remoteAppPermsArray = new MsgArg[remoteAppRules.size()];
     size_t remoteAppPermsIndx = 0;
 
-    for (it = acls.begin(); it != acls.end(); it++) {
+    status = marshalObjectDesciptions(exposedServices, exposedServicesArray, &exposedServicesIndx);
+    if (status != ER_OK) {
+        delete[] exposedServicesArray;
+        delete[] remoteAppPermsArray;
+        return status;
+    }
 
-        if (it->second->getAclStatus() != GW_AS_ACTIVE) {
-            continue;
-        }
+    GatewayRemoteAppRules::const_iterator iter;
+    for (iter = remoteAppRules.begin(); iter != remoteAppRules.end(); iter++) {
 
-        const GatewayRuleObjectDescriptions& exposedServices = it->second->getAclRules().getExposedServicesRules();
-        status = marshalObjectDesciptions(exposedServices, exposedServicesArray, &exposedServicesIndx);
+        MsgArg* remotedObjectsArray = new MsgArg[iter->second.size()];
+        size_t remotedObjectsIndx = 0;
+        status = marshalObjectDesciptions(iter->second, remotedObjectsArray, &remotedObjectsIndx);
         if (status != ER_OK) {
             delete[] exposedServicesArray;
             delete[] remoteAppPermsArray;
+            delete[] remotedObjectsArray;
             return status;
         }
 
-        const GatewayRemoteAppRules& remoteAppRules = it->second->getAclRules().getRemoteAppRules();
-        GatewayRemoteAppRules::const_iterator iter;
-
-        for (iter = remoteAppRules.begin(); iter != remoteAppRules.end(); iter++) {
-
-            if (status != ER_OK) {
-                delete[] exposedServicesArray;
-                delete[] remoteAppPermsArray;
-                return status;
-            }
-
-            MsgArg* remotedObjectsArray = new MsgArg[iter->second.size()];
-            size_t remotedObjectsIndx = 0;
-            status = marshalObjectDesciptions(iter->second, remotedObjectsArray, &remotedObjectsIndx);
-            if (status != ER_OK) {
-                delete[] exposedServicesArray;
-                delete[] remoteAppPermsArray;
-                delete[] remotedObjectsArray;
-                return status;
-            }
-
-            status = remoteAppPermsArray[remoteAppPermsIndx].Set(AJPARAM_REMOTED_APPS.c_str(), iter->first.getDeviceId().c_str(),
-                                                                 iter->first.getAppIdHexLength(), iter->first.getAppIdHex(),
-                                                                 remotedObjectsIndx, remotedObjectsArray);
-            if (status != ER_OK) {
-                delete[] exposedServicesArray;
-                delete[] remoteAppPermsArray;
-                delete[] remotedObjectsArray;
-                return status;
-            }
-            remoteAppPermsArray[remoteAppPermsIndx++].SetOwnershipFlags(MsgArg::OwnsArgs, true);
+        status = remoteAppPermsArray[remoteAppPermsIndx].Set(AJPARAM_REMOTED_APPS.c_str(), iter->first.getDeviceId().c_str(),
+                                                             iter->first.getAppIdHexLength(), iter->first.getAppIdHex(),
+                                                             remotedObjectsIndx, remotedObjectsArray);
+        if (status != ER_OK) {
+            delete[] exposedServicesArray;
+            delete[] remoteAppPermsArray;
+            delete[] remotedObjectsArray;
+            return status;
         }
+        remoteAppPermsArray[remoteAppPermsIndx++].SetOwnershipFlags(MsgArg::OwnsArgs, true);
     }
 
     status = msgArg[0].Set(AJPARAM_INTERFACE_INFO_ARRAY.c_str(), exposedServicesIndx, exposedServicesArray);
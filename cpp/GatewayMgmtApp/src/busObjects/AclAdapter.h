@@ -78,7 +78,7 @@ class AclAdapter {
     static QStatus marshalAcl(GatewayAcl* acl, ajn::MsgArg* msgArg);
 
     /**
-     * MarshalMergedAcl - marshal a combination of all the active acls
+     * MarshalMergedAcl - marshal the normalized combination of all the active acls
      * @param acls - array of acls to possibly marshal
      * @param msgArg - msgArg to fill
      * @return status - success/failure
@@ -18,129 +18,142 @@
 #include "../GatewayConstants.h"
 #include "AclAdapter.h"
 #include <alljoyn/gateway/GatewayMgmt.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayStats.h>
 
 namespace ajn {
 namespace gw {
 using namespace qcc;
 using namespace gwConsts;
 
-AclBusObject::AclBusObject(BusAttachment* bus, GatewayAcl* acl, String const& objectPath, QStatus* status) :
-    BusObject(objectPath.c_str()), m_Acl(acl), m_ObjectPath(objectPath)
+AclBusObject::AclBusObject(BusAttachment* bus, GatewayAcl* acl, String const& objectPath, AnnounceFlag announceFlag, QStatus* status) :
+    BusObject(objectPath.c_str()), m_Acl(acl)
 {
+    *status = addAclInterface(bus, announceFlag);
+    if (*status != ER_OK) {
+        return;
+    }
+    QCC_DbgTrace(("Created GatewayAclBusObject successfully"));
+}
+
+AclBusObject::~AclBusObject()
+{
+}
+
+QStatus AclBusObject::addAclInterface(BusAttachment* bus, AnnounceFlag announceFlag)
+{
+    QStatus status = ER_OK;
+    const ajn::InterfaceDescription::Member* methodMember;
     InterfaceDescription* interfaceDescription = (InterfaceDescription*) bus->GetInterface(AJ_GW_ACL_INTERFACE.c_str());
     if (!interfaceDescription) {
-        *status = bus->CreateInterface(AJ_GW_ACL_INTERFACE.c_str(), interfaceDescription, true);
-        if (*status != ER_OK) {
+        status = bus->CreateInterface(AJ_GW_ACL_INTERFACE.c_str(), interfaceDescription, true);
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddProperty(AJ_PROPERTY_VERSION.c_str(), AJPARAM_UINT16.c_str(), PROP_ACCESS_READ);
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddProperty(AJ_PROPERTY_VERSION.c_str(), AJPARAM_UINT16.c_str(), PROP_ACCESS_READ);
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_ACTIVATE_ACL.c_str(), AJ_ACTIVATE_ACL_PARAMS_IN.c_str(),
-                                                  AJ_ACTIVATE_ACL_PARAMS_OUT.c_str(), AJ_ACTIVATE_ACL_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_ACTIVATE_ACL.c_str(), AJ_ACTIVATE_ACL_PARAMS_IN.c_str(),
+                                                 AJ_ACTIVATE_ACL_PARAMS_OUT.c_str(), AJ_ACTIVATE_ACL_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_GET_ACL.c_str(), AJ_GET_ACL_PARAMS_IN.c_str(),
-                                                  AJ_GET_ACL_PARAMS_OUT.c_str(), AJ_GET_ACL_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_GET_ACL.c_str(), AJ_GET_ACL_PARAMS_IN.c_str(),
+                                                 AJ_GET_ACL_PARAMS_OUT.c_str(), AJ_GET_ACL_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_GET_ACL_STATUS.c_str(), AJ_GET_ACL_STATUS_PARAMS_IN.c_str(),
-                                                  AJ_GET_ACL_STATUS_PARAMS_OUT.c_str(), AJ_GET_ACL_STATUS_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_GET_ACL_STATUS.c_str(), AJ_GET_ACL_STATUS_PARAMS_IN.c_str(),
+                                                 AJ_GET_ACL_STATUS_PARAMS_OUT.c_str(), AJ_GET_ACL_STATUS_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_UPDATE_ACL.c_str(), AJ_UPDATE_ACL_PARAMS_IN.c_str(),
-                                                  AJ_UPDATE_ACL_PARAMS_OUT.c_str(), AJ_UPDATE_ACL_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_UPDATE_ACL.c_str(), AJ_UPDATE_ACL_PARAMS_IN.c_str(),
+                                                 AJ_UPDATE_ACL_PARAMS_OUT.c_str(), AJ_UPDATE_ACL_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_UPDATE_METADATA.c_str(), AJ_UPDATE_METADATA_PARAMS_IN.c_str(),
-                                                  AJ_UPDATE_METADATA_PARAMS_OUT.c_str(), AJ_UPDATE_METADATA_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_UPDATE_METADATA.c_str(), AJ_UPDATE_METADATA_PARAMS_IN.c_str(),
+                                                 AJ_UPDATE_METADATA_PARAMS_OUT.c_str(), AJ_UPDATE_METADATA_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_UPDATE_CUSTOM_METADATA.c_str(), AJ_UPDATE_METADATA_PARAMS_IN.c_str(),
-                                                  AJ_UPDATE_METADATA_PARAMS_OUT.c_str(), AJ_UPDATE_METADATA_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_UPDATE_CUSTOM_METADATA.c_str(), AJ_UPDATE_METADATA_PARAMS_IN.c_str(),
+                                                 AJ_UPDATE_METADATA_PARAMS_OUT.c_str(), AJ_UPDATE_METADATA_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
-        *status = interfaceDescription->AddMethod(AJ_METHOD_DEACTIVATE_ACL.c_str(), AJ_DEACTIVATE_ACL_PARAMS_IN.c_str(),
-                                                  AJ_DEACTIVATE_ACL_PARAMS_OUT.c_str(), AJ_DEACTIVATE_ACL_PARAM_NAMES.c_str());
-        if (*status != ER_OK) {
+        status = interfaceDescription->AddMethod(AJ_METHOD_DEACTIVATE_ACL.c_str(), AJ_DEACTIVATE_ACL_PARAMS_IN.c_str(),
+                                                 AJ_DEACTIVATE_ACL_PARAMS_OUT.c_str(), AJ_DEACTIVATE_ACL_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
             goto postCreate;
         }
         interfaceDescription->Activate();
     }
 
 postCreate:
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not create interface"));
-        return;
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not create interface"));
+        return status;
     }
 
-    *status = AddInterface(*interfaceDescription, ANNOUNCED);
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not add interface"));
-        return;
+    status = AddInterface(*interfaceDescription, announceFlag);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not add interface"));
+        return status;
     }
 
-    const ajn::InterfaceDescription::Member* methodMember = interfaceDescription->GetMember(AJ_METHOD_ACTIVATE_ACL.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::ActivateAcl));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the ActivateAcl MethodHandler"));
-        return;
+    methodMember = interfaceDescription->GetMember(AJ_METHOD_ACTIVATE_ACL.c_str());
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::ActivateAcl));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the ActivateAcl MethodHandler"));
+        return status;
     }
 
     methodMember = interfaceDescription->GetMember(AJ_METHOD_GET_ACL.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::GetAcl));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the GetAcl MethodHandler"));
-        return;
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::GetAcl));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the GetAcl MethodHandler"));
+        return status;
     }
 
     methodMember = interfaceDescription->GetMember(AJ_METHOD_GET_ACL_STATUS.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::GetAclStatus));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the GetAclStatus MethodHandler"));
-        return;
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::GetAclStatus));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the GetAclStatus MethodHandler"));
+        return status;
     }
 
     methodMember = interfaceDescription->GetMember(AJ_METHOD_UPDATE_ACL.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::UpdateAcl));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the UpdateAcl MethodHandler"));
-        return;
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::UpdateAcl));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the UpdateAcl MethodHandler"));
+        return status;
     }
 
     methodMember = interfaceDescription->GetMember(AJ_METHOD_UPDATE_METADATA.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::UpdateMetadata));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the UpdateMetadata MethodHandler"));
-        return;
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::UpdateMetadata));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the UpdateMetadata MethodHandler"));
+        return status;
     }
 
     methodMember = interfaceDescription->GetMember(AJ_METHOD_UPDATE_CUSTOM_METADATA.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::UpdateCustomMetadata));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the UpdateCustomMetadata MethodHandler"));
-        return;
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::UpdateCustomMetadata));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the UpdateCustomMetadata MethodHandler"));
+        return status;
     }
 
     methodMember = interfaceDescription->GetMember(AJ_METHOD_DEACTIVATE_ACL.c_str());
-    *status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::DeactivateAcl));
-    if (*status != ER_OK) {
-        QCC_LogError(*status, ("Could not register the DeactivateAcl MethodHandler"));
-        return;
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AclBusObject::DeactivateAcl));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the DeactivateAcl MethodHandler"));
+        return status;
     }
 
-    QCC_DbgTrace(("Created GatewayAclBusObject successfully"));
-}
-
-AclBusObject::~AclBusObject()
-{
+    return status;
 }
 
 QStatus AclBusObject::Get(const char* interfaceName, const char* propName, MsgArg& val)
@@ -167,27 +180,17 @@ QStatus AclBusObject::Set(const char* interfaceName, const char* propName, MsgAr
 void AclBusObject::ActivateAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received ActivateAcl method call"));
     uint16_t responseCode = m_Acl->updateAclStatus(GW_AS_ACTIVE);
-
-    ajn::MsgArg replyArg[1];
-    QStatus status = replyArg[0].Set(AJPARAM_UINT16.c_str(), responseCode);
-    if (status != ER_OK) {
-        QCC_LogError(status, ("Could not marshal responseCode for ActivateAcl method"));
-        MethodReply(msg, status);
-        return;
-    }
-
-    status = MethodReply(msg, replyArg, 1);
-    if (status != ER_OK) {
-        QCC_LogError(status, ("ActivateAcl reply call failed"));
-    }
+    replyWhenCommitted(msg, responseCode, "ActivateAcl");
 }
 
 void AclBusObject::GetAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetAcl method call"));
 
@@ -208,6 +211,7 @@ void AclBusObject::GetAcl(const InterfaceDescription::Member* member, Message& m
 void AclBusObject::GetAclStatus(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetAclStatus method call"));
 
@@ -228,6 +232,7 @@ void AclBusObject::GetAclStatus(const InterfaceDescription::Member* member, Mess
 void AclBusObject::UpdateAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received UpdateAcl method call"));
 
@@ -243,24 +248,13 @@ void AclBusObject::UpdateAcl(const InterfaceDescription::Member* member, Message
     }
 
     uint16_t responseCode = m_Acl->updateAcl(aclName, aclRules, metadata, customMetadata);
-
-    ajn::MsgArg replyArg[1];
-    status = replyArg[0].Set(AJPARAM_UINT16.c_str(), responseCode);
-    if (status != ER_OK) {
-        QCC_LogError(status, ("Could not marshal responseCode for UpdateAcl method"));
-        MethodReply(msg, status);
-        return;
-    }
-
-    status = MethodReply(msg, replyArg, 1);
-    if (status != ER_OK) {
-        QCC_LogError(status, ("UpdateAcl reply call failed"));
-    }
+    replyWhenCommitted(msg, responseCode, "UpdateAcl");
 }
 
 void AclBusObject::UpdateMetadata(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received UpdateMetadata method call"));
 
@@ -299,6 +293,7 @@ void AclBusObject::UpdateMetadata(const InterfaceDescription::Member* member, Me
 void AclBusObject::UpdateCustomMetadata(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received UpdateCustomMetadata method call"));
 
@@ -337,25 +332,52 @@ void AclBusObject::UpdateCustomMetadata(const InterfaceDescription::Member* memb
 void AclBusObject::DeactivateAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
     QCC_DbgTrace(("Received DeactivateAcl method call"));
     uint16_t responseCode = m_Acl->updateAclStatus(GW_AS_INACTIVE);
+    replyWhenCommitted(msg, responseCode, "DeactivateAcl");
+}
+
+void AclBusObject::replyWhenCommitted(Message& msg, uint16_t responseCode, const char* methodName)
+{
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (responseCode != GW_ACL_RC_SUCCESS || !policyManager) {
+        replyResponseCode(msg, responseCode, methodName);
+        return;
+    }
+    policyManager->notifyWhenCommitted(new CommitReply(this, msg, methodName));
+}
 
+void AclBusObject::replyResponseCode(Message& msg, uint16_t responseCode, const char* methodName)
+{
     ajn::MsgArg replyArg[1];
     QStatus status = replyArg[0].Set(AJPARAM_UINT16.c_str(), responseCode);
     if (status != ER_OK) {
-        QCC_LogError(status, ("Could not marshal responseCode for DeactivateAcl method"));
+        QCC_LogError(status, ("Could not marshal responseCode for %s method", methodName));
         MethodReply(msg, status);
         return;
     }
 
     status = MethodReply(msg, replyArg, 1);
     if (status != ER_OK) {
-        QCC_LogError(status, ("DeactivateAcl reply call failed"));
+        QCC_LogError(status, ("%s reply call failed", methodName));
+    }
+}
+
+AclBusObject::CommitReply::CommitReply(AclBusObject* busObject, Message& msg, const char* methodName) :
+    m_BusObject(busObject), m_Msg(msg), m_MethodName(methodName)
+{
+}
+
+void AclBusObject::CommitReply::policiesCommitted(QStatus status)
+{
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not commit the policies for %s method", m_MethodName));
     }
+    m_BusObject->replyResponseCode(m_Msg, status == ER_OK ? GW_ACL_RC_SUCCESS : GW_ACL_RC_POLICYMANAGER_ERROR, m_MethodName);
 }
 
 } /* namespace gw */
 } /* namespace ajn */
 
 
-
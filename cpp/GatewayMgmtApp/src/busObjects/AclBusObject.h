@@ -21,6 +21,7 @@
 #include <alljoyn/BusObject.h>
 #include <alljoyn/InterfaceDescription.h>
 #include <alljoyn/gateway/GatewayAcl.h>
+#include <alljoyn/gateway/GatewayPolicyCommitListener.h>
 
 namespace ajn {
 namespace gw {
@@ -34,10 +35,12 @@ class AclBusObject : public BusObject  {
     /**
      * Constructor for GatewayAclBusObject class
      * @param bus - the bus to create the interface
+     * @param acl - the Acl of the BusObject
      * @param objectPath - objectPath of BusObject
+     * @param announceFlag - whether the Acl interface is announced
      * @param status - success/failure
      */
-    AclBusObject(BusAttachment* bus, GatewayAcl* acl, qcc::String const& objectPath, QStatus* status);
+    AclBusObject(BusAttachment* bus, GatewayAcl* acl, qcc::String const& objectPath, AnnounceFlag announceFlag, QStatus* status);
 
     /**
      * Destructor for the BusObject
@@ -114,14 +117,63 @@ class AclBusObject : public BusObject  {
   private:
 
     /**
-     * The Acl that contains this BusObject
+     * CommitReply - replies to a method call once the policy changes it made are committed
      */
-    GatewayAcl* m_Acl;
+    class CommitReply : public GatewayPolicyCommitListener {
+      public:
+
+        /**
+         * Constructor for the CommitReply class
+         * @param busObject - the BusObject that received the method call
+         * @param msg - the message of the method
+         * @param methodName - name of the method, used for logging
+         */
+        CommitReply(AclBusObject* busObject, Message& msg, const char* methodName);
+
+        /**
+         * Send the reply
+         * @param status - status of the commit
+         */
+        void policiesCommitted(QStatus status);
+
+      private:
+
+        AclBusObject* m_BusObject;
+
+        Message m_Msg;
+
+        const char* m_MethodName;
+    };
 
     /**
-     * The ObjectPath of this ObjectPath
+     * Reply with the responseCode. A successful change is answered once the
+     * policies are committed, so the handler does not wait for the commit
+     * @param msg - the message of the method
+     * @param responseCode - the responseCode of the change
+     * @param methodName - name of the method, used for logging
      */
-    qcc::String m_ObjectPath;
+    void replyWhenCommitted(Message& msg, uint16_t responseCode, const char* methodName);
+
+    /**
+     * Create the Acl interface and register the method handlers
+     * @param bus - the bus to create the interface
+     * @param announceFlag - whether the interface is announced
+     * @return status - success/failure
+     */
+    QStatus addAclInterface(BusAttachment* bus, AnnounceFlag announceFlag);
+
+    /**
+     * Reply with the responseCode
+     * @param msg - the message of the method
+     * @param responseCode - the responseCode to send
+     * @param methodName - name of the method, used for logging
+     */
+    void replyResponseCode(Message& msg, uint16_t responseCode, const char* methodName);
+
+    /**
+     * The Acl that contains this BusObject
+     */
+    GatewayAcl* m_Acl;
 
 };
 
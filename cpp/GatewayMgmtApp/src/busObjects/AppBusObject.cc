@@ -18,6 +18,8 @@
 #include "../GatewayConstants.h"
 #include "AclAdapter.h"
 #include <alljoyn/gateway/GatewayMgmt.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayStats.h>
 #include <qcc/Mutex.h>
 
 namespace ajn {
@@ -298,6 +300,7 @@ QStatus AppBusObject::Set(const char* interfaceName, const char* propName, MsgAr
 void AppBusObject::GetAppStatus(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetAppStatus method call"));
 
@@ -340,6 +343,7 @@ ReplyError:
 void AppBusObject::RestartApp(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received RestartApp method call"));
 
@@ -362,6 +366,7 @@ void AppBusObject::RestartApp(const InterfaceDescription::Member* member, Messag
 void AppBusObject::GetManifestFile(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetManifestFile method call"));
 
@@ -383,6 +388,7 @@ void AppBusObject::GetManifestFile(const InterfaceDescription::Member* member, M
 void AppBusObject::GetManifestInterfaces(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetManifestInterfaces method call"));
 
@@ -503,6 +509,7 @@ QStatus AppBusObject::SendAppStatusChangedSignal()
 void AppBusObject::GetMergedAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetMergedAcl method call"));
 
@@ -523,6 +530,7 @@ void AppBusObject::GetMergedAcl(const InterfaceDescription::Member* member, Mess
 void AppBusObject::UpdateConnectionStatus(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received UpdateConnectionStatus method call"));
 
@@ -619,6 +627,7 @@ QStatus AppBusObject::SendShutdownAppSignal()
 void AppBusObject::CreateAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received CreateAcl method call"));
 
@@ -635,9 +644,13 @@ void AppBusObject::CreateAcl(const InterfaceDescription::Member* member, Message
 
     qcc::String aclId;
     uint16_t resultStatus = m_ConnectorApp->createAcl(&aclId, aclName, aclRules, metadata, customMetadata);
+    replyWhenCommitted(msg, resultStatus, &AppBusObject::replyCreateAcl, aclId);
+}
 
+void AppBusObject::replyCreateAcl(Message& msg, uint16_t responseCode, qcc::String const& aclId)
+{
     ajn::MsgArg replyArg[3];
-    status = replyArg[0].Set(AJPARAM_UINT16.c_str(), resultStatus);
+    QStatus status = replyArg[0].Set(AJPARAM_UINT16.c_str(), responseCode);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not marshal response to createAcl"));
         MethodReply(msg, status);
@@ -668,6 +681,7 @@ void AppBusObject::CreateAcl(const InterfaceDescription::Member* member, Message
 void AppBusObject::DeleteAcl(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received DeleteAcl method call"));
 
@@ -689,9 +703,15 @@ void AppBusObject::DeleteAcl(const InterfaceDescription::Member* member, Message
     }
 
     uint16_t responseCode = m_ConnectorApp->deleteAcl(aclId);
+    replyWhenCommitted(msg, responseCode, &AppBusObject::replyDeleteAcl, aclId);
+}
+
+void AppBusObject::replyDeleteAcl(Message& msg, uint16_t responseCode, qcc::String const& aclId)
+{
+    QCC_UNUSED(aclId);
 
     ajn::MsgArg replyArg[1];
-    status = replyArg[0].Set(AJPARAM_UINT16.c_str(), responseCode);
+    QStatus status = replyArg[0].Set(AJPARAM_UINT16.c_str(), responseCode);
     if (status != ER_OK) {
         QCC_LogError(status, ("Could not marshal response to DeleteAcl"));
         MethodReply(msg, status);
@@ -707,6 +727,7 @@ void AppBusObject::DeleteAcl(const InterfaceDescription::Member* member, Message
 void AppBusObject::ListAcls(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received ListAcls method call"));
 
@@ -741,5 +762,28 @@ void AppBusObject::ListAcls(const InterfaceDescription::Member* member, Message&
     return;
 }
 
+void AppBusObject::replyWhenCommitted(Message& msg, uint16_t responseCode, AclReplyHandler replyHandler, qcc::String const& aclId)
+{
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (responseCode != GW_ACL_RC_SUCCESS || !policyManager) {
+        (this->*replyHandler)(msg, responseCode, aclId);
+        return;
+    }
+    policyManager->notifyWhenCommitted(new CommitReply(this, msg, replyHandler, aclId));
+}
+
+AppBusObject::CommitReply::CommitReply(AppBusObject* busObject, Message& msg, AclReplyHandler replyHandler, qcc::String const& aclId) :
+    m_BusObject(busObject), m_Msg(msg), m_ReplyHandler(replyHandler), m_AclId(aclId)
+{
+}
+
+void AppBusObject::CommitReply::policiesCommitted(QStatus status)
+{
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not commit the policies for acl %s", m_AclId.c_str()));
+    }
+    (m_BusObject->*m_ReplyHandler)(m_Msg, status == ER_OK ? GW_ACL_RC_SUCCESS : GW_ACL_RC_POLICYMANAGER_ERROR, m_AclId);
+}
+
 } /* namespace gw */
 } /* namespace ajn */
@@ -23,6 +23,7 @@
 #include <alljoyn/InterfaceDescription.h>
 #include <alljoyn/gateway/GatewayConnectorApp.h>
 #include <alljoyn/gateway/GatewayConnectorAppManifest.h>
+#include <alljoyn/gateway/GatewayPolicyCommitListener.h>
 
 namespace ajn {
 namespace gw {
@@ -177,6 +178,69 @@ class AppBusObject : public BusObject  {
 
   private:
 
+    /**
+     * Function used to reply to an Acl method call
+     */
+    typedef void (AppBusObject::*AclReplyHandler)(Message& msg, uint16_t responseCode, qcc::String const& aclId);
+
+    /**
+     * CommitReply - replies to a method call once the policy changes it made are committed
+     */
+    class CommitReply : public GatewayPolicyCommitListener {
+      public:
+
+        /**
+         * Constructor for the CommitReply class
+         * @param busObject - the BusObject that received the method call
+         * @param msg - the message of the method
+         * @param replyHandler - the function sending the reply
+         * @param aclId - the aclId of the reply
+         */
+        CommitReply(AppBusObject* busObject, Message& msg, AclReplyHandler replyHandler, qcc::String const& aclId);
+
+        /**
+         * Send the reply
+         * @param status - status of the commit
+         */
+        void policiesCommitted(QStatus status);
+
+      private:
+
+        AppBusObject* m_BusObject;
+
+        Message m_Msg;
+
+        AclReplyHandler m_ReplyHandler;
+
+        qcc::String m_AclId;
+    };
+
+    /**
+     * Reply to an Acl method call. A successful change is answered once the
+     * policies are committed, so the handler does not wait for the commit
+     * @param msg - the message of the method
+     * @param responseCode - the responseCode of the change
+     * @param replyHandler - the function sending the reply
+     * @param aclId - the aclId of the reply
+     */
+    void replyWhenCommitted(Message& msg, uint16_t responseCode, AclReplyHandler replyHandler, qcc::String const& aclId);
+
+    /**
+     * Send the reply to CreateAcl
+     * @param msg - the message of the method
+     * @param responseCode - the responseCode to send
+     * @param aclId - the id of the created acl
+     */
+    void replyCreateAcl(Message& msg, uint16_t responseCode, qcc::String const& aclId);
+
+    /**
+     * Send the reply to DeleteAcl
+     * @param msg - the message of the method
+     * @param responseCode - the responseCode to send
+     * @param aclId - the id of the deleted acl
+     */
+    void replyDeleteAcl(Message& msg, uint16_t responseCode, qcc::String const& aclId);
+
     /**
      * The Connector App that contains this busObject
      */
@@ -18,6 +18,9 @@
 #include "../GatewayConstants.h"
 #include <alljoyn/gateway/GatewayMgmt.h>
 #include <alljoyn/gateway/GatewayConnectorApp.h>
+#include <alljoyn/gateway/GatewayMetadataManager.h>
+#include <alljoyn/gateway/GatewayRouterPolicyManager.h>
+#include <alljoyn/gateway/GatewayStats.h>
 #include <vector>
 
 namespace ajn {
@@ -65,6 +68,12 @@ postCreate:
         return;
     }
 
+    *status = addStatsInterface(bus);
+    if (*status != ER_OK) {
+        QCC_LogError(*status, ("Could not add the Stats interface"));
+        return;
+    }
+
     std::vector<String> interfaces;
     interfaces.push_back(AJ_GW_APP_MGMT_INTERFACE);
 
@@ -76,6 +85,60 @@ AppMgmtBusObject::~AppMgmtBusObject()
 {
 }
 
+QStatus AppMgmtBusObject::addStatsInterface(BusAttachment* bus)
+{
+    QStatus status = ER_OK;
+    const ajn::InterfaceDescription::Member* methodMember;
+    InterfaceDescription* interfaceDescription = (InterfaceDescription*) bus->GetInterface(AJ_GW_STATS_INTERFACE.c_str());
+    if (!interfaceDescription) {
+        status = bus->CreateInterface(AJ_GW_STATS_INTERFACE.c_str(), interfaceDescription, true);
+        if (status != ER_OK) {
+            goto postCreate;
+        }
+        status = interfaceDescription->AddProperty(AJ_PROPERTY_VERSION.c_str(), AJPARAM_UINT16.c_str(), PROP_ACCESS_READ);
+        if (status != ER_OK) {
+            goto postCreate;
+        }
+        status = interfaceDescription->AddMethod(AJ_METHOD_GET_STATS.c_str(), AJ_GET_STATS_PARAMS_IN.c_str(),
+                                                 AJ_GET_STATS_PARAMS_OUT.c_str(), AJ_GET_STATS_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
+            goto postCreate;
+        }
+        status = interfaceDescription->AddMethod(AJ_METHOD_RESET_STATS.c_str(), AJ_RESET_STATS_PARAMS_IN.c_str(),
+                                                 AJ_RESET_STATS_PARAMS_OUT.c_str(), AJ_RESET_STATS_PARAM_NAMES.c_str());
+        if (status != ER_OK) {
+            goto postCreate;
+        }
+        interfaceDescription->Activate();
+    }
+
+postCreate:
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not create interface"));
+        return status;
+    }
+
+    status = AddInterface(*interfaceDescription, UNANNOUNCED);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not add interface"));
+        return status;
+    }
+
+    methodMember = interfaceDescription->GetMember(AJ_METHOD_GET_STATS.c_str());
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AppMgmtBusObject::GetStats));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the GetStats MethodHandler"));
+        return status;
+    }
+
+    methodMember = interfaceDescription->GetMember(AJ_METHOD_RESET_STATS.c_str());
+    status = AddMethodHandler(methodMember, static_cast<MessageReceiver::MethodHandler>(&AppMgmtBusObject::ResetStats));
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Could not register the ResetStats MethodHandler"));
+    }
+    return status;
+}
+
 QStatus AppMgmtBusObject::Get(const char* interfaceName, const char* propName, MsgArg& val)
 {
     QCC_UNUSED(interfaceName);
@@ -99,6 +162,7 @@ QStatus AppMgmtBusObject::Set(const char* interfaceName, const char* propName, M
 void AppMgmtBusObject::GetInstalledApps(const InterfaceDescription::Member* member, Message& msg)
 {
     QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
 
     QCC_DbgTrace(("Received GetInstalledApps method call"));
 
@@ -134,6 +198,101 @@ void AppMgmtBusObject::GetInstalledApps(const InterfaceDescription::Member* memb
     }
 }
 
+void AppMgmtBusObject::GetStats(const InterfaceDescription::Member* member, Message& msg)
+{
+    QCC_UNUSED(member);
+    GatewayStatsTimer timer(GW_LATENCY_METHOD_CALL);
+
+    QCC_DbgTrace(("Received GetStats method call"));
+
+    QStatus status;
+    ajn::MsgArg replyArg[2];
+
+    uint64_t counters[GW_STAT_NUM_COUNTERS];
+    GatewayStats::Histogram histograms[GW_LATENCY_NUM_HISTOGRAMS];
+    uint64_t elapsedMs = 0;
+    GatewayStats::getInstance()->getSnapshot(counters, histograms, &elapsedMs);
+
+    std::vector<std::pair<const char*, uint64_t> > values;
+    for (size_t i = 0; i < GW_STAT_NUM_COUNTERS; i++) {
+        values.push_back(std::make_pair(GatewayStats::getCounterName((GatewayStatsCounter)i), counters[i]));
+    }
+
+    //current sizes, not reset with the counters
+    size_t numAcls = 0;
+    size_t numActiveAcls = 0;
+    m_ConnectorAppManager->getAclCounts(&numAcls, &numActiveAcls);
+    values.push_back(std::make_pair("ConnectorApps", (uint64_t)m_ConnectorAppManager->getConnectorApps().size()));
+    values.push_back(std::make_pair("Acls", (uint64_t)numAcls));
+    values.push_back(std::make_pair("ActiveAcls", (uint64_t)numActiveAcls));
+
+    GatewayRouterPolicyManager* policyManager = GatewayMgmt::getInstance()->getRouterPolicyManager();
+    if (policyManager) {
+        values.push_back(std::make_pair("AnnouncedDevices", (uint64_t)policyManager->getNumAnnouncedDevices()));
+        values.push_back(std::make_pair("PolicyBytes", policyManager->getPolicyBytes()));
+    }
+    GatewayMetadataManager* metadataManager = GatewayMgmt::getInstance()->getMetadataManager();
+    if (metadataManager) {
+        values.push_back(std::make_pair("MetadataEntries", (uint64_t)metadataManager->getNumMetadataEntries()));
+    }
+    values.push_back(std::make_pair("ElapsedMs", elapsedMs));
+    values.push_back(std::make_pair("AnnouncementsPerMinute", elapsedMs ? counters[GW_STAT_ANNOUNCEMENTS] * 60000 / elapsedMs : 0));
+
+    std::vector<MsgArg> counterArgs(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        status = counterArgs[i].Set(AJPARAM_STATS_COUNTER.c_str(), values[i].first, values[i].second);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Can't marshal the counters - responding with error"));
+            MethodReply(msg, status);
+            return;
+        }
+    }
+
+    std::vector<MsgArg> histogramArgs(GW_LATENCY_NUM_HISTOGRAMS);
+    for (size_t i = 0; i < GW_LATENCY_NUM_HISTOGRAMS; i++) {
+        GatewayStats::Histogram& histogram = histograms[i];
+        status = histogramArgs[i].Set(AJPARAM_STATS_HISTOGRAM.c_str(), GatewayStats::getHistogramName((GatewayStatsHistogram)i),
+                                      histogram.count, histogram.sumUs, histogram.maxUs, GatewayStats::NUM_BUCKETS, histogram.buckets);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Can't marshal the latencies - responding with error"));
+            MethodReply(msg, status);
+            return;
+        }
+    }
+
+    status = replyArg[0].Set(AJPARAM_STATS_COUNTER_ARRAY.c_str(), counterArgs.size(), counterArgs.data());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Can't marshal the counters - responding with error"));
+        MethodReply(msg, status);
+        return;
+    }
+    status = replyArg[1].Set(AJPARAM_STATS_HISTOGRAM_ARRAY.c_str(), histogramArgs.size(), histogramArgs.data());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Can't marshal the latencies - responding with error"));
+        MethodReply(msg, status);
+        return;
+    }
+
+    status = MethodReply(msg, replyArg, 2);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("GetStats reply call failed"));
+    }
+}
+
+void AppMgmtBusObject::ResetStats(const InterfaceDescription::Member* member, Message& msg)
+{
+    QCC_UNUSED(member);
+
+    QCC_DbgTrace(("Received ResetStats method call"));
+
+    GatewayStats::getInstance()->reset();
+
+    QStatus status = MethodReply(msg);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("ResetStats reply call failed"));
+    }
+}
+
 } /* namespace gw */
 } /* namespace ajn */
 
@@ -51,6 +51,20 @@ class AppMgmtBusObject : public BusObject  {
      */
     void GetInstalledApps(const InterfaceDescription::Member* member, Message& msg);
 
+    /**
+     * Function callback for GetStats
+     * @param member - the member called
+     * @param msg - the message of the method
+     */
+    void GetStats(const InterfaceDescription::Member* member, Message& msg);
+
+    /**
+     * Function callback for ResetStats
+     * @param member - the member called
+     * @param msg - the message of the method
+     */
+    void ResetStats(const InterfaceDescription::Member* member, Message& msg);
+
     /**
      * Get Property
      * @param interfaceName - name of the interface
@@ -76,6 +90,13 @@ class AppMgmtBusObject : public BusObject  {
      */
     GatewayConnectorAppManager* m_ConnectorAppManager;
 
+    /**
+     * Create the Stats interface and register its handlers
+     * @param bus - the bus to create the interface
+     * @return status - success/failure
+     */
+    QStatus addStatsInterface(BusAttachment* bus);
+
 };
 
 } /* namespace gw */